@@ -0,0 +1,309 @@
+#include "AsyncLogger.h"
+#include <QDateTime>
+#include <QDeadlineTimer>
+#include <QLoggingCategory>
+#include <QMutexLocker>
+#include <QThread>
+#include <QTime>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+// 单批累计到这么多字节就写出,不等刷新间隔
+constexpr qsizetype BatchBytes = 64 * 1024;
+
+std::atomic<AsyncLogger *> s_logger{nullptr};
+QtMessageHandler s_previousHandler = nullptr;
+QLoggingCategory::CategoryFilter s_previousFilter = nullptr;
+
+const char *levelTag(QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg: return "[DEBUG] ";
+    case QtInfoMsg: return "[INFO] ";
+    case QtWarningMsg: return "[WARNING] ";
+    case QtCriticalMsg: return "[CRITICAL] ";
+    case QtFatalMsg: return "[FATAL] ";
+    }
+    return "";
+}
+
+constexpr int CrashSignals[] = {SIGSEGV, SIGABRT, SIGFPE, SIGILL};
+
+} // namespace
+
+AsyncLogger::AsyncLogger(const QString &fileName, int capacity)
+{
+    quint64 size = 2;
+    while (size < quint64(qMax(2, capacity))) size *= 2;
+    m_cells.reset(new Cell[size]);
+    m_mask = size - 1;
+    for (quint64 i = 0; i < size; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    if (!fileName.isEmpty()) {
+        m_file.setFileName(fileName);
+        m_file.open(QIODevice::WriteOnly | QIODevice::Append);
+    }
+    m_consoleBatch.reserve(BatchBytes + 4096);
+    m_fileBatch.reserve(BatchBytes + 4096);
+
+    m_writer = QThread::create([this] { runWriter(); });
+    m_writer->start(QThread::LowPriority);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    if (s_logger.load() == this) {
+        qInstallMessageHandler(s_previousHandler);
+        s_logger.store(nullptr);
+        QLoggingCategory::installFilter(s_previousFilter);
+    }
+    {
+        QMutexLocker locker(&m_wakeMutex);
+        m_stopping = true;
+        m_wake.wakeAll();
+    }
+    m_writer->wait();
+    delete m_writer;
+    // 写者退出前已经写空缓冲区,这里处理停止过程中新到达的消息
+    flush();
+}
+
+void AsyncLogger::install()
+{
+    s_logger.store(this);
+    s_previousHandler = qInstallMessageHandler(&AsyncLogger::messageHandler);
+    QLoggingCategory::CategoryFilter previous = QLoggingCategory::installFilter(&AsyncLogger::categoryFilter);
+    if (previous != &AsyncLogger::categoryFilter) {
+        s_previousFilter = previous;
+    }
+    for (int signal : CrashSignals) {
+        std::signal(signal, &AsyncLogger::crashHandler);
+    }
+}
+
+int AsyncLogger::severity(QtMsgType type)
+{
+    switch (type) {
+    case QtDebugMsg: return 0;
+    case QtInfoMsg: return 1;
+    case QtWarningMsg: return 2;
+    case QtCriticalMsg: return 3;
+    case QtFatalMsg: return 4;
+    }
+    return 0;
+}
+
+void AsyncLogger::setMinimumLevel(QtMsgType type)
+{
+    m_minimumLevel.store(type, std::memory_order_relaxed);
+    // 重新安装过滤器会让所有已注册的分类重新应用过滤规则
+    if (s_logger.load() == this) {
+        QLoggingCategory::installFilter(&AsyncLogger::categoryFilter);
+    }
+}
+
+void AsyncLogger::categoryFilter(QLoggingCategory *category)
+{
+    if (s_previousFilter) {
+        s_previousFilter(category);
+    }
+    AsyncLogger *logger = s_logger.load();
+    if (!logger) {
+        return;
+    }
+    // 只关闭低于最低级别的输出,不打开规则中已关闭的级别;致命消息始终保留
+    const int minimum = severity(logger->minimumLevel());
+    for (QtMsgType type : {QtDebugMsg, QtInfoMsg, QtWarningMsg, QtCriticalMsg}) {
+        if (severity(type) < minimum) {
+            category->setEnabled(type, false);
+        }
+    }
+}
+
+void AsyncLogger::messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    Q_UNUSED(context);
+    AsyncLogger *logger = s_logger.load(std::memory_order_acquire);
+    if (!logger) {
+        return;
+    }
+    logger->log(type, message);
+    if (type == QtFatalMsg) {
+        // 终止前在当前线程上写出全部消息,包括这条致命消息
+        logger->flush();
+        std::abort();
+    }
+}
+
+bool AsyncLogger::log(QtMsgType type, const QString &message)
+{
+    if (severity(type) < severity(minimumLevel())) {
+        return false;
+    }
+
+    // 有界多生产者队列:按序号认领槽位,槽位序号等于认领位置时表示空闲
+    quint64 pos = m_enqueuePos.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    for (;;) {
+        cell = &m_cells[pos & m_mask];
+        const quint64 sequence = cell->sequence.load(std::memory_order_acquire);
+        const qint64 diff = qint64(sequence) - qint64(pos);
+        if (diff == 0) {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    cell->type = type;
+    cell->timestamp = QDateTime::currentMSecsSinceEpoch();
+    cell->message = message; // 与调用方共享数据,只增加引用计数
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    // 平时由写者按刷新间隔自行醒来;警告以上或缓冲区过半时提前唤醒。
+    // 不持锁唤醒可能错过正在进入等待的写者,最多推迟一个刷新间隔
+    if (severity(type) >= severity(QtWarningMsg)
+        || pos + 1 - m_dequeuePos.load(std::memory_order_relaxed) > (m_mask + 1) / 2) {
+        m_wake.wakeOne();
+    }
+    return true;
+}
+
+bool AsyncLogger::pop(QtMsgType *type, qint64 *timestamp, QString *message)
+{
+    quint64 pos = m_dequeuePos.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    for (;;) {
+        cell = &m_cells[pos & m_mask];
+        const quint64 sequence = cell->sequence.load(std::memory_order_acquire);
+        const qint64 diff = qint64(sequence) - qint64(pos + 1);
+        if (diff == 0) {
+            if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = m_dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+    *type = cell->type;
+    *timestamp = cell->timestamp;
+    *message = std::move(cell->message);
+    cell->message = QString();
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+void AsyncLogger::runWriter()
+{
+    QMutexLocker locker(&m_wakeMutex);
+    while (!m_stopping) {
+        locker.unlock();
+        drain();
+        locker.relock();
+        if (m_stopping) {
+            break;
+        }
+        m_wake.wait(&m_wakeMutex, QDeadlineTimer(m_flushIntervalMs.load(std::memory_order_relaxed)));
+    }
+    locker.unlock();
+    drain();
+}
+
+void AsyncLogger::flush()
+{
+    drain();
+}
+
+void AsyncLogger::drain()
+{
+    QMutexLocker locker(&m_drainMutex);
+    drainLocked();
+}
+
+void AsyncLogger::drainLocked()
+{
+    m_utcOffsetMs = qint64(QDateTime::currentDateTime().offsetFromUtc()) * 1000;
+
+    QtMsgType type;
+    qint64 timestamp;
+    QString message;
+    while (pop(&type, &timestamp, &message)) {
+        append(type, timestamp, message);
+        if (m_consoleBatch.size() >= BatchBytes || m_fileBatch.size() >= BatchBytes) {
+            writeBatch();
+        }
+    }
+
+    const quint64 dropped = m_dropped.load(std::memory_order_relaxed);
+    const quint64 reported = m_reportedDropped.exchange(dropped, std::memory_order_relaxed);
+    if (dropped != reported) {
+        append(QtWarningMsg, QDateTime::currentMSecsSinceEpoch(),
+               QStringLiteral("日志缓冲区已满,丢弃 %1 条消息").arg(dropped - reported));
+    }
+    writeBatch();
+}
+
+void AsyncLogger::append(QtMsgType type, qint64 timestamp, const QString &message)
+{
+    const char *tag = levelTag(type);
+    if (m_console.load(std::memory_order_relaxed)) {
+        m_consoleBatch.append(tag);
+        m_consoleBatch.append(message.toLocal8Bit());
+        m_consoleBatch.append('\n');
+    }
+    if (m_file.isOpen()) {
+        const qint64 msecsOfDay = (timestamp + m_utcOffsetMs) % (24 * 3600 * 1000);
+        m_fileBatch.append(QTime::fromMSecsSinceStartOfDay(int(msecsOfDay)).toString("hh:mm:ss.zzz ").toLatin1());
+        m_fileBatch.append(tag);
+        m_fileBatch.append(message.toUtf8());
+        m_fileBatch.append('\n');
+    }
+    m_written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AsyncLogger::writeBatch()
+{
+    if (!m_consoleBatch.isEmpty()) {
+        fwrite(m_consoleBatch.constData(), 1, size_t(m_consoleBatch.size()), stderr);
+        fflush(stderr);
+        m_consoleBatch.resize(0);
+    }
+    if (!m_fileBatch.isEmpty()) {
+        m_file.write(m_fileBatch);
+        m_file.flush();
+        m_fileBatch.resize(0);
+    }
+}
+
+void AsyncLogger::emergencyFlush()
+{
+    // 写者或其他线程正持有锁时不能等待(可能正是崩溃的线程),只能放弃
+    if (!m_drainMutex.tryLock()) {
+        return;
+    }
+    drainLocked();
+    m_drainMutex.unlock();
+}
+
+void AsyncLogger::crashHandler(int signal)
+{
+    // 信号处理中分配内存和加锁并不安全,这里只是尽力保住崩溃前的日志
+    for (int s : CrashSignals) {
+        std::signal(s, SIG_DFL);
+    }
+    if (AsyncLogger *logger = s_logger.load()) {
+        logger->emergencyFlush();
+    }
+    std::raise(signal);
+}
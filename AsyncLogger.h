@@ -0,0 +1,118 @@
+#ifndef ASYNCLOGGER_H
+#define ASYNCLOGGER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+#include <QtGlobal>
+#include <atomic>
+#include <memory>
+
+class QLoggingCategory;
+class QThread;
+
+/**
+ * @brief 异步批量日志
+ *
+ * 消息处理函数只把消息(与 QDebug 共享的 QString)和时间戳放入无锁环形缓冲区,
+ * 不格式化、不做系统调用;后台线程成批取出、格式化并写入控制台和日志文件,
+ * 缓冲区超过批量大小或到达刷新间隔时才写出。
+ * 低于最低级别的消息在分类过滤器中就被关闭,qDebug() 不会再格式化参数。
+ * 缓冲区写满时丢弃新消息并计数,在下一批中报告丢弃条数。
+ *
+ * 致命消息在调用线程上同步写出后再终止进程;崩溃信号处理中尽力写出尚未写出的消息。
+ */
+class AsyncLogger
+{
+public:
+    /**
+     * @param fileName 日志文件,以追加方式打开;为空时只输出到控制台
+     * @param capacity 环形缓冲区条目数,向上取整为 2 的幂
+     */
+    explicit AsyncLogger(const QString &fileName, int capacity = 8192);
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger &) = delete;
+    AsyncLogger &operator=(const AsyncLogger &) = delete;
+
+    /**
+     * @brief 安装为 Qt 消息处理函数和分类过滤器,并注册崩溃信号处理
+     */
+    void install();
+
+    /**
+     * @brief 设置最低输出级别(按 调试 < 信息 < 警告 < 严重 < 致命 排序)
+     */
+    void setMinimumLevel(QtMsgType type);
+    QtMsgType minimumLevel() const { return m_minimumLevel.load(std::memory_order_relaxed); }
+
+    void setConsoleOutput(bool enabled) { m_console.store(enabled, std::memory_order_relaxed); }
+    void setFlushInterval(int ms) { m_flushIntervalMs.store(qMax(1, ms), std::memory_order_relaxed); }
+
+    /**
+     * @brief 提交一条消息,只入队不写出
+     * @return 缓冲区已满或低于最低级别时返回 false
+     */
+    bool log(QtMsgType type, const QString &message);
+
+    /**
+     * @brief 在调用线程上写出缓冲区中的全部消息
+     */
+    void flush();
+
+    quint64 droppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+    quint64 writtenCount() const { return m_written.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 级别的严重程度,用于比较(QtMsgType 的取值不按严重程度排列)
+     */
+    static int severity(QtMsgType type);
+
+private:
+    struct Cell {
+        std::atomic<quint64> sequence{0};
+        QtMsgType type = QtDebugMsg;
+        qint64 timestamp = 0;
+        QString message;
+    };
+
+    bool pop(QtMsgType *type, qint64 *timestamp, QString *message);
+    void runWriter();
+    void drain();
+    void drainLocked();
+    void append(QtMsgType type, qint64 timestamp, const QString &message);
+    void writeBatch();
+    void emergencyFlush();
+
+    static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message);
+    static void categoryFilter(QLoggingCategory *category);
+    static void crashHandler(int signal);
+
+    std::unique_ptr<Cell[]> m_cells;
+    quint64 m_mask = 0;
+    alignas(64) std::atomic<quint64> m_enqueuePos{0};
+    alignas(64) std::atomic<quint64> m_dequeuePos{0};
+    alignas(64) std::atomic<quint64> m_dropped{0};
+    std::atomic<quint64> m_reportedDropped{0};
+    std::atomic<quint64> m_written{0};
+
+    std::atomic<QtMsgType> m_minimumLevel{QtDebugMsg};
+    std::atomic<bool> m_console{true};
+    std::atomic<int> m_flushIntervalMs{100};
+
+    // 以下成员只在持有 m_drainMutex 时访问
+    QMutex m_drainMutex;
+    QFile m_file;
+    QByteArray m_consoleBatch;
+    QByteArray m_fileBatch;
+    qint64 m_utcOffsetMs = 0;
+
+    QMutex m_wakeMutex;
+    QWaitCondition m_wake;
+    bool m_stopping = false;
+    QThread *m_writer = nullptr;
+};
+
+#endif // ASYNCLOGGER_H
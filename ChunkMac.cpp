@@ -0,0 +1,200 @@
+#include "ChunkMac.h"
+#include "CipherBackend.h"
+#include "ResourceEncryption.h"
+#include <QMessageAuthenticationCode>
+#include <QtEndian>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CHUNK_MAC_X86_DISPATCH
+#endif
+
+namespace {
+
+// NH 以 16 字节为一组,第二轮使用错开 4 个字的密钥
+constexpr qsizetype NhBlockSize = 16;
+constexpr qsizetype NhKeyWords = ChunkMac::MaxChunkSize / 4 + 4;
+
+// 所有内核的约定:处理 blocks 组完整的 16 字节,结果累加到 sum[0](第一轮)和 sum[1](第二轮)
+using NhKernel = void (*)(const uchar *data, qsizetype blocks, const quint32 *key, quint64 sum[2]);
+
+/**
+ * @brief 标量实现:每组 4 个小端 32 位字 w,sum += (w0+k0)(w1+k1) + (w2+k2)(w3+k3)
+ */
+void nhScalar(const uchar *data, qsizetype blocks, const quint32 *key, quint64 sum[2])
+{
+    for (qsizetype j = 0; j < blocks; ++j) {
+        quint32 w[4];
+        for (int i = 0; i < 4; ++i)
+            w[i] = qFromLittleEndian<quint32>(data + j * NhBlockSize + i * 4);
+        for (int pass = 0; pass < 2; ++pass) {
+            const quint32 *k = key + j * 4 + pass * 4;
+            sum[pass] += quint64(quint32(w[0] + k[0])) * quint32(w[1] + k[1])
+                         + quint64(quint32(w[2] + k[2])) * quint32(w[3] + k[3]);
+        }
+    }
+}
+
+#ifdef CHUNK_MAC_X86_DISPATCH
+__attribute__((target("sse2")))
+void nhSse2(const uchar *data, qsizetype blocks, const quint32 *key, quint64 sum[2])
+{
+    __m128i acc0 = _mm_setzero_si128();
+    __m128i acc1 = _mm_setzero_si128();
+    for (qsizetype j = 0; j < blocks; ++j) {
+        const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + j * NhBlockSize));
+        const __m128i v0 = _mm_add_epi32(m, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + j * 4)));
+        const __m128i v1 = _mm_add_epi32(m, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key + j * 4 + 4)));
+        // 64 位通道内低 32 位乘高 32 位:(w0+k0)(w1+k1) 与 (w2+k2)(w3+k3)
+        acc0 = _mm_add_epi64(acc0, _mm_mul_epu32(v0, _mm_srli_epi64(v0, 32)));
+        acc1 = _mm_add_epi64(acc1, _mm_mul_epu32(v1, _mm_srli_epi64(v1, 32)));
+    }
+    quint64 lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes + 2), acc1);
+    sum[0] += lanes[0] + lanes[1];
+    sum[1] += lanes[2] + lanes[3];
+}
+
+__attribute__((target("avx2")))
+void nhAvx2(const uchar *data, qsizetype blocks, const quint32 *key, quint64 sum[2])
+{
+    __m256i acc0 = _mm256_setzero_si256();
+    __m256i acc1 = _mm256_setzero_si256();
+    qsizetype j = 0;
+    // 一次处理两组,两轮所需的密钥恰好各是连续的 8 个字
+    for (; j + 2 <= blocks; j += 2) {
+        const __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + j * NhBlockSize));
+        const __m256i v0 = _mm256_add_epi32(m, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key + j * 4)));
+        const __m256i v1 =
+            _mm256_add_epi32(m, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key + j * 4 + 4)));
+        acc0 = _mm256_add_epi64(acc0, _mm256_mul_epu32(v0, _mm256_srli_epi64(v0, 32)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_mul_epu32(v1, _mm256_srli_epi64(v1, 32)));
+    }
+    quint64 lanes[8];
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), acc0);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes + 4), acc1);
+    sum[0] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    sum[1] += lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    nhSse2(data + j * NhBlockSize, blocks - j, key + j * 4, sum);
+}
+#endif
+
+/**
+ * @brief 运行时根据 CPU 特性选择内核,只探测一次
+ */
+NhKernel selectNhKernel()
+{
+#ifdef CHUNK_MAC_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return nhAvx2;
+    if (__builtin_cpu_supports("sse2")) return nhSse2;
+#endif
+    return nhScalar;
+}
+
+quint64 rotl(quint64 x, int b)
+{
+    return (x << b) | (x >> (64 - b));
+}
+
+void sipRound(quint64 &v0, quint64 &v1, quint64 &v2, quint64 &v3)
+{
+    v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+    v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+}
+
+/**
+ * @brief SipHash-2-4,消息长度为 8 的整数倍
+ */
+quint64 sipHash24(const quint64 key[2], const quint64 *words, int count)
+{
+    quint64 v0 = 0x736f6d6570736575ULL ^ key[0];
+    quint64 v1 = 0x646f72616e646f6dULL ^ key[1];
+    quint64 v2 = 0x6c7967656e657261ULL ^ key[0];
+    quint64 v3 = 0x7465646279746573ULL ^ key[1];
+    auto compress = [&](quint64 m) {
+        v3 ^= m;
+        sipRound(v0, v1, v2, v3);
+        sipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    };
+    for (int i = 0; i < count; ++i)
+        compress(words[i]);
+    compress(quint64(count * 8) << 56);
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; ++i)
+        sipRound(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+// 生成 NH 密钥的计数器模式初始向量,与资源的初始向量(HMAC 输出)不会重合
+const char NhKeyIv[17] = "QRE/chunk-mac/nh";
+
+} // namespace
+
+ChunkMac::ChunkMac(const DerivedKey &key)
+    : m_nhKey(new quint32[NhKeyWords]())
+{
+    // NH 密钥取自派生密钥的 AES 密钥流,SipHash 密钥由 HMAC 分离
+    QByteArray stream(NhKeyWords * 4, '\0');
+    if (const auto cipher = CipherBackend::create(CipherAlgorithm::Aes256Ctr, key, QByteArray(NhKeyIv, 16)))
+        cipher->process(stream.constData(), stream.data(), stream.size(), 0);
+    for (qsizetype i = 0; i < NhKeyWords; ++i)
+        m_nhKey[i] = qFromLittleEndian<quint32>(stream.constData() + i * 4);
+    stream.fill('\0');
+
+    const QByteArray sip = QMessageAuthenticationCode::hash(QByteArrayView("QtResourceEncryption/chunk-mac"),
+                                                            key.material(), QCryptographicHash::Sha256);
+    m_sipKey[0] = qFromLittleEndian<quint64>(sip.constData());
+    m_sipKey[1] = qFromLittleEndian<quint64>(sip.constData() + 8);
+}
+
+ChunkMac::~ChunkMac()
+{
+    // 密钥属于敏感数据,释放前清零
+    volatile quint32 *p = m_nhKey.get();
+    for (qsizetype i = 0; i < NhKeyWords; ++i) p[i] = 0;
+    volatile quint64 *s = m_sipKey;
+    s[0] = 0;
+    s[1] = 0;
+}
+
+bool ChunkMac::isValidChunkSize(qsizetype size)
+{
+    return size >= MinChunkSize && size <= MaxChunkSize && (size & (size - 1)) == 0;
+}
+
+quint64 ChunkMac::tag(const char *data, qsizetype size, quint64 index, const char *header) const
+{
+    static const NhKernel kernel = selectNhKernel();
+    Q_ASSERT(size >= 0 && size <= MaxChunkSize);
+
+    const auto *bytes = reinterpret_cast<const uchar *>(data);
+    const qsizetype blocks = size / NhBlockSize;
+    quint64 nh[2] = {0, 0};
+    kernel(bytes, blocks, m_nhKey.get(), nh);
+    if (const qsizetype tail = size % NhBlockSize) {
+        // 最后不足 16 字节的部分补零;块长度参与 SipHash,补零不会产生歧义
+        uchar last[NhBlockSize] = {};
+        memcpy(last, bytes + blocks * NhBlockSize, size_t(tail));
+        nhScalar(last, 1, m_nhKey.get() + blocks * 4, nh);
+    }
+
+    // 头部字节 4-7 决定如何解释密文(版本、算法、压缩方式),字节 24-31 决定负载的块数,
+    // 与初始向量一起认证:截断负载并改小块数量后,剩下的每一块都无法通过校验
+    const quint64 words[8] = {
+        qFromLittleEndian<quint64>(header + 8),
+        qFromLittleEndian<quint64>(header + 16),
+        nh[0],
+        nh[1],
+        index,
+        quint64(size),
+        quint64(qFromLittleEndian<quint32>(header + 4)),
+        qFromLittleEndian<quint64>(header + 24),
+    };
+    return sipHash24(m_sipKey, words, 8);
+}
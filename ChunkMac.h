@@ -0,0 +1,57 @@
+#ifndef CHUNKMAC_H
+#define CHUNKMAC_H
+
+#include <QtGlobal>
+#include <memory>
+
+class DerivedKey;
+
+/**
+ * @brief 按块计算密文的认证标签
+ *
+ * 每块先用 NH 通用哈希(两轮,密钥按 16 字节错开)压缩成 128 位,
+ * 再与资源的初始向量、头部的版本/算法/压缩方式字节、块大小和块数量、
+ * 块序号和块长度一起经 SipHash-2-4 得到 64 位标签。
+ * NH 每 16 字节只需两次 32 位乘法,用 SSE2/AVX2 并行时与 AES-NI 解密相比开销很小;
+ * SipHash 只处理定长的 64 字节,与块大小无关。两者的密钥都由派生密钥生成,
+ * 没有密钥无法伪造标签:改动密文、调换块的顺序、把别的资源的块搬过来,
+ * 改写头部记录的算法和压缩方式,或者在块边界截断负载并减小块数量都会被发现
+ * (每块的标签都绑定了块数量,最后一块的长度又决定了负载的总长度)。
+ *
+ * 对象只读,可以被多个线程同时使用。
+ */
+class ChunkMac
+{
+public:
+    static constexpr int TagSize = 8;
+    static constexpr qsizetype MinChunkSize = 1024;
+    static constexpr qsizetype MaxChunkSize = 64 * 1024;
+
+    explicit ChunkMac(const DerivedKey &key);
+    ~ChunkMac();
+
+    ChunkMac(const ChunkMac &) = delete;
+    ChunkMac &operator=(const ChunkMac &) = delete;
+
+    /**
+     * @brief 计算一块密文的标签
+     * @param data 块数据
+     * @param size 块长度,不超过 MaxChunkSize
+     * @param index 块序号
+     * @param header 资源的 32 字节头部,参与计算的是字节 4-7(版本、算法、压缩方式、保留)、
+     *               字节 8-23(初始向量)和字节 24-31(块大小、块数量)
+     */
+    quint64 tag(const char *data, qsizetype size, quint64 index, const char *header) const;
+
+    /**
+     * @brief 块大小必须是 [MinChunkSize, MaxChunkSize] 之间的 2 的幂,
+     * 这样按块对齐的任意 2 的幂大小的区间都能独立校验
+     */
+    static bool isValidChunkSize(qsizetype size);
+
+private:
+    std::unique_ptr<quint32[]> m_nhKey;
+    quint64 m_sipKey[2] = {0, 0};
+};
+
+#endif // CHUNKMAC_H
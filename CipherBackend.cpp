@@ -0,0 +1,601 @@
+#include "CipherBackend.h"
+#include <QtEndian>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CIPHER_BACKEND_X86_DISPATCH
+#endif
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// XOR 后端(兼容旧文件)
+// ---------------------------------------------------------------------------
+
+// 密钥条带长度：一个 AVX-512 寄存器的宽度，同时是 16/32 字节向量宽度的整数倍
+constexpr qsizetype StripeSize = 64;
+
+// 所有内核的约定：src/dst 的第 0 个字节对应 stripe 的第 0 个字节，src 与 dst 可以相同
+using XorKernel = void (*)(const char *src, char *dst, qsizetype size, const char *stripe);
+
+/**
+ * @brief 标量回退：按 8 字节字宽处理，尾部逐字节处理
+ * 条带长度为 2 的幂，用位与代替取模
+ */
+void xorScalar(const char *src, char *dst, qsizetype size, const char *stripe)
+{
+    qsizetype i = 0;
+    for (; i + 8 <= size; i += 8) {
+        quint64 d, k;
+        memcpy(&d, src + i, 8);
+        memcpy(&k, stripe + (i & (StripeSize - 1)), 8);
+        d ^= k;
+        memcpy(dst + i, &d, 8);
+    }
+    for (; i < size; ++i)
+        dst[i] = src[i] ^ stripe[i & (StripeSize - 1)];
+}
+
+#ifdef CIPHER_BACKEND_X86_DISPATCH
+__attribute__((target("sse2")))
+void xorSse2(const char *src, char *dst, qsizetype size, const char *stripe)
+{
+    const __m128i k0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe));
+    const __m128i k1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe + 16));
+    const __m128i k2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe + 32));
+    const __m128i k3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(stripe + 48));
+    qsizetype i = 0;
+    for (; i + StripeSize <= size; i += StripeSize) {
+        const __m128i *s = reinterpret_cast<const __m128i *>(src + i);
+        __m128i *d = reinterpret_cast<__m128i *>(dst + i);
+        _mm_storeu_si128(d + 0, _mm_xor_si128(_mm_loadu_si128(s + 0), k0));
+        _mm_storeu_si128(d + 1, _mm_xor_si128(_mm_loadu_si128(s + 1), k1));
+        _mm_storeu_si128(d + 2, _mm_xor_si128(_mm_loadu_si128(s + 2), k2));
+        _mm_storeu_si128(d + 3, _mm_xor_si128(_mm_loadu_si128(s + 3), k3));
+    }
+    // i 是条带长度的整数倍，尾部与条带起点对齐
+    xorScalar(src + i, dst + i, size - i, stripe);
+}
+
+__attribute__((target("avx2")))
+void xorAvx2(const char *src, char *dst, qsizetype size, const char *stripe)
+{
+    const __m256i k0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(stripe));
+    const __m256i k1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(stripe + 32));
+    qsizetype i = 0;
+    for (; i + StripeSize <= size; i += StripeSize) {
+        const __m256i *s = reinterpret_cast<const __m256i *>(src + i);
+        __m256i *d = reinterpret_cast<__m256i *>(dst + i);
+        _mm256_storeu_si256(d + 0, _mm256_xor_si256(_mm256_loadu_si256(s + 0), k0));
+        _mm256_storeu_si256(d + 1, _mm256_xor_si256(_mm256_loadu_si256(s + 1), k1));
+    }
+    xorScalar(src + i, dst + i, size - i, stripe);
+}
+
+__attribute__((target("avx512f")))
+void xorAvx512(const char *src, char *dst, qsizetype size, const char *stripe)
+{
+    const __m512i k = _mm512_loadu_si512(stripe);
+    qsizetype i = 0;
+    for (; i + StripeSize <= size; i += StripeSize) {
+        _mm512_storeu_si512(dst + i, _mm512_xor_si512(_mm512_loadu_si512(src + i), k));
+    }
+    xorScalar(src + i, dst + i, size - i, stripe);
+}
+#endif
+
+/**
+ * @brief 运行时根据 CPU 特性选择内核，只探测一次
+ */
+XorKernel selectXorKernel()
+{
+#ifdef CIPHER_BACKEND_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return xorAvx512;
+    if (__builtin_cpu_supports("avx2")) return xorAvx2;
+    if (__builtin_cpu_supports("sse2")) return xorSse2;
+#endif
+    return xorScalar;
+}
+
+class XorCipher : public CipherBackend
+{
+public:
+    explicit XorCipher(const QByteArray &key) : m_key(key) {}
+
+    CipherAlgorithm algorithm() const override { return CipherAlgorithm::Xor; }
+    const char *name() const override { return "xor"; }
+
+    /**
+     * 密钥长度能整除条带长度时(SHA-256 密钥为 32 字节)，先把密钥从 offset 对应的相位开始
+     * 展开成 64 字节条带，再交给运行时选出的向量内核；否则退回到不取模的逐字节循环。
+     */
+    void process(const char *src, char *dst, qsizetype size, qint64 offset) const override
+    {
+        const qsizetype keyLen = m_key.size();
+        if (size <= 0) return;
+        // 如果密钥为空，则保持原数据
+        if (keyLen <= 0) {
+            if (src != dst) memcpy(dst, src, size_t(size));
+            return;
+        }
+
+        const char *k = m_key.constData();
+        const qsizetype phase = qsizetype(offset % keyLen);
+        if (StripeSize % keyLen == 0) {
+            static const XorKernel kernel = selectXorKernel();
+            char stripe[StripeSize];
+            for (qsizetype i = 0; i < StripeSize; ++i)
+                stripe[i] = k[(phase + i) % keyLen];
+            kernel(src, dst, size, stripe);
+            return;
+        }
+
+        qsizetype j = phase;
+        for (qsizetype i = 0; i < size; ++i) {
+            dst[i] = src[i] ^ k[j];
+            if (++j == keyLen) j = 0;
+        }
+    }
+
+private:
+    const QByteArray m_key;
+};
+
+// ---------------------------------------------------------------------------
+// AES-256-CTR 后端
+// ---------------------------------------------------------------------------
+
+constexpr int AesRounds = 14;
+constexpr int AesBlockSize = 16;
+constexpr int AesRoundKeysSize = (AesRounds + 1) * AesBlockSize;
+
+// 软件实现一次处理的块数：4 个块共 64 字节，正好填满位切片的 64 个通道
+constexpr int SoftwareLanes = 4;
+constexpr int SoftwareBatch = SoftwareLanes * AesBlockSize;
+
+/*
+ * 软件实现不使用查找表：SubBytes 用位切片的布尔电路计算，其余步骤都是固定下标的字节/字运算，
+ * 执行的指令和访存地址与密钥、明文无关(常数时间)。
+ */
+
+/**
+ * @brief 位切片转置：把 8 个 64 位字(64 字节)重排为 8 个位平面，q[j] 是所有字节的第 j 位
+ * 变换是对合的，再做一次即还原
+ */
+inline void swapBits(quint64 &x, quint64 &y, quint64 lowMask, int shift)
+{
+    const quint64 a = x;
+    const quint64 b = y;
+    x = (a & lowMask) | ((b & lowMask) << shift);
+    y = ((a >> shift) & lowMask) | (b & ~lowMask);
+}
+
+void ortho(quint64 *q)
+{
+    const quint64 m1 = 0x5555555555555555ull;
+    const quint64 m2 = 0x3333333333333333ull;
+    const quint64 m4 = 0x0f0f0f0f0f0f0f0full;
+    swapBits(q[0], q[1], m1, 1);
+    swapBits(q[2], q[3], m1, 1);
+    swapBits(q[4], q[5], m1, 1);
+    swapBits(q[6], q[7], m1, 1);
+    swapBits(q[0], q[2], m2, 2);
+    swapBits(q[1], q[3], m2, 2);
+    swapBits(q[4], q[6], m2, 2);
+    swapBits(q[5], q[7], m2, 2);
+    swapBits(q[0], q[4], m4, 4);
+    swapBits(q[1], q[5], m4, 4);
+    swapBits(q[2], q[6], m4, 4);
+    swapBits(q[3], q[7], m4, 4);
+}
+
+/**
+ * @brief 位切片 S 盒(Boyar-Peralta 电路)，同时处理 64 个字节
+ * 只有与、异或、取反运算，没有查表和分支
+ */
+void sboxBitsliced(quint64 *q)
+{
+    const quint64 x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+    const quint64 x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+    // 顶层线性变换
+    const quint64 y14 = x3 ^ x5;
+    const quint64 y13 = x0 ^ x6;
+    const quint64 y9 = x0 ^ x3;
+    const quint64 y8 = x0 ^ x5;
+    const quint64 t0 = x1 ^ x2;
+    const quint64 y1 = t0 ^ x7;
+    const quint64 y4 = y1 ^ x3;
+    const quint64 y12 = y13 ^ y14;
+    const quint64 y2 = y1 ^ x0;
+    const quint64 y5 = y1 ^ x6;
+    const quint64 y3 = y5 ^ y8;
+    const quint64 t1 = x4 ^ y12;
+    const quint64 y15 = t1 ^ x5;
+    const quint64 y20 = t1 ^ x1;
+    const quint64 y6 = y15 ^ x7;
+    const quint64 y10 = y15 ^ t0;
+    const quint64 y11 = y20 ^ y9;
+    const quint64 y7 = x7 ^ y11;
+    const quint64 y17 = y10 ^ y11;
+    const quint64 y19 = y10 ^ y8;
+    const quint64 y16 = t0 ^ y11;
+    const quint64 y21 = y13 ^ y16;
+    const quint64 y18 = x0 ^ y16;
+
+    // 非线性部分(GF(2^4) 塔域求逆)
+    const quint64 t2 = y12 & y15;
+    const quint64 t3 = y3 & y6;
+    const quint64 t4 = t3 ^ t2;
+    const quint64 t5 = y4 & x7;
+    const quint64 t6 = t5 ^ t2;
+    const quint64 t7 = y13 & y16;
+    const quint64 t8 = y5 & y1;
+    const quint64 t9 = t8 ^ t7;
+    const quint64 t10 = y2 & y7;
+    const quint64 t11 = t10 ^ t7;
+    const quint64 t12 = y9 & y11;
+    const quint64 t13 = y14 & y17;
+    const quint64 t14 = t13 ^ t12;
+    const quint64 t15 = y8 & y10;
+    const quint64 t16 = t15 ^ t12;
+    const quint64 t17 = t4 ^ t14;
+    const quint64 t18 = t6 ^ t16;
+    const quint64 t19 = t9 ^ t14;
+    const quint64 t20 = t11 ^ t16;
+    const quint64 t21 = t17 ^ y20;
+    const quint64 t22 = t18 ^ y19;
+    const quint64 t23 = t19 ^ y21;
+    const quint64 t24 = t20 ^ y18;
+    const quint64 t25 = t21 ^ t22;
+    const quint64 t26 = t21 & t23;
+    const quint64 t27 = t24 ^ t26;
+    const quint64 t28 = t25 & t27;
+    const quint64 t29 = t28 ^ t22;
+    const quint64 t30 = t23 ^ t24;
+    const quint64 t31 = t22 ^ t26;
+    const quint64 t32 = t31 & t30;
+    const quint64 t33 = t32 ^ t24;
+    const quint64 t34 = t23 ^ t33;
+    const quint64 t35 = t27 ^ t33;
+    const quint64 t36 = t24 & t35;
+    const quint64 t37 = t36 ^ t34;
+    const quint64 t38 = t27 ^ t36;
+    const quint64 t39 = t29 & t38;
+    const quint64 t40 = t25 ^ t39;
+    const quint64 t41 = t40 ^ t37;
+    const quint64 t42 = t29 ^ t33;
+    const quint64 t43 = t29 ^ t40;
+    const quint64 t44 = t33 ^ t37;
+    const quint64 t45 = t42 ^ t41;
+    const quint64 z0 = t44 & y15;
+    const quint64 z1 = t37 & y6;
+    const quint64 z2 = t33 & x7;
+    const quint64 z3 = t43 & y16;
+    const quint64 z4 = t40 & y1;
+    const quint64 z5 = t29 & y7;
+    const quint64 z6 = t42 & y11;
+    const quint64 z7 = t45 & y17;
+    const quint64 z8 = t41 & y10;
+    const quint64 z9 = t44 & y12;
+    const quint64 z10 = t37 & y3;
+    const quint64 z11 = t33 & y4;
+    const quint64 z12 = t43 & y13;
+    const quint64 z13 = t40 & y5;
+    const quint64 z14 = t29 & y2;
+    const quint64 z15 = t42 & y9;
+    const quint64 z16 = t45 & y14;
+    const quint64 z17 = t41 & y8;
+
+    // 底层线性变换(含仿射常量 0x63)
+    const quint64 t46 = z15 ^ z16;
+    const quint64 t47 = z10 ^ z11;
+    const quint64 t48 = z5 ^ z13;
+    const quint64 t49 = z9 ^ z10;
+    const quint64 t50 = z2 ^ z12;
+    const quint64 t51 = z2 ^ z5;
+    const quint64 t52 = z7 ^ z8;
+    const quint64 t53 = z0 ^ z3;
+    const quint64 t54 = z6 ^ z7;
+    const quint64 t55 = z16 ^ z17;
+    const quint64 t56 = z12 ^ t48;
+    const quint64 t57 = t50 ^ t53;
+    const quint64 t58 = z4 ^ t46;
+    const quint64 t59 = z3 ^ t54;
+    const quint64 t60 = t46 ^ t57;
+    const quint64 t61 = z14 ^ t57;
+    const quint64 t62 = t52 ^ t58;
+    const quint64 t63 = t49 ^ t58;
+    const quint64 t64 = z4 ^ t59;
+    const quint64 t65 = t61 ^ t62;
+    const quint64 t66 = z1 ^ t63;
+    const quint64 s0 = t59 ^ t63;
+    const quint64 s6 = t56 ^ ~t62;
+    const quint64 s7 = t48 ^ ~t60;
+    const quint64 t67 = t64 ^ t65;
+    const quint64 s3 = t53 ^ t66;
+    const quint64 s4 = t51 ^ t66;
+    const quint64 s5 = t47 ^ t65;
+    const quint64 s1 = t64 ^ ~s3;
+    const quint64 s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/**
+ * @brief 对 64 字节同时做 SubBytes
+ */
+void subBytes64(quint8 *bytes)
+{
+    quint64 q[8];
+    memcpy(q, bytes, sizeof(q));
+    ortho(q);
+    sboxBitsliced(q);
+    ortho(q);
+    memcpy(bytes, q, sizeof(q));
+}
+
+inline quint8 xtime8(quint8 x)
+{
+    return quint8((x << 1) ^ (0x1b & -(x >> 7)));
+}
+
+// 打包在 32 位字中的 4 个字节分别乘以 2
+inline quint32 xtime32(quint32 x)
+{
+    return ((x & 0x7f7f7f7fu) << 1) ^ (((x >> 7) & 0x01010101u) * 0x1b);
+}
+
+inline quint32 rotr32(quint32 x, int n)
+{
+    return (x >> n) | (x << (32 - n));
+}
+
+/**
+ * @brief AES-256 密钥扩展(FIPS-197 5.2),只在创建后端时执行一次
+ */
+void expandKey(const quint8 *key, quint8 *roundKeys)
+{
+    memcpy(roundKeys, key, 32);
+    quint8 rcon = 0x01;
+    for (int i = 8; i < 4 * (AesRounds + 1); ++i) {
+        quint8 temp[SoftwareBatch] = {};
+        memcpy(temp, roundKeys + 4 * (i - 1), 4);
+        if (i % 8 == 0) {
+            const quint8 t = temp[0];
+            temp[0] = temp[1];
+            temp[1] = temp[2];
+            temp[2] = temp[3];
+            temp[3] = t;
+            subBytes64(temp);
+            temp[0] ^= rcon;
+            rcon = xtime8(rcon);
+        } else if (i % 8 == 4) {
+            subBytes64(temp);
+        }
+        for (int j = 0; j < 4; ++j)
+            roundKeys[4 * i + j] = roundKeys[4 * (i - 8) + j] ^ temp[j];
+    }
+}
+
+inline void addRoundKey(quint8 *state, const quint8 *roundKey)
+{
+    for (int b = 0; b < SoftwareLanes; ++b)
+        for (int i = 0; i < AesBlockSize; ++i)
+            state[b * AesBlockSize + i] ^= roundKey[i];
+}
+
+/**
+ * @brief 同时加密 4 个块(64 字节)
+ */
+void encryptBlocksSoftware(const quint8 *roundKeys, quint8 *state)
+{
+    addRoundKey(state, roundKeys);
+    for (int round = 1; round <= AesRounds; ++round) {
+        subBytes64(state);
+        for (int b = 0; b < SoftwareLanes; ++b) {
+            quint8 *s = state + b * AesBlockSize;
+            // ShiftRows：状态按列存储，第 r 行循环左移 r 个字节
+            quint8 t[AesBlockSize];
+            for (int c = 0; c < 4; ++c)
+                for (int r = 0; r < 4; ++r)
+                    t[r + 4 * c] = s[r + 4 * ((c + r) % 4)];
+            if (round != AesRounds) {
+                // MixColumns：每列打包成一个小端 32 位字，out_i = a_i ^ all ^ 2·(a_i ^ a_{i+1})
+                for (int c = 0; c < 4; ++c) {
+                    const quint32 col = qFromLittleEndian<quint32>(t + 4 * c);
+                    const quint32 pair = col ^ rotr32(col, 8);
+                    const quint32 all = pair ^ rotr32(pair, 16);
+                    qToLittleEndian<quint32>(col ^ all ^ xtime32(pair), t + 4 * c);
+                }
+            }
+            memcpy(s, t, AesBlockSize);
+        }
+        addRoundKey(state, roundKeys + round * AesBlockSize);
+    }
+}
+
+/**
+ * @brief 计数器块：IV 高 8 字节不变，低 8 字节按大端序加上块序号
+ */
+inline void counterBlock(const quint8 *iv, quint64 index, quint8 *out)
+{
+    memcpy(out, iv, 8);
+    qToBigEndian<quint64>(qFromBigEndian<quint64>(iv + 8) + index, out + 8);
+}
+
+using CtrKernel = void (*)(const quint8 *roundKeys, const quint8 *iv, quint64 firstBlock,
+                           const char *src, char *dst, qsizetype blocks);
+
+void ctrSoftware(const quint8 *roundKeys, const quint8 *iv, quint64 firstBlock,
+                 const char *src, char *dst, qsizetype blocks)
+{
+    quint8 ks[SoftwareBatch];
+    for (qsizetype b = 0; b < blocks; b += SoftwareLanes) {
+        const qsizetype n = qMin<qsizetype>(SoftwareLanes, blocks - b);
+        for (qsizetype j = 0; j < SoftwareLanes; ++j)
+            counterBlock(iv, firstBlock + quint64(b + j), ks + j * AesBlockSize);
+        encryptBlocksSoftware(roundKeys, ks);
+        const qsizetype pos = b * AesBlockSize;
+        for (qsizetype i = 0; i < n * AesBlockSize; ++i)
+            dst[pos + i] = char(src[pos + i] ^ ks[i]);
+    }
+}
+
+#ifdef CIPHER_BACKEND_X86_DISPATCH
+/**
+ * @brief AES-NI 内核：8 个计数器块交错执行以填满 AESENC 流水线
+ * 计数器直接在寄存器中构造：低 64 位是 IV 前 8 字节，高 64 位是字节序翻转后的块计数
+ */
+__attribute__((target("aes,sse2")))
+void ctrAesNi(const quint8 *roundKeys, const quint8 *iv, quint64 firstBlock,
+              const char *src, char *dst, qsizetype blocks)
+{
+    __m128i rk[AesRounds + 1];
+    for (int r = 0; r <= AesRounds; ++r)
+        rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(roundKeys + r * AesBlockSize));
+
+    const long long nonce = qFromLittleEndian<qint64>(iv);
+    const quint64 counter = qFromBigEndian<quint64>(iv + 8) + firstBlock;
+    auto counterAt = [&](qsizetype b) {
+        return _mm_set_epi64x(qint64(qbswap<quint64>(counter + quint64(b))), nonce);
+    };
+
+    constexpr int Lanes = 8;
+    qsizetype b = 0;
+    for (; b + Lanes <= blocks; b += Lanes) {
+        __m128i x[Lanes];
+        for (int j = 0; j < Lanes; ++j)
+            x[j] = _mm_xor_si128(counterAt(b + j), rk[0]);
+        for (int r = 1; r < AesRounds; ++r)
+            for (int j = 0; j < Lanes; ++j)
+                x[j] = _mm_aesenc_si128(x[j], rk[r]);
+        for (int j = 0; j < Lanes; ++j) {
+            x[j] = _mm_aesenclast_si128(x[j], rk[AesRounds]);
+            const qsizetype pos = (b + j) * AesBlockSize;
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + pos), _mm_xor_si128(in, x[j]));
+        }
+    }
+    for (; b < blocks; ++b) {
+        __m128i x = _mm_xor_si128(counterAt(b), rk[0]);
+        for (int r = 1; r < AesRounds; ++r)
+            x = _mm_aesenc_si128(x, rk[r]);
+        x = _mm_aesenclast_si128(x, rk[AesRounds]);
+        const qsizetype pos = b * AesBlockSize;
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + pos));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + pos), _mm_xor_si128(in, x));
+    }
+}
+#endif
+
+bool cpuHasAesNi()
+{
+#ifdef CIPHER_BACKEND_X86_DISPATCH
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("aes") && __builtin_cpu_supports("sse2");
+#else
+    return false;
+#endif
+}
+
+class Aes256CtrCipher : public CipherBackend
+{
+public:
+    Aes256CtrCipher(const QByteArray &key, const QByteArray &iv, bool allowHardware)
+    {
+        expandKey(reinterpret_cast<const quint8 *>(key.constData()), m_roundKeys);
+        memcpy(m_iv, iv.constData(), AesBlockSize);
+        m_kernel = ctrSoftware;
+#ifdef CIPHER_BACKEND_X86_DISPATCH
+        if (allowHardware && CipherBackend::hardwareAesAvailable())
+            m_kernel = ctrAesNi;
+#else
+        Q_UNUSED(allowHardware);
+#endif
+    }
+
+    ~Aes256CtrCipher() override
+    {
+        // 轮密钥属于敏感数据，释放前清零
+        volatile quint8 *p = m_roundKeys;
+        for (int i = 0; i < AesRoundKeysSize; ++i)
+            p[i] = 0;
+    }
+
+    CipherAlgorithm algorithm() const override { return CipherAlgorithm::Aes256Ctr; }
+    const char *name() const override
+    {
+        return m_kernel == ctrSoftware ? "aes-256-ctr/software" : "aes-256-ctr/aes-ni";
+    }
+
+    void process(const char *src, char *dst, qsizetype size, qint64 offset) const override
+    {
+        if (size <= 0) return;
+        quint64 block = quint64(offset) / AesBlockSize;
+        const int intra = int(offset % AesBlockSize);
+
+        // 起始偏移不在块边界上：单独处理第一个不完整的块
+        if (intra != 0) {
+            const qsizetype n = qMin<qsizetype>(AesBlockSize - intra, size);
+            partialBlock(block, intra, src, dst, n);
+            src += n;
+            dst += n;
+            size -= n;
+            ++block;
+        }
+
+        const qsizetype blocks = size / AesBlockSize;
+        m_kernel(m_roundKeys, m_iv, block, src, dst, blocks);
+
+        const qsizetype tail = size - blocks * AesBlockSize;
+        if (tail > 0) {
+            const qsizetype pos = blocks * AesBlockSize;
+            partialBlock(block + quint64(blocks), 0, src + pos, dst + pos, tail);
+        }
+    }
+
+private:
+    void partialBlock(quint64 block, int intra, const char *src, char *dst, qsizetype n) const
+    {
+        char in[AesBlockSize] = {};
+        char out[AesBlockSize];
+        memcpy(in + intra, src, size_t(n));
+        m_kernel(m_roundKeys, m_iv, block, in, out, 1);
+        memcpy(dst, out + intra, size_t(n));
+    }
+
+    quint8 m_roundKeys[AesRoundKeysSize];
+    quint8 m_iv[AesBlockSize];
+    CtrKernel m_kernel;
+};
+
+} // namespace
+
+std::unique_ptr<CipherBackend> CipherBackend::create(CipherAlgorithm algorithm, const DerivedKey &key,
+                                                     const QByteArray &iv, bool allowHardware)
+{
+    switch (algorithm) {
+    case CipherAlgorithm::Xor:
+        return std::make_unique<XorCipher>(key.material());
+    case CipherAlgorithm::Aes256Ctr:
+        if (key.material().size() != 32 || iv.size() != AesBlockSize) return nullptr;
+        return std::make_unique<Aes256CtrCipher>(key.material(), iv, allowHardware);
+    }
+    return nullptr;
+}
+
+bool CipherBackend::hardwareAesAvailable()
+{
+    static const bool available = cpuHasAesNi();
+    return available;
+}
@@ -0,0 +1,48 @@
+#ifndef CIPHERBACKEND_H
+#define CIPHERBACKEND_H
+
+#include <QByteArray>
+#include <memory>
+
+#include "ResourceEncryption.h"
+
+/**
+ * @brief 可插拔的加密后端接口
+ * 所有后端都是流密码:加密与解密是同一操作,并且可以从任意偏移开始处理,
+ * 因此同一接口同时服务于整体解密和按块流式解密。
+ */
+class CipherBackend
+{
+public:
+    virtual ~CipherBackend() = default;
+
+    virtual CipherAlgorithm algorithm() const = 0;
+    virtual const char *name() const = 0;
+
+    /**
+     * @brief 从密钥流的 offset 处开始处理 size 字节
+     * @param src 输入地址
+     * @param dst 输出地址,可以与 src 相同(原地处理)
+     * @param size 长度
+     * @param offset src 第 0 个字节在整个数据流中的偏移
+     */
+    virtual void process(const char *src, char *dst, qsizetype size, qint64 offset) const = 0;
+
+    /**
+     * @brief 创建加密后端
+     * @param algorithm 算法
+     * @param key 派生密钥
+     * @param iv 16 字节初始向量(XOR 忽略)
+     * @param allowHardware 是否允许使用 AES-NI 等硬件加速(基准测试中用于对比软件实现)
+     * @return 后端实例,参数无效时返回 nullptr
+     */
+    static std::unique_ptr<CipherBackend> create(CipherAlgorithm algorithm, const DerivedKey &key,
+                                                 const QByteArray &iv, bool allowHardware = true);
+
+    /**
+     * @brief 当前 CPU 是否支持 AES-NI
+     */
+    static bool hardwareAesAvailable();
+};
+
+#endif // CIPHERBACKEND_H
@@ -0,0 +1,423 @@
+#include "EncryptedArchive.h"
+#include "ResourcePath.h"
+#include <QDebug>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+template <typename T>
+T readLE(const uchar *p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+template <typename T>
+void appendLE(QByteArray &out, T value)
+{
+    uchar buf[sizeof(T)];
+    qToLittleEndian<T>(value, buf);
+    out.append(reinterpret_cast<const char *>(buf), sizeof(T));
+}
+
+int compareBytes(const char *a, qsizetype aSize, const char *b, qsizetype bSize)
+{
+    const int r = memcmp(a, b, size_t(qMin(aSize, bSize)));
+    if (r != 0) return r;
+    return aSize < bSize ? -1 : (aSize > bSize ? 1 : 0);
+}
+
+// 把 64 位混合值均匀映射到 [0, range),用乘法代替取模
+quint32 reduceRange(quint64 x, quint32 range)
+{
+    return quint32(((x >> 32) * range) >> 32);
+}
+
+// 把已写出的数据提交到磁盘;flush() 只交给操作系统缓存,掉电时仍可能丢失或乱序落盘
+bool syncFile(QFile &file)
+{
+    if (!file.flush()) return false;
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(HANDLE(_get_osfhandle(file.handle())));
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+// 单个桶尝试的种子数上限,超过后换全局种子重新构建
+constexpr quint32 MaxBucketSeed = 1u << 22;
+constexpr int MaxGlobalSeeds = 16;
+
+} // namespace
+
+quint32 EncryptedArchive::perfectHashBucket(quint64 hash, quint32 seed, quint32 buckets)
+{
+    return reduceRange(resourceHashMix(hash ^ seed), buckets);
+}
+
+quint32 EncryptedArchive::perfectHashSlot(quint64 hash, quint32 seed, quint32 bucketSeed, quint32 slots)
+{
+    return reduceRange(resourceHashMix(hash + (quint64(seed) << 32 | bucketSeed) * 0x9e3779b97f4a7c15ULL), slots);
+}
+
+bool EncryptedArchive::open(const QString &fileName)
+{
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(QStringLiteral("无法打开归档: %1").arg(fileName));
+
+    m_size = m_file.size();
+    if (uchar *mapped = m_file.map(0, m_size)) {
+        m_data = mapped;
+    } else {
+        // 压缩过的 qrc 资源无法映射，只能整体读入
+        m_buffer = m_file.readAll();
+        m_data = reinterpret_cast<const uchar *>(m_buffer.constData());
+    }
+
+    if (m_size < HeaderSize || memcmp(m_data, Magic, sizeof(Magic)) != 0)
+        return fail(QStringLiteral("不是有效的资源归档: %1").arg(fileName));
+    // 版本 1(排序索引,二分查找)仍可读取,重新打包即升级为完美哈希索引
+    m_version = readLE<quint32>(m_data + 4);
+    if (m_version != 1 && m_version != Version)
+        return fail(QStringLiteral("不支持的归档版本: %1").arg(m_version));
+
+    m_entryCount = readLE<quint32>(m_data + 8);
+    m_hashSeed = readLE<quint32>(m_data + 12);
+    const quint64 indexOffset = readLE<quint64>(m_data + 16);
+    const quint64 indexSize = readLE<quint64>(m_data + 24);
+    const quint64 recordsSize = quint64(m_entryCount) * RecordSize;
+    const quint64 seedsSize = m_version >= 2 ? quint64(bucketCount(m_entryCount)) * 4 : 0;
+    if (indexOffset > quint64(m_size) || indexSize > quint64(m_size) - indexOffset
+        || recordsSize + seedsSize > indexSize)
+        return fail(QStringLiteral("归档索引越界: %1").arg(fileName));
+
+    m_index = m_data + indexOffset;
+    m_usedSize = qint64(indexOffset + indexSize);
+    m_bucketSeeds = m_index + recordsSize;
+    m_strings = m_bucketSeeds + seedsSize;
+    m_stringsSize = qint64(indexSize - recordsSize - seedsSize);
+
+    quint64 liveBytes = 0;
+    for (int i = 0; i < int(m_entryCount); ++i) {
+        const uchar *r = record(i);
+        const quint64 pathOffset = readLE<quint32>(r + 16);
+        const quint64 pathSize = readLE<quint32>(r + 20);
+        const quint64 dataOffset = readLE<quint64>(r);
+        const quint64 dataSize = readLE<quint64>(r + 8);
+        if (pathOffset + pathSize > quint64(m_stringsSize)
+            || dataOffset > quint64(m_size) || dataSize > quint64(m_size) - dataOffset)
+            return fail(QStringLiteral("归档条目越界: %1 #%2").arg(fileName).arg(i));
+        liveBytes += dataSize;
+    }
+    m_unusedBytes = qMax<qint64>(0, qint64(indexOffset) - HeaderSize - qint64(liveBytes));
+
+    qDebug() << "[Archive] 已打开资源归档:" << fileName << "条目数:" << m_entryCount;
+    return true;
+}
+
+QStringList EncryptedArchive::entryPaths() const
+{
+    QStringList paths;
+    paths.reserve(int(m_entryCount));
+    for (int i = 0; i < int(m_entryCount); ++i)
+        paths.append(QString::fromUtf8(recordPath(i)));
+    return paths;
+}
+
+bool EncryptedArchive::contains(const QString &path) const
+{
+    return findEntry(ResourcePath(path)) >= 0;
+}
+
+bool EncryptedArchive::contains(const ResourcePath &path) const
+{
+    return findEntry(path) >= 0;
+}
+
+QByteArray EncryptedArchive::entryData(const QString &path, quint32 *flags) const
+{
+    QByteArray data;
+    lookup(path, &data, flags);
+    return data;
+}
+
+bool EncryptedArchive::lookup(const QString &path, QByteArray *data, quint32 *flags) const
+{
+    return lookup(ResourcePath(path), data, flags);
+}
+
+bool EncryptedArchive::lookup(const ResourcePath &path, QByteArray *data, quint32 *flags) const
+{
+    const int index = findEntry(path);
+    if (index < 0) return false;
+
+    const uchar *r = record(index);
+    const quint64 dataOffset = readLE<quint64>(r);
+    const quint64 dataSize = readLE<quint64>(r + 8);
+    if (flags) *flags = readLE<quint32>(r + 24);
+    *data = QByteArray::fromRawData(reinterpret_cast<const char *>(m_data + dataOffset),
+                                    qsizetype(dataSize));
+    return true;
+}
+
+bool EncryptedArchive::entryRange(const QString &path, quint64 *offset, quint64 *size, quint32 *flags) const
+{
+    const int index = findEntry(ResourcePath(path));
+    if (index < 0) return false;
+
+    const uchar *r = record(index);
+    *offset = readLE<quint64>(r);
+    *size = readLE<quint64>(r + 8);
+    if (flags) *flags = readLE<quint32>(r + 24);
+    return true;
+}
+
+int EncryptedArchive::findEntry(const ResourcePath &path) const
+{
+    if (!isOpen() || m_entryCount == 0) return -1;
+    const QByteArrayView utf8Path = path.utf8();
+
+    if (m_version >= 2) {
+        // 完美哈希直接给出唯一候选，只需确认它就是要找的路径
+        const quint32 bucket = perfectHashBucket(path.hash(), m_hashSeed, bucketCount(m_entryCount));
+        const quint32 bucketSeed = readLE<quint32>(m_bucketSeeds + bucket * 4);
+        const int slot = int(perfectHashSlot(path.hash(), m_hashSeed, bucketSeed, m_entryCount));
+        const uchar *r = record(slot);
+        if (readLE<quint32>(r + 28) != quint32(path.hash())) return -1;
+        const quint32 size = readLE<quint32>(r + 20);
+        if (size != quint32(utf8Path.size())) return -1;
+        return memcmp(m_strings + readLE<quint32>(r + 16), utf8Path.data(), size) == 0 ? slot : -1;
+    }
+
+    // 版本 1:记录表按路径字节序排序，二分查找
+    int lo = 0;
+    int hi = int(m_entryCount) - 1;
+    while (lo <= hi) {
+        const int mid = lo + (hi - lo) / 2;
+        const uchar *r = record(mid);
+        const char *name = reinterpret_cast<const char *>(m_strings + readLE<quint32>(r + 16));
+        const int cmp = compareBytes(name, readLE<quint32>(r + 20),
+                                     utf8Path.data(), utf8Path.size());
+        if (cmp == 0) return mid;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+QByteArray EncryptedArchive::recordPath(int index) const
+{
+    const uchar *r = record(index);
+    return QByteArray(reinterpret_cast<const char *>(m_strings + readLE<quint32>(r + 16)),
+                      qsizetype(readLE<quint32>(r + 20)));
+}
+
+bool EncryptedArchive::fail(const QString &message)
+{
+    qWarning() << "[Archive]" << message;
+    m_errorString = message;
+    // 解除映射并关闭文件，失败的归档不再占用映射和文件句柄
+    if (m_data && m_buffer.isEmpty())
+        m_file.unmap(const_cast<uchar *>(m_data));
+    m_file.close();
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_index = m_bucketSeeds = m_strings = nullptr;
+    m_entryCount = 0;
+    m_version = 0;
+    return false;
+}
+
+// EncryptedArchiveWriter 实现
+EncryptedArchiveWriter::EncryptedArchiveWriter(const QString &fileName)
+    : m_file(fileName)
+{
+}
+
+bool EncryptedArchiveWriter::open()
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return fail(QStringLiteral("无法创建归档: %1").arg(m_file.fileName()));
+    // 先写占位头部，finish() 时回填
+    const QByteArray placeholder(EncryptedArchive::HeaderSize, '\0');
+    if (m_file.write(placeholder) != placeholder.size())
+        return fail(QStringLiteral("写入归档失败: %1").arg(m_file.fileName()));
+    return true;
+}
+
+bool EncryptedArchiveWriter::openForAppend(qint64 usedSize)
+{
+    if (!m_file.open(QIODevice::ReadWrite))
+        return fail(QStringLiteral("无法打开归档: %1").arg(m_file.fileName()));
+    if (usedSize < EncryptedArchive::HeaderSize || !m_file.resize(usedSize) || !m_file.seek(usedSize))
+        return fail(QStringLiteral("无法截断归档: %1").arg(m_file.fileName()));
+    const qint64 padding = (8 - usedSize % 8) % 8;
+    if (padding > 0 && m_file.write(QByteArray(padding, '\0')) != padding)
+        return fail(QStringLiteral("写入归档失败: %1").arg(m_file.fileName()));
+    return true;
+}
+
+void EncryptedArchiveWriter::addExistingEntry(const QString &path, quint64 offset, quint64 size, quint32 flags)
+{
+    PendingEntry entry;
+    entry.path = path.toUtf8();
+    entry.offset = offset;
+    entry.size = size;
+    entry.flags = flags;
+    m_entries.append(entry);
+}
+
+bool EncryptedArchiveWriter::addEntry(const QString &path, const QByteArray &data, quint32 flags)
+{
+    PendingEntry entry;
+    entry.path = path.toUtf8();
+    entry.offset = quint64(m_file.pos());
+    entry.size = quint64(data.size());
+    entry.flags = flags;
+
+    if (m_file.write(data) != data.size())
+        return fail(QStringLiteral("写入归档失败: %1").arg(path));
+    // 按 8 字节对齐下一个条目
+    const qint64 padding = (8 - m_file.pos() % 8) % 8;
+    if (padding > 0 && m_file.write(QByteArray(padding, '\0')) != padding)
+        return fail(QStringLiteral("写入归档失败: %1").arg(path));
+
+    m_entries.append(entry);
+    return true;
+}
+
+bool EncryptedArchiveWriter::finish()
+{
+    std::sort(m_entries.begin(), m_entries.end(),
+              [](const PendingEntry &a, const PendingEntry &b) { return a.path < b.path; });
+    for (int i = 1; i < m_entries.size(); ++i) {
+        if (m_entries[i].path == m_entries[i - 1].path)
+            return fail(QStringLiteral("归档条目重复: %1").arg(QString::fromUtf8(m_entries[i].path)));
+    }
+
+    // 不同路径的 64 位哈希相同时任何种子都无法区分，只能报错
+    QList<quint64> hashes;
+    hashes.reserve(m_entries.size());
+    for (PendingEntry &entry : m_entries) {
+        entry.hash = resourcePathHash(entry.path);
+        hashes.append(entry.hash);
+    }
+    std::sort(hashes.begin(), hashes.end());
+    if (std::adjacent_find(hashes.cbegin(), hashes.cend()) != hashes.cend())
+        return fail(QStringLiteral("归档路径哈希冲突,请重命名资源后重试"));
+
+    quint32 seed = 0;
+    QList<quint32> slots;
+    QList<quint32> bucketSeeds;
+    while (!buildPerfectHash(seed, &slots, &bucketSeeds)) {
+        if (++seed == MaxGlobalSeeds)
+            return fail(QStringLiteral("无法为归档索引构建完美哈希: %1").arg(m_file.fileName()));
+    }
+
+    // 记录按槽位排列,路径字符串仍按路径顺序写出
+    QByteArray records(m_entries.size() * EncryptedArchive::RecordSize, '\0');
+    QByteArray strings;
+    for (int i = 0; i < m_entries.size(); ++i) {
+        const PendingEntry &entry = m_entries.at(i);
+        uchar *r = reinterpret_cast<uchar *>(records.data()) + slots.at(i) * EncryptedArchive::RecordSize;
+        qToLittleEndian<quint64>(entry.offset, r);
+        qToLittleEndian<quint64>(entry.size, r + 8);
+        qToLittleEndian<quint32>(quint32(strings.size()), r + 16);
+        qToLittleEndian<quint32>(quint32(entry.path.size()), r + 20);
+        qToLittleEndian<quint32>(entry.flags, r + 24);
+        qToLittleEndian<quint32>(quint32(entry.hash), r + 28);
+        strings.append(entry.path);
+    }
+    QByteArray seeds;
+    seeds.reserve(bucketSeeds.size() * 4);
+    for (const quint32 bucketSeed : std::as_const(bucketSeeds))
+        appendLE<quint32>(seeds, bucketSeed);
+
+    const quint64 indexOffset = quint64(m_file.pos());
+    const QByteArray index = records + seeds + strings;
+    if (m_file.write(index) != index.size())
+        return fail(QStringLiteral("写入归档索引失败: %1").arg(m_file.fileName()));
+
+    // 数据和索引先落盘,头部最后写入,中断或掉电时旧头部仍然指向完整的旧索引
+    if (!syncFile(m_file))
+        return fail(QStringLiteral("写入归档索引失败: %1").arg(m_file.fileName()));
+
+    QByteArray header(EncryptedArchive::Magic, sizeof(EncryptedArchive::Magic));
+    appendLE<quint32>(header, EncryptedArchive::Version);
+    appendLE<quint32>(header, quint32(m_entries.size()));
+    appendLE<quint32>(header, seed);
+    appendLE<quint64>(header, indexOffset);
+    appendLE<quint64>(header, quint64(index.size()));
+    if (!m_file.seek(0) || m_file.write(header) != header.size() || !syncFile(m_file))
+        return fail(QStringLiteral("写入归档头部失败: %1").arg(m_file.fileName()));
+
+    m_file.close();
+    return true;
+}
+
+bool EncryptedArchiveWriter::buildPerfectHash(quint32 seed, QList<quint32> *slots,
+                                              QList<quint32> *bucketSeeds) const
+{
+    const quint32 count = quint32(m_entries.size());
+    const quint32 buckets = EncryptedArchive::bucketCount(count);
+    QList<QList<int>> members(buckets);
+    for (int i = 0; i < m_entries.size(); ++i)
+        members[EncryptedArchive::perfectHashBucket(m_entries.at(i).hash, seed, buckets)].append(i);
+
+    // 条目多的桶先放,此时空槽位最多,越往后的桶越小也越容易放下
+    QList<quint32> order(buckets);
+    for (quint32 b = 0; b < buckets; ++b) order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&members](quint32 a, quint32 b) {
+        return members.at(a).size() > members.at(b).size();
+    });
+
+    slots->fill(0, m_entries.size());
+    bucketSeeds->fill(0, buckets);
+    QList<bool> taken(count, false);
+    QList<quint32> candidate;
+    for (const quint32 b : std::as_const(order)) {
+        const QList<int> &bucket = members.at(b);
+        if (bucket.isEmpty()) break;
+        quint32 bucketSeed = 0;
+        for (;; ++bucketSeed) {
+            if (bucketSeed == MaxBucketSeed) return false;
+            candidate.clear();
+            bool ok = true;
+            for (const int i : bucket) {
+                const quint32 slot = EncryptedArchive::perfectHashSlot(m_entries.at(i).hash, seed,
+                                                                       bucketSeed, count);
+                if (taken.at(slot) || candidate.contains(slot)) {
+                    ok = false;
+                    break;
+                }
+                candidate.append(slot);
+            }
+            if (ok) break;
+        }
+        (*bucketSeeds)[b] = bucketSeed;
+        for (int k = 0; k < bucket.size(); ++k) {
+            taken[candidate.at(k)] = true;
+            (*slots)[bucket.at(k)] = candidate.at(k);
+        }
+    }
+    return true;
+}
+
+bool EncryptedArchiveWriter::fail(const QString &message)
+{
+    qWarning() << "[Archive]" << message;
+    m_errorString = message;
+    // 关闭文件(同时解除所有映射)，之后的写入不会落到半成品上
+    m_file.close();
+    return false;
+}
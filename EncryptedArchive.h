@@ -0,0 +1,211 @@
+#ifndef ENCRYPTEDARCHIVE_H
+#define ENCRYPTEDARCHIVE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class ResourcePath;
+
+/**
+ * @brief 加密资源归档(只读)
+ *
+ * 把所有 .enc 资源打包成一个文件,运行时映射到内存并按需取出条目,
+ * 启动开销只与索引大小相关,而与资源总字节数无关。
+ *
+ * 文件布局(所有整数均为小端序):
+ * @code
+ * [头部 32 字节]
+ *   0  char[4] magic "QRPK"
+ *   4  u32     版本号
+ *   8  u32     条目数量
+ *   12 u32     完美哈希种子(版本 1 为保留字段)
+ *   16 u64     索引偏移
+ *   24 u64     索引大小(记录表 + 桶种子表 + 路径字符串表)
+ * [密文数据区] 每个条目按 8 字节对齐
+ * [索引] 定长记录(32 字节),版本 2 按完美哈希槽位排列,版本 1 按 UTF-8 路径字节序排序
+ *   0  u64     数据偏移(相对文件起始)
+ *   8  u64     数据大小
+ *   16 u32     路径在字符串表中的偏移
+ *   20 u32     路径长度
+ *   24 u32     条目标志(EntryFlag)
+ *   28 u32     路径哈希的低 32 位(版本 1 为保留字段)
+ * [桶种子表] 仅版本 2:bucketCount(条目数量) 个 u32
+ * [路径字符串表] UTF-8 路径
+ * @endcode
+ *
+ * 版本 2 的索引是打包时构建的最小完美哈希(hash-and-displace):路径哈希先选桶,
+ * 再用桶的种子直接算出唯一的记录槽位。查找只计算一次哈希、读一个桶种子和一条记录,
+ * 比较哈希低位和路径字节后即可确定,不做二分查找,也不分配内存。
+ */
+class EncryptedArchive
+{
+public:
+    enum EntryFlag : quint32 {
+        Encrypted = 0x1, // 条目数据为密文
+    };
+
+    static constexpr char Magic[4] = {'Q', 'R', 'P', 'K'};
+    static constexpr quint32 Version = 2;
+    static constexpr qint64 HeaderSize = 32;
+    static constexpr qint64 RecordSize = 32;
+
+    EncryptedArchive() = default;
+    Q_DISABLE_COPY(EncryptedArchive)
+
+    /**
+     * @brief 打开归档
+     * 优先使用 QFile::map 映射(对未压缩的 qrc 资源同样有效),失败时才整体读入
+     * @param fileName 归档路径,可以是本地文件或 ":/" 资源路径
+     * @return 是否成功
+     */
+    bool open(const QString &fileName);
+
+    bool isOpen() const { return m_data != nullptr; }
+    QString fileName() const { return m_file.fileName(); }
+    QString errorString() const { return m_errorString; }
+
+    int entryCount() const { return int(m_entryCount); }
+    QStringList entryPaths() const;
+    bool contains(const QString &path) const;
+    bool contains(const ResourcePath &path) const;
+
+    /**
+     * @brief 获取条目数据
+     * 返回的 QByteArray 直接引用映射内存(零拷贝),只在归档存活期间有效
+     * @param path 条目路径
+     * @param flags 可选,输出条目标志
+     * @return 条目数据,不存在时返回空
+     */
+    QByteArray entryData(const QString &path, quint32 *flags = nullptr) const;
+
+    /**
+     * @brief 查找条目,与 entryData 相同但能区分"不存在"和"空条目"
+     * @return 条目是否存在
+     */
+    bool lookup(const QString &path, QByteArray *data, quint32 *flags = nullptr) const;
+
+    /**
+     * @brief 按已转换好的 UTF-8 路径和哈希查找,不分配内存
+     */
+    bool lookup(const ResourcePath &path, QByteArray *data, quint32 *flags = nullptr) const;
+
+    /**
+     * @brief 条目在文件中的位置,用于差分更新时原样保留未变化的条目
+     */
+    bool entryRange(const QString &path, quint64 *offset, quint64 *size, quint32 *flags = nullptr) const;
+
+    /**
+     * @brief 索引结束的位置;之后的字节不属于归档(例如中断的更新留下的数据)
+     */
+    qint64 usedSize() const { return m_usedSize; }
+
+    /**
+     * @brief 数据区中不被任何条目引用的字节数(差分更新替换掉的旧数据和对齐填充)
+     */
+    qint64 unusedBytes() const { return m_unusedBytes; }
+
+    /**
+     * @brief 完美哈希的桶数量(平均每桶 4 个条目)
+     */
+    static quint32 bucketCount(quint32 entryCount) { return qMax<quint32>(1, (entryCount + 3) / 4); }
+
+    /**
+     * @brief 路径哈希所在的桶,以及在桶种子作用下的记录槽位(打包和查找共用)
+     */
+    static quint32 perfectHashBucket(quint64 hash, quint32 seed, quint32 buckets);
+    static quint32 perfectHashSlot(quint64 hash, quint32 seed, quint32 bucketSeed, quint32 slots);
+
+private:
+    int findEntry(const ResourcePath &path) const;
+    const uchar *record(int index) const { return m_index + index * RecordSize; }
+    QByteArray recordPath(int index) const;
+    bool fail(const QString &message);
+
+    QFile m_file;
+    QByteArray m_buffer; // 无法映射时的回退存储
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    qint64 m_usedSize = 0;
+    qint64 m_unusedBytes = 0;
+    quint32 m_entryCount = 0;
+    quint32 m_version = 0;
+    quint32 m_hashSeed = 0;
+    const uchar *m_bucketSeeds = nullptr;
+    const uchar *m_index = nullptr;
+    const uchar *m_strings = nullptr;
+    qint64 m_stringsSize = 0;
+    QString m_errorString;
+};
+
+/**
+ * @brief 加密资源归档写入器
+ * 条目按添加顺序写入数据区,finish() 时构建完美哈希并写出索引
+ *
+ * openForAppend() 用于原地更新已有的归档:新数据和新索引追加在旧索引之后,
+ * 保留的条目只登记位置不重写。数据和索引同步到磁盘(fsync/FlushFileBuffers)之后
+ * 才覆盖头部,头部写入后再同步一次;头部写入之前中断或掉电时,
+ * 旧头部仍指向完整的旧索引,归档保持更新前的状态。
+ */
+class EncryptedArchiveWriter
+{
+public:
+    explicit EncryptedArchiveWriter(const QString &fileName);
+    Q_DISABLE_COPY(EncryptedArchiveWriter)
+
+    bool open();
+
+    /**
+     * @brief 打开已有的归档以追加更新
+     * @param usedSize 旧归档索引结束的位置,之后的字节(中断的更新留下的)被截掉
+     */
+    bool openForAppend(qint64 usedSize);
+
+    /**
+     * @brief 追加一个条目
+     * @param path 条目路径(运行时的虚拟路径)
+     * @param data 条目数据
+     * @param flags 条目标志
+     * @return 是否成功
+     */
+    bool addEntry(const QString &path, const QByteArray &data,
+                  quint32 flags = EncryptedArchive::Encrypted);
+
+    /**
+     * @brief 登记文件中已有的条目,不写入数据(仅用于 openForAppend)
+     */
+    void addExistingEntry(const QString &path, quint64 offset, quint64 size, quint32 flags);
+
+    /**
+     * @brief 写出索引和头部并关闭文件
+     */
+    bool finish();
+
+    QString errorString() const { return m_errorString; }
+
+private:
+    struct PendingEntry {
+        QByteArray path;
+        quint64 offset;
+        quint64 size;
+        quint32 flags;
+        quint64 hash = 0;
+    };
+
+    /**
+     * @brief 为所有条目分配完美哈希槽位
+     * @param slots 输出每个条目的槽位
+     * @param bucketSeeds 输出每个桶的种子
+     * @return 失败(该种子下无法放置)时返回 false,调用方换一个全局种子重试
+     */
+    bool buildPerfectHash(quint32 seed, QList<quint32> *slots, QList<quint32> *bucketSeeds) const;
+    bool fail(const QString &message);
+
+    QFile m_file;
+    QList<PendingEntry> m_entries;
+    QString m_errorString;
+};
+
+#endif // ENCRYPTEDARCHIVE_H
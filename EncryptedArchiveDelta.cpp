@@ -0,0 +1,544 @@
+#include "EncryptedArchiveDelta.h"
+#include "EncryptedArchive.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QMultiHash>
+#include <QSaveFile>
+#include <QSet>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+template <typename T>
+void appendLE(QByteArray &out, T value)
+{
+    uchar buf[sizeof(T)];
+    qToLittleEndian<T>(value, buf);
+    out.append(reinterpret_cast<const char *>(buf), sizeof(T));
+}
+
+// 最短的条目记录:操作(u8) + 标志(u32) + 空路径(u16) + 保留的空源路径(u16)
+constexpr qint64 MinEntryRecordSize = 1 + 4 + 2 + 2;
+// 修补结果负载的上限,防止损坏的差分用伪造的长度触发巨大的分配
+constexpr quint64 MaxPatchedPayloadSize = 1024ULL * 1024 * 1024;
+
+void appendString(QByteArray &out, const QString &value)
+{
+    const QByteArray utf8 = value.toUtf8();
+    appendLE<quint16>(out, quint16(utf8.size()));
+    out.append(utf8);
+}
+
+/**
+ * @brief 按顺序读取差分文件,越界后所有读取都返回零值,由调用方检查 ok
+ */
+class Reader
+{
+public:
+    explicit Reader(const QByteArray &data, qsizetype pos = 0) : m_data(data), m_pos(pos) {}
+
+    bool ok() const { return m_ok; }
+
+    template <typename T>
+    T read()
+    {
+        if (!require(sizeof(T))) return T(0);
+        const T value = qFromLittleEndian<T>(reinterpret_cast<const uchar *>(m_data.constData()) + m_pos);
+        m_pos += qsizetype(sizeof(T));
+        return value;
+    }
+
+    QByteArray bytes(quint64 size)
+    {
+        if (!require(size)) return QByteArray();
+        const QByteArray value = m_data.mid(m_pos, qsizetype(size));
+        m_pos += qsizetype(size);
+        return value;
+    }
+
+    QString string() { return QString::fromUtf8(bytes(read<quint16>())); }
+
+private:
+    bool require(quint64 size)
+    {
+        if (!m_ok || size > quint64(m_data.size() - m_pos)) {
+            m_ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    const QByteArray &m_data;
+    qsizetype m_pos;
+    bool m_ok = true;
+};
+
+QByteArray sha256(const QByteArray &data)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+}
+
+bool hasHeader(const QByteArray &data)
+{
+    return data.size() >= ResourceEncryption::HeaderSize
+           && memcmp(data.constData(), ResourceEncryption::Magic, sizeof(ResourceEncryption::Magic)) == 0;
+}
+
+// 修补的固定开销(源路径之外):算法、压缩、SHA-256、结果长度、指令数、新增字节长度
+constexpr qint64 PatchOverhead = 1 + 1 + 32 + 8 + 4 + 8;
+constexpr qint64 InstructionSize = 1 + 8 + 8;
+
+} // namespace
+
+QByteArray EncryptedArchiveDelta::entryFingerprint(const QByteArray &data)
+{
+    if (hasHeader(data) && ResourceEncryption::algorithmOf(data) != CipherAlgorithm::Xor)
+        return data.mid(8, ResourceEncryption::IvSize);
+    return sha256(data).left(ResourceEncryption::IvSize);
+}
+
+QByteArray EncryptedArchiveDelta::packageDigest(const EncryptedArchive &archive)
+{
+    QStringList paths = archive.entryPaths();
+    std::sort(paths.begin(), paths.end());
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (const QString &path : std::as_const(paths)) {
+        QByteArray data;
+        quint32 flags = 0;
+        archive.lookup(path, &data, &flags);
+        QByteArray record = path.toUtf8();
+        record.append('\0');
+        appendLE<quint64>(record, quint64(data.size()));
+        appendLE<quint32>(record, flags);
+        record.append(entryFingerprint(data));
+        hash.addData(record);
+    }
+    return hash.result();
+}
+
+QList<EncryptedArchiveDelta::Instruction> EncryptedArchiveDelta::diff(const QByteArray &base,
+                                                                     const QByteArray &target, int blockSize,
+                                                                     QByteArray *literals)
+{
+    const auto *b = reinterpret_cast<const uchar *>(base.constData());
+    const auto *t = reinterpret_cast<const uchar *>(target.constData());
+    const qsizetype n = target.size();
+    const quint32 size = quint32(blockSize);
+
+    // 与 rsync 相同的弱校验和:a 为字节和,b 为按位置加权的和,窗口右移一个字节时 O(1) 更新
+    auto checksum = [size](const uchar *p, quint32 *a, quint32 *s) {
+        *a = 0;
+        *s = 0;
+        for (quint32 i = 0; i < size; ++i) {
+            *a += p[i];
+            *s += (size - i) * p[i];
+        }
+    };
+    auto weak = [](quint32 a, quint32 s) { return (a & 0xffff) | (s << 16); };
+
+    // 旧负载按块对齐建立索引;新负载逐字节滑动窗口查找
+    QMultiHash<quint32, qsizetype> blocks;
+    for (qsizetype offset = 0; offset + blockSize <= base.size(); offset += blockSize) {
+        quint32 a, s;
+        checksum(b + offset, &a, &s);
+        blocks.insert(weak(a, s), offset);
+    }
+
+    QList<Instruction> result;
+    auto emitLiteral = [&](qsizetype from, qsizetype to) {
+        if (from >= to) return;
+        literals->append(target.constData() + from, to - from);
+        if (!result.isEmpty() && !result.last().copy) {
+            result.last().length += quint64(to - from);
+        } else {
+            result.append({false, 0, quint64(to - from)});
+        }
+    };
+
+    qsizetype pos = 0;
+    qsizetype literalStart = 0;
+    quint32 a = 0, s = 0;
+    if (!blocks.isEmpty() && n >= blockSize) checksum(t, &a, &s);
+    while (!blocks.isEmpty() && pos + blockSize <= n) {
+        qsizetype match = -1;
+        for (auto it = blocks.constFind(weak(a, s)); it != blocks.cend() && it.key() == weak(a, s); ++it) {
+            if (memcmp(b + it.value(), t + pos, size_t(blockSize)) == 0) {
+                match = it.value();
+                break;
+            }
+        }
+        if (match >= 0) {
+            emitLiteral(literalStart, pos);
+            if (!result.isEmpty() && result.last().copy
+                && result.last().offset + result.last().length == quint64(match)) {
+                result.last().length += quint64(blockSize);
+            } else {
+                result.append({true, quint64(match), quint64(blockSize)});
+            }
+            pos += blockSize;
+            literalStart = pos;
+            if (pos + blockSize <= n) checksum(t + pos, &a, &s);
+            continue;
+        }
+        if (pos + blockSize < n) {
+            const quint32 out = t[pos];
+            const quint32 in = t[pos + blockSize];
+            a = a - out + in;
+            s = s - size * out + a;
+        }
+        ++pos;
+    }
+    emitLiteral(literalStart, n);
+    return result;
+}
+
+bool EncryptedArchiveDelta::create(const QString &baseArchive, const QString &targetArchive,
+                                   const QString &deltaFile, const DerivedKey &key, int blockSize)
+{
+    m_stats = Stats();
+    m_errorString.clear();
+    blockSize = qMax(64, blockSize);
+
+    EncryptedArchive base;
+    if (!base.open(baseArchive)) return fail(base.errorString());
+    EncryptedArchive target;
+    if (!target.open(targetArchive)) return fail(target.errorString());
+
+    // 改名的条目按 指纹+大小 找回旧位置
+    QHash<QByteArray, QString> byFingerprint;
+    const QStringList basePaths = base.entryPaths();
+    for (const QString &path : basePaths) {
+        const QByteArray data = base.entryData(path);
+        QByteArray fingerprint = entryFingerprint(data);
+        appendLE<quint64>(fingerprint, quint64(data.size()));
+        byFingerprint.insert(fingerprint, path);
+    }
+
+    QByteArray out(HeaderSize, '\0');
+    QStringList targetPaths = target.entryPaths();
+    std::sort(targetPaths.begin(), targetPaths.end());
+    for (const QString &path : std::as_const(targetPaths)) {
+        QByteArray data;
+        quint32 flags = 0;
+        target.lookup(path, &data, &flags);
+        QByteArray baseData;
+        quint32 baseFlags = 0;
+        const bool inBase = base.lookup(path, &baseData, &baseFlags);
+
+        QString keepSource;
+        if (inBase && baseFlags == flags && baseData == data) {
+            keepSource = path;
+        } else {
+            QByteArray fingerprint = entryFingerprint(data);
+            appendLE<quint64>(fingerprint, quint64(data.size()));
+            const QString renamed = byFingerprint.value(fingerprint);
+            quint32 renamedFlags = 0;
+            if (!renamed.isEmpty() && base.entryData(renamed, &renamedFlags) == data && renamedFlags == flags)
+                keepSource = renamed;
+        }
+
+        QByteArray record;
+        appendLE<quint8>(record, keepSource.isEmpty() ? Replace : Keep);
+        appendLE<quint32>(record, flags);
+        appendString(record, path);
+        if (!keepSource.isEmpty()) {
+            appendString(record, keepSource);
+            out += record;
+            m_stats.kept++;
+            continue;
+        }
+
+        // 同名条目变化:解密出负载按块比较;只有重新加密能逐字节复现新密文时才使用修补
+        if (inBase && !key.isNull() && (flags & EncryptedArchive::Encrypted) && hasHeader(data) && hasHeader(baseData)
+            && ResourceEncryption::algorithmOf(data) != CipherAlgorithm::Xor) {
+            const CipherAlgorithm algorithm = ResourceEncryption::algorithmOf(data);
+            const CompressionMethod compression = ResourceEncryption::compressionOf(data);
+            const QByteArray payload = ResourceEncryption::decryptPayload(data, key);
+            if (ResourceEncryption::encryptPayload(payload, key, algorithm, compression) == data) {
+                QByteArray literals;
+                const QList<Instruction> instructions =
+                    diff(ResourceEncryption::decryptPayload(baseData, key), payload, blockSize, &literals);
+                const QByteArray encryptedLiterals = ResourceEncryption::encrypt(literals, key);
+                const qint64 cost = 2 + path.toUtf8().size() + PatchOverhead
+                                    + instructions.size() * InstructionSize + encryptedLiterals.size();
+                if (cost < data.size() - data.size() / 8) {
+                    record[0] = char(Patch);
+                    appendString(record, path);
+                    appendLE<quint8>(record, quint8(algorithm));
+                    appendLE<quint8>(record, quint8(compression));
+                    record.append(sha256(data));
+                    appendLE<quint64>(record, quint64(data.size()));
+                    appendLE<quint32>(record, quint32(instructions.size()));
+                    for (const Instruction &instruction : instructions) {
+                        appendLE<quint8>(record, instruction.copy ? 0 : 1);
+                        if (instruction.copy) appendLE<quint64>(record, instruction.offset);
+                        appendLE<quint64>(record, instruction.length);
+                    }
+                    appendLE<quint64>(record, quint64(encryptedLiterals.size()));
+                    record.append(encryptedLiterals);
+                    out += record;
+                    m_stats.patched++;
+                    m_stats.literalBytes += literals.size();
+                    continue;
+                }
+            }
+        }
+
+        record.append(sha256(data));
+        appendLE<quint64>(record, quint64(data.size()));
+        record.append(data);
+        out += record;
+        m_stats.replaced++;
+    }
+
+    const QSet<QString> targetSet(targetPaths.cbegin(), targetPaths.cend());
+    for (const QString &path : basePaths) {
+        if (!targetSet.contains(path)) m_stats.removed++;
+    }
+
+    uchar *header = reinterpret_cast<uchar *>(out.data());
+    memcpy(header, Magic, sizeof(Magic));
+    qToLittleEndian<quint32>(Version, header + 4);
+    qToLittleEndian<quint32>(quint32(targetPaths.size()), header + 8);
+    qToLittleEndian<quint32>(quint32(blockSize), header + 12);
+    memcpy(header + 16, packageDigest(base).constData(), 32);
+    memcpy(header + 48, packageDigest(target).constData(), 32);
+
+    QSaveFile file(deltaFile);
+    if (!file.open(QIODevice::WriteOnly) || file.write(out) != out.size() || !file.commit())
+        return fail(QStringLiteral("无法写入差分文件: %1").arg(deltaFile));
+    m_stats.deltaBytes = out.size();
+
+    qDebug() << "[Delta] 差分已生成:" << deltaFile << "保留" << m_stats.kept << "修补" << m_stats.patched
+             << "替换" << m_stats.replaced << "删除" << m_stats.removed << "大小" << m_stats.deltaBytes << "字节";
+    return true;
+}
+
+bool EncryptedArchiveDelta::apply(const QString &archiveFile, const QString &deltaFile, const DerivedKey &key)
+{
+    m_stats = Stats();
+    m_errorString.clear();
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile file(deltaFile);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(QStringLiteral("无法打开差分文件: %1").arg(deltaFile));
+    const QByteArray delta = file.readAll();
+    m_stats.deltaBytes = delta.size();
+    if (delta.size() < HeaderSize || memcmp(delta.constData(), Magic, sizeof(Magic)) != 0)
+        return fail(QStringLiteral("不是有效的差分文件: %1").arg(deltaFile));
+    Reader header(delta, 4);
+    const quint32 version = header.read<quint32>();
+    const quint32 entryCount = header.read<quint32>();
+    header.read<quint32>(); // 块大小,应用时不需要
+    const QByteArray sourceDigest = header.bytes(32);
+    const QByteArray targetDigest = header.bytes(32);
+    if (version != Version)
+        return fail(QStringLiteral("不支持的差分版本: %1").arg(version));
+
+    struct Pending {
+        QString path;
+        quint32 flags = 0;
+        bool existing = false;
+        quint64 offset = 0;
+        quint64 size = 0;
+        QByteArray data;
+    };
+    QList<Pending> pending;
+    QSet<QString> sources;
+    qint64 usedSize = 0;
+
+    // 读取阶段:只读映射旧归档,全部校验通过后才修改文件
+    {
+        EncryptedArchive archive;
+        if (!archive.open(archiveFile)) return fail(archive.errorString());
+        const QByteArray digest = packageDigest(archive);
+        if (digest == targetDigest) {
+            m_stats.upToDate = true;
+            qDebug() << "[Delta] 归档已是目标版本:" << archiveFile;
+            return true;
+        }
+        if (digest != sourceDigest)
+            return fail(QStringLiteral("归档与差分的源版本不匹配: %1").arg(archiveFile));
+        usedSize = archive.usedSize();
+
+        // 条目数量来自尚未校验的头部,按文件实际能容纳的记录数检查后才预留
+        if (entryCount > quint64(delta.size() - HeaderSize) / MinEntryRecordSize)
+            return fail(QStringLiteral("差分文件损坏: %1").arg(deltaFile));
+        Reader reader(delta, HeaderSize);
+        pending.reserve(qsizetype(entryCount));
+        for (quint32 i = 0; i < entryCount; ++i) {
+            Pending entry;
+            const quint8 operation = reader.read<quint8>();
+            entry.flags = reader.read<quint32>();
+            entry.path = reader.string();
+            if (!reader.ok()) break;
+
+            if (operation == Keep) {
+                const QString source = reader.string();
+                if (!reader.ok() || !archive.entryRange(source, &entry.offset, &entry.size))
+                    return fail(QStringLiteral("差分引用的条目不存在: %1").arg(source));
+                entry.existing = true;
+                sources.insert(source);
+                m_stats.kept++;
+            } else if (operation == Replace) {
+                const QByteArray checksum = reader.bytes(32);
+                entry.data = reader.bytes(reader.read<quint64>());
+                if (!reader.ok() || sha256(entry.data) != checksum)
+                    return fail(QStringLiteral("差分条目校验失败: %1").arg(entry.path));
+                m_stats.replaced++;
+            } else if (operation == Patch) {
+                const QString source = reader.string();
+                const auto algorithm = CipherAlgorithm(reader.read<quint8>());
+                const auto compression = CompressionMethod(reader.read<quint8>());
+                const QByteArray checksum = reader.bytes(32);
+                const quint64 resultSize = reader.read<quint64>();
+                const quint32 instructionCount = reader.read<quint32>();
+                QList<Instruction> instructions;
+                quint64 payloadSize = 0;
+                for (quint32 k = 0; k < instructionCount && reader.ok(); ++k) {
+                    Instruction instruction;
+                    instruction.copy = reader.read<quint8>() == 0;
+                    if (instruction.copy) instruction.offset = reader.read<quint64>();
+                    instruction.length = reader.read<quint64>();
+                    if (instruction.length > MaxPatchedPayloadSize - payloadSize)
+                        return fail(QStringLiteral("差分指令越界: %1").arg(entry.path));
+                    payloadSize += instruction.length;
+                    instructions.append(instruction);
+                }
+                const QByteArray encryptedLiterals = reader.bytes(reader.read<quint64>());
+                if (!reader.ok()) break;
+                if (key.isNull())
+                    return fail(QStringLiteral("差分包含修补条目,需要解密密钥"));
+                // 指令总长度就是修补后的负载长度,必须与声明的结果长度一致;
+                // 单条指令的长度在拼接时再按来源的实际大小检查
+                if (quint64(ResourceEncryption::encryptedSize(qsizetype(payloadSize))) != resultSize)
+                    return fail(QStringLiteral("差分条目长度不一致: %1").arg(entry.path));
+
+                QByteArray baseData;
+                if (!archive.lookup(source, &baseData))
+                    return fail(QStringLiteral("差分引用的条目不存在: %1").arg(source));
+                const QByteArray basePayload = ResourceEncryption::decryptPayload(baseData, key);
+                const QByteArray literals = ResourceEncryption::decrypt(encryptedLiterals, key);
+                // 预留之前确认每条指令都落在来源之内,越界的差分在分配前就被拒绝
+                quint64 literalTotal = 0;
+                for (const Instruction &instruction : std::as_const(instructions)) {
+                    if (!instruction.copy) literalTotal += instruction.length;
+                    else if (instruction.length > quint64(basePayload.size()))
+                        return fail(QStringLiteral("差分指令越界: %1").arg(entry.path));
+                }
+                if (literalTotal > quint64(literals.size()))
+                    return fail(QStringLiteral("差分指令越界: %1").arg(entry.path));
+                QByteArray payload;
+                payload.reserve(qsizetype(payloadSize));
+                quint64 literalPos = 0;
+                for (const Instruction &instruction : std::as_const(instructions)) {
+                    const QByteArray &from = instruction.copy ? basePayload : literals;
+                    const quint64 offset = instruction.copy ? instruction.offset : literalPos;
+                    if (offset > quint64(from.size()) || instruction.length > quint64(from.size()) - offset)
+                        return fail(QStringLiteral("差分指令越界: %1").arg(entry.path));
+                    payload.append(from.constData() + offset, qsizetype(instruction.length));
+                    if (!instruction.copy) literalPos += instruction.length;
+                }
+                entry.data = ResourceEncryption::encryptPayload(payload, key, algorithm, compression);
+                if (quint64(entry.data.size()) != resultSize || sha256(entry.data) != checksum)
+                    return fail(QStringLiteral("修补结果校验失败: %1").arg(entry.path));
+                sources.insert(source);
+                m_stats.patched++;
+                m_stats.literalBytes += literals.size();
+            } else {
+                return fail(QStringLiteral("未知的差分操作: %1").arg(operation));
+            }
+            pending.append(entry);
+        }
+        if (!reader.ok() || pending.size() != qsizetype(entryCount))
+            return fail(QStringLiteral("差分文件损坏: %1").arg(deltaFile));
+        m_stats.removed = archive.entryCount() - int(sources.size());
+    }
+
+    // 写入阶段:新数据和索引追加在旧索引之后,保留的条目只登记位置
+    EncryptedArchiveWriter writer(archiveFile);
+    if (!writer.openForAppend(usedSize)) return fail(writer.errorString());
+    for (const Pending &entry : std::as_const(pending)) {
+        if (entry.existing) {
+            writer.addExistingEntry(entry.path, entry.offset, entry.size, entry.flags);
+        } else {
+            if (!writer.addEntry(entry.path, entry.data, entry.flags)) return fail(writer.errorString());
+            m_stats.writtenBytes += entry.data.size();
+        }
+    }
+    if (!writer.finish()) return fail(writer.errorString());
+
+    // 重新打开,确认结果就是目标版本
+    bool needsCompaction = false;
+    {
+        EncryptedArchive result;
+        if (!result.open(archiveFile) || packageDigest(result) != targetDigest)
+            return fail(QStringLiteral("应用差分后的归档校验失败: %1").arg(archiveFile));
+        m_stats.unusedBytes = result.unusedBytes();
+        needsCompaction = m_stats.unusedBytes * 100 > result.usedSize() * CompactPercent;
+    }
+    // 更新已经生效,整理失败时保留带空洞的归档,下次应用差分后再试
+    if (needsCompaction && compact(archiveFile)) {
+        m_stats.compacted = true;
+        m_stats.unusedBytes = 0;
+    }
+
+    qDebug() << "[Delta] 差分已应用:" << archiveFile << "保留" << m_stats.kept << "修补" << m_stats.patched
+             << "替换" << m_stats.replaced << "写入" << m_stats.writtenBytes << "字节"
+             << "未引用" << m_stats.unusedBytes << "字节" << "已整理" << m_stats.compacted
+             << "耗时(ms):" << timer.nsecsElapsed() / 1e6;
+    return true;
+}
+
+bool EncryptedArchiveDelta::compact(const QString &archiveFile)
+{
+    const QString compactFile = archiveFile + QStringLiteral(".compact");
+    {
+        EncryptedArchive archive;
+        if (!archive.open(archiveFile)) return fail(archive.errorString());
+        EncryptedArchiveWriter writer(compactFile);
+        if (!writer.open()) return fail(writer.errorString());
+        const QStringList paths = archive.entryPaths();
+        for (const QString &path : paths) {
+            quint32 flags = 0;
+            const QByteArray data = archive.entryData(path, &flags);
+            if (!writer.addEntry(path, data, flags)) return fail(writer.errorString());
+        }
+        // finish() 返回时新归档已同步到磁盘
+        if (!writer.finish()) return fail(writer.errorString());
+
+        EncryptedArchive compacted;
+        if (!compacted.open(compactFile) || packageDigest(compacted) != packageDigest(archive)) {
+            QFile::remove(compactFile);
+            return fail(QStringLiteral("整理后的归档校验失败: %1").arg(archiveFile));
+        }
+    }
+
+    // QFile::rename 不覆盖已存在的文件;std::filesystem::rename 在 POSIX 上是 rename(),
+    // 在 Windows 上是 MoveFileEx(MOVEFILE_REPLACE_EXISTING),替换是原子的
+    std::error_code error;
+    std::filesystem::rename(std::filesystem::path(compactFile.toStdU16String()),
+                            std::filesystem::path(archiveFile.toStdU16String()), error);
+    if (error) {
+        QFile::remove(compactFile);
+        return fail(QStringLiteral("无法替换归档: %1 (%2)")
+                        .arg(archiveFile, QString::fromLocal8Bit(error.message())));
+    }
+    qDebug() << "[Delta] 归档已整理:" << archiveFile;
+    return true;
+}
+
+bool EncryptedArchiveDelta::fail(const QString &message)
+{
+    qWarning() << "[Delta]" << message;
+    m_errorString = message;
+    return false;
+}
@@ -0,0 +1,136 @@
+#ifndef ENCRYPTEDARCHIVEDELTA_H
+#define ENCRYPTEDARCHIVEDELTA_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "ResourceEncryption.h"
+
+class EncryptedArchive;
+
+/**
+ * @brief 加密资源归档的差分更新
+ *
+ * 相同明文加密出的密文逐字节相同(初始向量由明文派生),因此两个版本的归档可以
+ * 直接按条目比较密文。差分只记录变化:
+ * - 保留:条目未变化(或只是改名),应用时只登记旧位置,不重写数据;
+ * - 修补:同名条目内容变化,按块比较解密后的负载,只携带新增的字节(重新加密)
+ *   和对旧负载的复制指令,应用时解密旧条目、拼出新负载并重新加密;
+ * - 替换:新增条目或修补不划算时携带完整的新密文。
+ * 旧版本中不再出现的条目被删除。
+ *
+ * 文件布局(所有整数均为小端序):
+ * @code
+ * [头部 80 字节]
+ *   0  char[4] magic "QRPD"
+ *   4  u32     版本号
+ *   8  u32     新归档条目数量
+ *   12 u32     块大小
+ *   16 u8[32]  源归档摘要(packageDigest)
+ *   48 u8[32]  目标归档摘要
+ * [条目] 按新归档的条目依次排列
+ *   u8  操作(Operation)  u32 条目标志  u16 路径长度  路径(UTF-8)
+ *   保留: u16 源路径长度 源路径
+ *   替换: u8[32] 密文 SHA-256  u64 长度  密文
+ *   修补: u16 源路径长度 源路径  u8 算法  u8 压缩方式  u8[32] 结果 SHA-256  u64 结果长度
+ *         u32 指令数  指令(u8 类型 0=复制 1=新增, 复制: u64 源偏移 u64 长度, 新增: u64 长度)
+ *         u64 新增字节密文长度  新增字节密文
+ * @endcode
+ *
+ * 应用前先比较源归档摘要,不匹配时不做任何修改;每个重建的条目写入前校验 SHA-256。
+ * 写入通过 EncryptedArchiveWriter::openForAppend 追加在旧索引之后,头部最后覆盖,
+ * 更新传输量和应用耗时只与变化量相关。被替换条目的旧数据留在文件中成为空洞,
+ * 空洞超过 CompactPercent 时 apply() 随后调用 compact() 重新打包。
+ */
+class EncryptedArchiveDelta
+{
+public:
+    enum Operation : quint8 {
+        Keep = 0,
+        Replace = 1,
+        Patch = 2,
+    };
+
+    static constexpr char Magic[4] = {'Q', 'R', 'P', 'D'};
+    static constexpr quint32 Version = 1;
+    static constexpr qint64 HeaderSize = 80;
+    static constexpr int DefaultBlockSize = 2048;
+    // 未引用的字节超过归档已用大小的该百分比时,应用差分后整理归档
+    static constexpr int CompactPercent = 25;
+
+    struct Stats {
+        int kept = 0;
+        int patched = 0;
+        int replaced = 0;
+        int removed = 0;
+        qint64 deltaBytes = 0;   // 差分文件大小
+        qint64 literalBytes = 0; // 修补携带的新增字节
+        qint64 writtenBytes = 0; // 应用时写入归档的数据
+        qint64 unusedBytes = 0;  // 应用后归档中不再被引用的数据
+        bool compacted = false;  // 应用后归档已被整理
+        bool upToDate = false;   // 归档已是目标版本
+    };
+
+    EncryptedArchiveDelta() = default;
+    Q_DISABLE_COPY(EncryptedArchiveDelta)
+
+    /**
+     * @brief 生成从 baseArchive 到 targetArchive 的差分
+     * @param key 派生密钥,用于按块比较变化的条目;为空时只做条目级差分
+     * @param blockSize 块比较的块大小
+     */
+    bool create(const QString &baseArchive, const QString &targetArchive, const QString &deltaFile,
+                const DerivedKey &key, int blockSize = DefaultBlockSize);
+
+    /**
+     * @brief 把差分原地应用到归档
+     * 归档不能处于打开(映射)状态;源版本不匹配或校验失败时归档保持不变
+     * @param key 派生密钥,差分中有修补条目时需要
+     */
+    bool apply(const QString &archiveFile, const QString &deltaFile, const DerivedKey &key);
+
+    /**
+     * @brief 整理归档:只把仍被引用的条目复制到新文件,再原子地替换原归档
+     * 条目密文原样复制,不需要密钥;归档不能处于打开(映射)状态。
+     * 替换之前中断时原归档保持不变,留下的临时文件在下次整理时被覆盖
+     */
+    bool compact(const QString &archiveFile);
+
+    const Stats &stats() const { return m_stats; }
+    QString errorString() const { return m_errorString; }
+
+    /**
+     * @brief 条目内容指纹
+     * 带头部的密文直接取头部中的初始向量(由明文派生),不读取整个条目;
+     * 其他数据取 SHA-256 的前 16 字节
+     */
+    static QByteArray entryFingerprint(const QByteArray &data);
+
+    /**
+     * @brief 归档内容摘要:按路径排序的 路径/大小/标志/指纹 的 SHA-256
+     * 只读取索引和每个条目的头部,耗时与条目数相关,与字节数无关
+     */
+    static QByteArray packageDigest(const EncryptedArchive &archive);
+
+private:
+    struct Instruction {
+        bool copy = false;
+        quint64 offset = 0; // 复制的源偏移
+        quint64 length = 0;
+    };
+
+    /**
+     * @brief 滚动校验和匹配:把 target 表示为对 base 按块复制与新增字节的组合
+     * @param literals 输出新增字节
+     */
+    static QList<Instruction> diff(const QByteArray &base, const QByteArray &target, int blockSize,
+                                   QByteArray *literals);
+
+    bool fail(const QString &message);
+
+    Stats m_stats;
+    QString m_errorString;
+};
+
+#endif // ENCRYPTEDARCHIVEDELTA_H
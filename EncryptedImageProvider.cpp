@@ -0,0 +1,151 @@
+#include "EncryptedImageProvider.h"
+#include "EncryptedResourceSelector.h"
+#include "ResourcePath.h"
+#include <QBuffer>
+#include <QDebug>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+
+// 默认缓存 64MB 解码后的像素
+constexpr qint64 DefaultCacheBudget = 64 * 1024 * 1024;
+
+/**
+ * @brief 按 QML Image.sourceSize 的语义计算解码尺寸
+ * 只给出一边时另一边按比例计算，两边都给出时等比缩放到不超出该范围；不放大
+ */
+QSize scaledSizeFor(const QSize &original, const QSize &requested)
+{
+    if (!original.isValid() || (requested.width() <= 0 && requested.height() <= 0))
+        return QSize();
+    QSize target = original;
+    if (requested.width() > 0 && requested.height() > 0)
+        target = original.scaled(requested, Qt::KeepAspectRatio);
+    else if (requested.width() > 0)
+        target = QSize(requested.width(),
+                       qMax(1, int(qint64(original.height()) * requested.width() / original.width())));
+    else
+        target = QSize(qMax(1, int(qint64(original.width()) * requested.height() / original.height())),
+                       requested.height());
+    if (target.width() >= original.width() || target.height() >= original.height())
+        return QSize();
+    return target;
+}
+
+} // namespace
+
+// EncryptedImageResponse 实现
+EncryptedImageResponse::EncryptedImageResponse(EncryptedImageProvider *provider, const QString &id,
+                                               const QSize &requestedSize)
+    : m_provider(provider)
+    , m_id(id)
+    , m_requestedSize(requestedSize)
+    , m_metrics(ResourceMetrics::instance().record(ResourcePath(id)))
+    , m_requestedAt(m_metrics ? ResourceMetrics::instance().now() : 0)
+{
+    // 由引擎在 finished() 之后删除
+    setAutoDelete(false);
+}
+
+QQuickTextureFactory *EncryptedImageResponse::textureFactory() const
+{
+    return QQuickTextureFactory::textureFactoryForImage(m_image);
+}
+
+void EncryptedImageResponse::cancel()
+{
+    m_canceled.storeRelaxed(true);
+}
+
+void EncryptedImageResponse::run()
+{
+    // 被取消的请求同样需要发出 finished()，引擎才会回收响应对象
+    if (!m_canceled.loadRelaxed())
+        m_image = m_provider->loadImage(m_id, m_requestedSize, m_canceled, &m_errorString);
+    if (m_metrics) {
+        // 交付延迟包括排队、解密和解码
+        ResourceMetrics &meter = ResourceMetrics::instance();
+        const qint64 now = meter.now();
+        m_metrics->addDelivery(now - m_requestedAt);
+        meter.traceSpan("image", m_metrics, m_requestedAt, now, m_image.sizeInBytes());
+    }
+    emit finished();
+}
+
+// EncryptedImageProvider 实现
+EncryptedImageProvider::EncryptedImageProvider(EncryptedResourceSelector *selector)
+    : m_selector(selector)
+    , m_cache(DefaultCacheBudget)
+{
+    m_pool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+EncryptedImageProvider::~EncryptedImageProvider()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+QQuickImageResponse *EncryptedImageProvider::requestImageResponse(const QString &id,
+                                                                  const QSize &requestedSize)
+{
+    auto *response = new EncryptedImageResponse(this, id, requestedSize);
+    m_pool.start(response);
+    return response;
+}
+
+void EncryptedImageProvider::setCacheBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_cache.setMaxCost(qMax<qint64>(0, bytes));
+}
+
+QImage EncryptedImageProvider::loadImage(const QString &id, const QSize &requestedSize,
+                                         const QAtomicInteger<bool> &canceled,
+                                         QString *errorString)
+{
+    const QString key = cacheKey(id, requestedSize);
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        if (const QImage *cached = m_cache.object(key))
+            return *cached;
+    }
+
+    const PlaintextBuffer plaintext = m_selector->decryptedBuffer(
+        id, [&canceled] { return canceled.loadRelaxed(); });
+    if (canceled.loadRelaxed()) return QImage();
+    if (plaintext.isEmpty()) {
+        *errorString = QStringLiteral("Encrypted image not available: %1").arg(id);
+        return QImage();
+    }
+
+    // 直接从内存池中的明文解码,不复制;解码结束后句柄释放,明文随之清零
+    QByteArray data = plaintext.bytes();
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    // 解码时直接缩小，JPEG 等格式可以跳过全分辨率解码
+    const QSize scaled = scaledSizeFor(reader.size(), requestedSize);
+    if (scaled.isValid())
+        reader.setScaledSize(scaled);
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        *errorString = QStringLiteral("Failed to decode %1: %2").arg(id, reader.errorString());
+        qWarning() << "[Image] 解码失败:" << id << reader.errorString();
+        return QImage();
+    }
+
+    QMutexLocker locker(&m_cacheMutex);
+    if (m_cache.maxCost() > 0)
+        m_cache.insert(key, new QImage(image), image.sizeInBytes());
+    return image;
+}
+
+QString EncryptedImageProvider::cacheKey(const QString &id, const QSize &requestedSize)
+{
+    return QStringLiteral("%1@%2x%3").arg(id).arg(requestedSize.width()).arg(requestedSize.height());
+}
@@ -0,0 +1,84 @@
+#ifndef ENCRYPTEDIMAGEPROVIDER_H
+#define ENCRYPTEDIMAGEPROVIDER_H
+
+#include <QAtomicInteger>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QQuickAsyncImageProvider>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "ResourceMetrics.h"
+
+class EncryptedResourceSelector;
+class EncryptedImageProvider;
+
+/**
+ * @brief 加密图片的异步加载结果
+ * 在线程池中解密并解码，完成后发出 finished()
+ */
+class EncryptedImageResponse : public QQuickImageResponse, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    EncryptedImageResponse(EncryptedImageProvider *provider, const QString &id,
+                           const QSize &requestedSize);
+
+    QQuickTextureFactory *textureFactory() const override;
+    QString errorString() const override { return m_errorString; }
+    void cancel() override;
+
+    void run() override;
+
+private:
+    EncryptedImageProvider *m_provider;
+    QString m_id;
+    QSize m_requestedSize;
+    QImage m_image;
+    QString m_errorString;
+    QAtomicInteger<bool> m_canceled = false;
+    ResourceMetrics::Record *m_metrics = nullptr; // 未开启计量时为空
+    qint64 m_requestedAt = 0;
+};
+
+/**
+ * @brief 加密图片提供器,注册为 image://encrypted/<路径>
+ *
+ * 与 encrypted:/// 协议相比,解密和解码都在工作线程上进行,不经过 QNetworkReply;
+ * 按 requestedSize(即 QML 中的 sourceSize)在解码时直接缩小,不生成全分辨率图像;
+ * 解码结果按"路径 + 尺寸"放入共享的 QImage 缓存,同一图片的重复请求不再解密和解码。
+ */
+class EncryptedImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    explicit EncryptedImageProvider(EncryptedResourceSelector *selector);
+    ~EncryptedImageProvider() override;
+
+    QQuickImageResponse *requestImageResponse(const QString &id,
+                                              const QSize &requestedSize) override;
+
+    /**
+     * @brief 设置解码结果缓存的字节预算,0 表示不缓存
+     */
+    void setCacheBudget(qint64 bytes);
+
+private:
+    friend class EncryptedImageResponse;
+
+    /**
+     * @brief 解密并按请求尺寸解码(在工作线程上调用)
+     */
+    QImage loadImage(const QString &id, const QSize &requestedSize,
+                     const QAtomicInteger<bool> &canceled, QString *errorString);
+
+    static QString cacheKey(const QString &id, const QSize &requestedSize);
+
+    EncryptedResourceSelector *m_selector;
+    QThreadPool m_pool;
+    QMutex m_cacheMutex;
+    QCache<QString, QImage> m_cache;
+};
+
+#endif // ENCRYPTEDIMAGEPROVIDER_H
@@ -1,5 +1,7 @@
 #include "EncryptedNetworkAccessManager.h"
+#include "CipherBackend.h"
 #include "EncryptedResourceSelector.h"
+#include "ResourcePath.h"
 #include <QDebug>
 
 EncryptedNetworkAccessManager::EncryptedNetworkAccessManager(EncryptedResourceSelector *selector, QObject *parent)
@@ -13,30 +15,51 @@ QNetworkReply *EncryptedNetworkAccessManager::createRequest(Operation op, const
     const QUrl url = request.url();
     // 协议过滤：非自定义协议直接进入默认处理流程
     if (url.scheme() != "encrypted") return QNetworkAccessManager::createRequest(op, request, outgoingData);   
-    // 路径标准化：移除路径前缀的所有 '/' (例如 "/main.qml" -> "main.qml")
-    QString resourcePath = url.path();
-    while (resourcePath.startsWith('/')) resourcePath.remove(0, 1);
+    // 路径标准化：移除路径前缀的所有 '/' (例如 "/main.qml" -> "main.qml")，只移动视图不复制字符串。
+    // url.path() 是每个请求唯一一次路径字符串分配(QUrl 不提供路径视图)，之后的查找都不再分配
+    const QString urlPath = url.path();
+    QStringView resourcePath(urlPath);
+    while (resourcePath.startsWith(u'/')) resourcePath = resourcePath.mid(1);
     // 核心请求逻辑
     qDebug() << "[Network] 尝试加载加密资源:" << resourcePath;
-    // 尝试获取解密后的数据
-    QByteArray data = m_resourceSelector->getDecryptedResource(resourcePath);
+    // 大资源走流式解密：不在内存中生成完整明文
+    // 同一次注册表查找同时给出资源是否存在，请求线程上只查找一次
+    QByteArray ciphertext;
+    bool exists = false;
+    if (m_resourceSelector->findStreamableResource(resourcePath, &ciphertext, &exists)) {
+        qDebug() << "[Network] 流式解密大资源:" << resourcePath << ciphertext.size() << "字节";
+        return new EncryptedStreamReply(ciphertext, m_resourceSelector->decryptionKey(), url, this);
+    }
+    // 资源存在时立即返回回复，解密在线程池中进行，不阻塞当前线程；
+    // 工作线程上的解密还要经过缓存和预热，会再查找一次注册表
+    if (exists)
+        return new EncryptedAsyncReply(m_resourceSelector, urlPath, url, this);
     // 处理特殊情况：如果没找到对应数据，且是 qmldir 这种元数据请求，返回空内容以防止引擎报错
-    if (data.isEmpty() && resourcePath.endsWith("qmldir")) {
+    if (resourcePath.endsWith(QLatin1String("qmldir"))) {
         qDebug() << "[Network] 为 qmldir 提供空响应兜底";
-        return new EncryptedNetworkReply(QByteArray(), url, this);
+        return new EncryptedNetworkReply(PlaintextBuffer(), url, this);
     }
-    // 返回解密后的回复
-    if (!data.isEmpty()) return new EncryptedNetworkReply(data, url, this);
     // 兜底：如果完全没找到资源，按默认逻辑处理（通常会触发 404）
     qWarning() << "[Network] 资源既未加密也未找到:" << resourcePath;
     return QNetworkAccessManager::createRequest(op, request, outgoingData);
 }
 
+/**
+ * @brief 根据文件扩展名推断 Content-Type
+ */
+static QString contentTypeForPath(const QString &path)
+{
+    if (path.endsWith(".qml")) return QStringLiteral("text/plain");
+    if (path.endsWith(".js")) return QStringLiteral("application/javascript");
+    if (path.endsWith(".png")) return QStringLiteral("image/png");
+    if (path.endsWith(".jpg") || path.endsWith(".jpeg")) return QStringLiteral("image/jpeg");
+    return QStringLiteral("application/octet-stream");
+}
+
 // EncryptedNetworkReply 实现
-EncryptedNetworkReply::EncryptedNetworkReply(const QByteArray &data, const QUrl &url, QObject *parent)
+EncryptedNetworkReply::EncryptedNetworkReply(const PlaintextBuffer &data, const QUrl &url, QObject *parent)
     : QNetworkReply(parent)
     , m_data(data)
-    , m_offset(0)
 {
     setUrl(url);
     setOperation(QNetworkAccessManager::GetOperation);   
@@ -45,17 +68,15 @@ EncryptedNetworkReply::EncryptedNetworkReply(const QByteArray &data, const QUrl
     // 设置头信息
     setHeader(QNetworkRequest::ContentLengthHeader, QVariant(data.size()));
     // 根据文件扩展名设置 Content-Type
-    QString path = url.path();
-    if (path.endsWith(".qml")) setHeader(QNetworkRequest::ContentTypeHeader, QVariant("text/plain"));
-    else if (path.endsWith(".js")) setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/javascript"));
-    else if (path.endsWith(".png")) setHeader(QNetworkRequest::ContentTypeHeader, QVariant("image/png"));
-    else if (path.endsWith(".jpg") || path.endsWith(".jpeg")) setHeader(QNetworkRequest::ContentTypeHeader, QVariant("image/jpeg"));
-    else setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-stream"));
-    // 打开设备
+    setHeader(QNetworkRequest::ContentTypeHeader, QVariant(contentTypeForPath(url.path())));
+    // 打开设备：不使用 QIODevice 内部缓冲，读取时直接从共享缓冲区拷贝到调用方
     open(ReadOnly | Unbuffered);
+    setFinished(true);
     // 延迟发送信号
     QMetaObject::invokeMethod(this, [this]() {
-        if (m_data.size() > 0) emit readyRead();
+        const qint64 total = m_data.size();
+        emit downloadProgress(total, total);
+        if (total > 0) emit readyRead();
         emit finished();
     }, Qt::QueuedConnection);
 }
@@ -65,21 +86,201 @@ void EncryptedNetworkReply::abort()
     // 不需要特殊处理
 }
 
-qint64 EncryptedNetworkReply::bytesAvailable() const
+bool EncryptedNetworkReply::isSequential() const
 {
-    return m_data.size() - m_offset + QNetworkReply::bytesAvailable();
+    // 数据已完整驻留内存，作为随机访问设备暴露，
+    // readAll() 会按 size() 一次性分配并读取，而不是分块增长
+    return false;
 }
 
-bool EncryptedNetworkReply::isSequential() const
+qint64 EncryptedNetworkReply::size() const
 {
-    return true;
+    return m_data.size();
 }
 
 qint64 EncryptedNetworkReply::readData(char *data, qint64 maxlen)
 {
-    if (m_offset >= m_data.size()) return 0; // 改为 0: 表示 EOF，不是错误
-    qint64 number = qMin(maxlen, (qint64)(m_data.size() - m_offset));
-    memcpy(data, m_data.constData() + m_offset, number);
+    const qint64 offset = pos();
+    if (offset >= m_data.size()) return 0; // 0 表示 EOF，不是错误
+    const qint64 number = qMin(maxlen, qint64(m_data.size()) - offset);
+    memcpy(data, m_data.constData() + offset, number);
+    return number;
+}
+
+// EncryptedStreamReply 实现
+EncryptedStreamReply::EncryptedStreamReply(const QByteArray &ciphertext, const DerivedKey &key,
+                                           const QUrl &url, QObject *parent)
+    : QNetworkReply(parent)
+    , m_ciphertext(ciphertext)
+    , m_key(key)
+    , m_cipher(ResourceEncryption::openCipher(ciphertext, key, &m_payloadOffset))
+{
+    if (m_cipher) m_total = m_ciphertext.size() - m_payloadOffset;
+    setUrl(url);
+    setOperation(QNetworkAccessManager::GetOperation);
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+    // 流密码的密文负载与明文等长，总大小可以预先告知消费者
+    setHeader(QNetworkRequest::ContentLengthHeader, QVariant(m_total));
+    setHeader(QNetworkRequest::ContentTypeHeader, QVariant(contentTypeForPath(url.path())));
+    open(ReadOnly | Unbuffered);
+    // 第一块在下一次事件循环时公布，首字节延迟与资源大小无关
+    QMetaObject::invokeMethod(this, &EncryptedStreamReply::announceNextChunk, Qt::QueuedConnection);
+}
+
+EncryptedStreamReply::~EncryptedStreamReply() = default;
+
+void EncryptedStreamReply::abort()
+{
+    if (m_aborted || isFinished()) return;
+    m_aborted = true;
+    setError(OperationCanceledError, QStringLiteral("Operation canceled"));
+    setFinished(true);
+    emit errorOccurred(OperationCanceledError);
+    emit finished();
+}
+
+qint64 EncryptedStreamReply::bytesAvailable() const
+{
+    return m_available - m_offset + QNetworkReply::bytesAvailable();
+}
+
+bool EncryptedStreamReply::isSequential() const
+{
+    return true;
+}
+
+qint64 EncryptedStreamReply::readData(char *data, qint64 maxlen)
+{
+    if (m_aborted) return -1;
+    if (m_offset >= m_available) return 0;
+    const qint64 number = qMin(maxlen, m_available - m_offset);
+    // 直接从密文解密到调用方缓冲区，不经过中间明文
+    m_cipher->process(m_ciphertext.constData() + m_payloadOffset + m_offset, data, number, m_offset);
     m_offset += number;
     return number;
 }
+
+void EncryptedStreamReply::announceNextChunk()
+{
+    if (m_aborted) return;
+    if (!m_cipher) {
+        setError(UnknownContentError, QStringLiteral("Unsupported encrypted resource format"));
+        setFinished(true);
+        emit errorOccurred(UnknownContentError);
+        emit finished();
+        return;
+    }
+    const qint64 next = qMin(m_total, m_available + ChunkSize);
+    // ChunkSize 是标签块大小的整数倍,每个标签块只校验一次
+    if (!ResourceEncryption::verifyChunks(m_ciphertext, m_key, m_available, next - m_available)) {
+        qWarning() << "[Network] 完整性校验失败:" << url().toString();
+        setError(UnknownContentError, QStringLiteral("Encrypted resource integrity check failed"));
+        setFinished(true);
+        emit errorOccurred(UnknownContentError);
+        emit finished();
+        return;
+    }
+    m_available = next;
+    emit downloadProgress(m_available, m_total);
+    if (m_available > 0) emit readyRead();
+    if (m_available < m_total) {
+        QMetaObject::invokeMethod(this, &EncryptedStreamReply::announceNextChunk, Qt::QueuedConnection);
+    } else {
+        setFinished(true);
+        emit finished();
+    }
+}
+
+// EncryptedAsyncReply 实现
+EncryptedAsyncReply::EncryptedAsyncReply(EncryptedResourceSelector *selector,
+                                         const QString &resourcePath, const QUrl &url,
+                                         QObject *parent)
+    : QNetworkReply(parent)
+    , m_resourcePath(resourcePath)
+    , m_metrics(ResourceMetrics::instance().record(ResourcePath(resourcePath)))
+    , m_requestedAt(m_metrics ? ResourceMetrics::instance().now() : 0)
+{
+    setUrl(url);
+    setOperation(QNetworkAccessManager::GetOperation);
+    setHeader(QNetworkRequest::ContentTypeHeader, QVariant(contentTypeForPath(url.path())));
+    open(ReadOnly | Unbuffered);
+
+    connect(&m_watcher, &QFutureWatcherBase::finished, this, &EncryptedAsyncReply::onDecrypted);
+    // 任务运行在选择器自己的线程池上,选择器析构前会等待它结束
+    m_watcher.setFuture(selector->decryptedBufferAsync(resourcePath));
+}
+
+EncryptedAsyncReply::~EncryptedAsyncReply()
+{
+    // 回复被提前销毁时通知工作线程尽快放弃
+    m_watcher.disconnect(this);
+    m_watcher.cancel();
+}
+
+void EncryptedAsyncReply::abort()
+{
+    if (isFinished()) return;
+    m_watcher.disconnect(this);
+    m_watcher.cancel();
+    setError(OperationCanceledError, QStringLiteral("Operation canceled"));
+    setFinished(true);
+    emit errorOccurred(OperationCanceledError);
+    emit finished();
+}
+
+bool EncryptedAsyncReply::isSequential() const
+{
+    return false;
+}
+
+qint64 EncryptedAsyncReply::size() const
+{
+    return m_data.size();
+}
+
+qint64 EncryptedAsyncReply::readData(char *data, qint64 maxlen)
+{
+    const qint64 offset = pos();
+    if (offset >= m_data.size()) return 0;
+    const qint64 number = qMin(maxlen, qint64(m_data.size()) - offset);
+    memcpy(data, m_data.constData() + offset, number);
+    return number;
+}
+
+void EncryptedAsyncReply::onDecrypted()
+{
+    const QFuture<PlaintextBuffer> future = m_watcher.future();
+    if (future.isCanceled() || future.resultCount() == 0) return;
+    m_data = future.result();
+
+    // 解密失败：qmldir 以空内容兜底，其他资源报告未找到
+    if (m_data.isEmpty() && !m_resourcePath.endsWith("qmldir")) {
+        setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 404);
+        setError(ContentNotFoundError, QStringLiteral("Encrypted resource not available"));
+        setFinished(true);
+        recordDelivery();
+        emit errorOccurred(ContentNotFoundError);
+        emit finished();
+        return;
+    }
+
+    setAttribute(QNetworkRequest::HttpStatusCodeAttribute, 200);
+    setHeader(QNetworkRequest::ContentLengthHeader, QVariant(m_data.size()));
+    setFinished(true);
+    const qint64 total = m_data.size();
+    emit metaDataChanged();
+    emit downloadProgress(total, total);
+    if (total > 0) emit readyRead();
+    recordDelivery();
+    emit finished();
+}
+
+void EncryptedAsyncReply::recordDelivery()
+{
+    // 交付延迟:从创建回复到在回复线程上发出 finished,包括线程池排队和事件循环调度
+    if (!m_metrics) return;
+    ResourceMetrics &meter = ResourceMetrics::instance();
+    const qint64 now = meter.now();
+    m_metrics->addDelivery(now - m_requestedAt);
+    meter.traceSpan("request", m_metrics, m_requestedAt, now, m_data.size());
+}
@@ -1,11 +1,16 @@
 #ifndef ENCRYPTEDNETWORKACCESSMANAGER_H
 #define ENCRYPTEDNETWORKACCESSMANAGER_H
 
+#include <QFutureWatcher>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QString>
 #include <QHash>
 
+#include "PlaintextArena.h"
+#include "ResourceEncryption.h"
+#include "ResourceMetrics.h"
+
 class EncryptedResourceSelector;
 
 /**
@@ -49,24 +54,97 @@ private:
 
 /**
  * @brief 自定义网络回复,返回解密后的数据
+ * 持有与解密结果共享的明文句柄,构造后不再复制数据,回复销毁后明文随句柄清零;
+ * 以随机访问设备暴露,size() 预先给出总长度,readAll() 只做一次精确大小的拷贝
  */
 class EncryptedNetworkReply : public QNetworkReply
 {
     Q_OBJECT
     
 public:
-    explicit EncryptedNetworkReply(const QByteArray &data, const QUrl &url, QObject *parent = nullptr);
+    explicit EncryptedNetworkReply(const PlaintextBuffer &data, const QUrl &url, QObject *parent = nullptr);
     
     void abort() override;
-    qint64 bytesAvailable() const override;
     bool isSequential() const override;
+    qint64 size() const override;
     
 protected:
     qint64 readData(char *data, qint64 maxlen) override;
     
 private:
-    QByteArray m_data;
-    qint64 m_offset;
+    const PlaintextBuffer m_data;
+};
+
+/**
+ * @brief 流式解密的网络回复,用于大资源
+ * 只持有(映射的)密文,readData 时把请求的片段直接解密到调用方缓冲区;
+ * 按块递增地发出 readyRead/downloadProgress,峰值内存与资源大小无关;
+ * 每块公布前先校验其覆盖的密文标签,未公布的部分不做校验
+ */
+class EncryptedStreamReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    // 每次事件循环向消费者公布的数据量
+    static constexpr qint64 ChunkSize = 256 * 1024;
+
+    explicit EncryptedStreamReply(const QByteArray &ciphertext, const DerivedKey &key,
+                                  const QUrl &url, QObject *parent = nullptr);
+    ~EncryptedStreamReply() override;
+
+    void abort() override;
+    qint64 bytesAvailable() const override;
+    bool isSequential() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+
+private:
+    void announceNextChunk();
+
+    const QByteArray m_ciphertext;
+    const DerivedKey m_key;
+    std::unique_ptr<CipherBackend> m_cipher;
+    qsizetype m_payloadOffset = 0; // 跳过文件头部和标签表
+    qint64 m_total = 0;            // 明文总长度
+    qint64 m_available = 0; // 已公布给消费者的字节数
+    qint64 m_offset = 0;
+    bool m_aborted = false;
+};
+
+/**
+ * @brief 异步解密的网络回复
+ * 构造后立即返回，查找和解密在线程池中进行，完成后在回复所在线程发出
+ * readyRead/finished；abort() 会取消尚未完成的解密。
+ * 数据就绪后与 EncryptedNetworkReply 相同，以随机访问设备暴露共享的明文。
+ * resourcePath 可以带开头的 '/'，调用方直接传入 url.path() 即可，不必再复制
+ */
+class EncryptedAsyncReply : public QNetworkReply
+{
+    Q_OBJECT
+
+public:
+    explicit EncryptedAsyncReply(EncryptedResourceSelector *selector, const QString &resourcePath,
+                                 const QUrl &url, QObject *parent = nullptr);
+    ~EncryptedAsyncReply() override;
+
+    void abort() override;
+    bool isSequential() const override;
+    qint64 size() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxlen) override;
+
+private:
+    void onDecrypted();
+    void recordDelivery();
+
+    QFutureWatcher<PlaintextBuffer> m_watcher;
+    QString m_resourcePath;
+    PlaintextBuffer m_data;
+    ResourceMetrics::Record *m_metrics = nullptr; // 未开启计量时为空
+    qint64 m_requestedAt = 0;
 };
 
 #endif // ENCRYPTEDNETWORKACCESSMANAGER_H
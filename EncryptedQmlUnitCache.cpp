@@ -0,0 +1,177 @@
+#include "EncryptedQmlUnitCache.h"
+#include "EncryptedResourceSelector.h"
+#include <QDebug>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QtEndian>
+#include <cstring>
+#include <memory>
+
+namespace {
+
+// QV4::CompiledData::Unit 头部中本钩子需要校验的字段
+// magic[8], version(u32), qtVersion(u32), sourceTimeStamp(i64), unitSize(u32)
+constexpr char UnitMagic[] = "qv4cdata";
+constexpr qsizetype QtVersionOffset = 12;
+constexpr qsizetype UnitSizeOffset = 24;
+constexpr qsizetype MinimumUnitSize = 28;
+
+struct LoadedUnit {
+    // 内存池中的明文按页对齐,直接持有;其他来源复制到 data
+    PlaintextBuffer plaintext;
+    std::unique_ptr<char[]> data;
+    QQmlPrivate::CachedQmlUnit unit = {};
+};
+
+/**
+ * @brief 全进程共享的钩子状态
+ * 引擎只接受无上下文的函数指针,同一进程内的多个实例共用一次注册
+ */
+struct HookState {
+    // 查找时持有读锁,解密在读锁下并行进行;注册和注销实例时持有写锁
+    QReadWriteLock cachesLock;
+    QList<EncryptedQmlUnitCache *> caches;
+    // 保护 units 和 rejected,只在查表和插入时短暂持有
+    QMutex mutex;
+    // 按 URL 保存已解密的字节码,进程退出前不释放
+    QHash<QString, LoadedUnit *> units;
+    // 没有可用预编译单元的 URL(不存在、数据无效或版本不符),不再重复解密和告警
+    QSet<QString> rejected;
+    QQmlPrivate::RegisterQmlUnitCacheHook registration = {};
+};
+
+HookState &hookState()
+{
+    static HookState state;
+    return state;
+}
+
+} // namespace
+
+EncryptedQmlUnitCache::EncryptedQmlUnitCache(EncryptedResourceSelector *selector)
+    : m_selector(selector)
+{
+    HookState &state = hookState();
+    QWriteLocker locker(&state.cachesLock);
+    {
+        // 新实例可能提供之前找不到的单元
+        QMutexLocker unitsLocker(&state.mutex);
+        state.rejected.clear();
+    }
+    if (state.caches.isEmpty()) {
+        state.registration.structVersion = 0;
+        state.registration.lookupCachedQmlUnit = &EncryptedQmlUnitCache::lookup;
+        QQmlPrivate::qmlregister(QQmlPrivate::QmlUnitCacheHookRegistration, &state.registration);
+    }
+    state.caches.append(this);
+}
+
+EncryptedQmlUnitCache::~EncryptedQmlUnitCache()
+{
+    HookState &state = hookState();
+    QWriteLocker locker(&state.cachesLock);
+    state.caches.removeOne(this);
+    if (state.caches.isEmpty()) {
+        QQmlPrivate::qmlunregister(QQmlPrivate::QmlUnitCacheHookRegistration,
+                                   quintptr(&EncryptedQmlUnitCache::lookup));
+    }
+}
+
+EncryptedQmlUnitCache::Stats EncryptedQmlUnitCache::stats() const
+{
+    Stats stats;
+    stats.hits = m_hits.loadRelaxed();
+    stats.fallbacks = m_fallbacks.loadRelaxed();
+    return stats;
+}
+
+const QQmlPrivate::CachedQmlUnit *EncryptedQmlUnitCache::lookup(const QUrl &url)
+{
+    // 引擎对每个要加载的 QML 文件都会调用钩子,其他协议尽快返回
+    if (url.scheme() != QLatin1String("encrypted")) {
+        return nullptr;
+    }
+    QString path = url.path();
+    while (path.startsWith('/')) path.remove(0, 1);
+    if (!path.endsWith(QLatin1String(".qml"))) {
+        return nullptr;
+    }
+
+    HookState &state = hookState();
+    QReadLocker cachesLocker(&state.cachesLock);
+    const QString key = url.toString();
+    {
+        QMutexLocker locker(&state.mutex);
+        if (LoadedUnit *loaded = state.units.value(key)) {
+            return &loaded->unit;
+        }
+        if (state.rejected.contains(key)) {
+            return nullptr;
+        }
+    }
+    // 解密不持有 mutex,不同文件的加载互不等待
+    for (EncryptedQmlUnitCache *cache : std::as_const(state.caches)) {
+        PlaintextBuffer bytecode;
+        if (!cache->decryptUnit(path, &bytecode)) {
+            continue;
+        }
+        // 字节码需要满足 new 的对齐要求,且不随选择器的明文缓存淘汰:
+        // 内存池中的块按页对齐,持有句柄即可;其他来源复制到独立分配的内存
+        auto loaded = new LoadedUnit;
+        if (bytecode.isPooled()) {
+            loaded->plaintext = bytecode;
+            loaded->unit.qmlData = reinterpret_cast<const QV4::CompiledData::Unit *>(bytecode.constData());
+        } else {
+            loaded->data.reset(new char[bytecode.size()]);
+            std::memcpy(loaded->data.get(), bytecode.constData(), bytecode.size());
+            loaded->unit.qmlData = reinterpret_cast<const QV4::CompiledData::Unit *>(loaded->data.get());
+        }
+        QMutexLocker locker(&state.mutex);
+        // 另一个线程同时加载了同一文件时使用先插入的单元,引擎可能已经引用了它
+        if (LoadedUnit *existing = state.units.value(key)) {
+            delete loaded;
+            return &existing->unit;
+        }
+        state.units.insert(key, loaded);
+        cache->m_hits.fetchAndAddRelaxed(1);
+        return &loaded->unit;
+    }
+    QMutexLocker locker(&state.mutex);
+    state.rejected.insert(key);
+    return nullptr;
+}
+
+bool EncryptedQmlUnitCache::decryptUnit(const QString &path, PlaintextBuffer *bytecode)
+{
+    const QString compiledPath = unitPath(path);
+    if (!m_selector->hasResource(compiledPath)) {
+        return false;
+    }
+    const PlaintextBuffer plaintext = m_selector->decryptedBuffer(compiledPath);
+    const QByteArray data = plaintext.bytes();
+    if (data.size() < MinimumUnitSize
+        || std::memcmp(data.constData(), UnitMagic, sizeof(UnitMagic) - 1) != 0
+        || qFromLittleEndian<quint32>(data.constData() + UnitSizeOffset) != quint32(data.size())) {
+        qWarning() << "[QmlUnit] 预编译数据无效, 回退到源码:" << compiledPath;
+        m_fallbacks.fetchAndAddRelaxed(1);
+        return false;
+    }
+    // 引擎同样会校验,这里提前拒绝以便给出明确的提示
+    const quint32 qtVersion = qFromLittleEndian<quint32>(data.constData() + QtVersionOffset);
+    if (qtVersion != quint32(QT_VERSION)) {
+        qWarning().noquote() << QString("[QmlUnit] %1 由 Qt %2.%3.%4 编译, 与运行时 %5 不符, 回退到源码")
+                                    .arg(compiledPath)
+                                    .arg(qtVersion >> 16)
+                                    .arg((qtVersion >> 8) & 0xff)
+                                    .arg(qtVersion & 0xff)
+                                    .arg(QT_VERSION_STR);
+        m_fallbacks.fetchAndAddRelaxed(1);
+        return false;
+    }
+    *bytecode = plaintext;
+    return true;
+}
@@ -0,0 +1,57 @@
+#ifndef ENCRYPTEDQMLUNITCACHE_H
+#define ENCRYPTEDQMLUNITCACHE_H
+
+#include <QAtomicInteger>
+#include <QString>
+#include <QUrl>
+#include <QtQml/qqmlprivate.h>
+
+#include "PlaintextArena.h"
+
+class EncryptedResourceSelector;
+
+/**
+ * @brief 预编译 QML 的加载钩子
+ *
+ * 通过 qmlcachegen 的单元缓存钩子向引擎提供编译好的字节码:引擎加载 encrypted:/xxx.qml
+ * 之前先查询本钩子,选择器中存在 xxx.qmlc 时直接解密并交给引擎,不再获取、解析和编译源码,
+ * 内存中不会出现 QML 源码文本;但字节码本身含有字符串表(标识符、字符串字面量等),
+ * 解密时也会经过选择器(开启明文缓存时留在缓存中),并非没有可读的明文。
+ * 字节码与编译它的 Qt 版本绑定,版本不符或条目不存在时返回空,引擎照常通过 encrypted:///
+ * 协议加载源码;这样的结果会被记住,同一 URL 不再重复解密和告警。
+ *
+ * 解密在钩子的全局锁之外进行,不同文件的加载可以并行。
+ *
+ * 解密后的字节码在进程生命周期内保留:引擎(以及跨引擎共享的编译单元)直接引用这块内存。
+ */
+class EncryptedQmlUnitCache
+{
+public:
+    struct Stats {
+        quint64 hits = 0;      // 解密并交给引擎的预编译单元数
+        quint64 fallbacks = 0; // 存在 .qmlc 但版本不符、回退到源码的次数
+    };
+
+    explicit EncryptedQmlUnitCache(EncryptedResourceSelector *selector);
+    ~EncryptedQmlUnitCache();
+
+    Stats stats() const;
+
+    /**
+     * @brief QML 源码路径对应的预编译条目路径(main.qml -> main.qmlc)
+     */
+    static QString unitPath(const QString &qmlPath) { return qmlPath + QLatin1Char('c'); }
+
+private:
+    static const QQmlPrivate::CachedQmlUnit *lookup(const QUrl &url);
+    /**
+     * @brief 解密并校验 path 对应的预编译单元,不持有钩子的锁
+     */
+    bool decryptUnit(const QString &path, PlaintextBuffer *bytecode);
+
+    EncryptedResourceSelector *m_selector;
+    QAtomicInteger<quint64> m_hits = 0;
+    QAtomicInteger<quint64> m_fallbacks = 0;
+};
+
+#endif // ENCRYPTEDQMLUNITCACHE_H
@@ -0,0 +1,125 @@
+#include "EncryptedResourceDirectory.h"
+#include "EncryptedArchive.h"
+#include "ResourcePath.h"
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QMutexLocker>
+#include <QResource>
+
+bool EncryptedResourceDirectory::open(const QString &directory, const QString &suffix)
+{
+    const QDir root(directory);
+    if (!root.exists()) {
+        qWarning() << "[Lazy] 资源目录不存在:" << directory;
+        return false;
+    }
+    m_directory = directory;
+    m_isResource = directory.startsWith(QLatin1Char(':'));
+
+    // 只收集文件名,不打开文件
+    QList<QPair<QString, QString>> found; // 虚拟路径, 位置
+    QDirIterator it(directory, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString location = it.next();
+        if (!location.endsWith(suffix))
+            continue;
+        QString virtualPath = root.relativeFilePath(location);
+        virtualPath.chop(suffix.size());
+        found.append({virtualPath, location});
+    }
+
+    m_entryCount = quint32(found.size());
+    m_entries.reset(new Entry[found.size()]);
+    // 装载因子不超过 1/2,线性探测
+    qsizetype size = 16;
+    while (size < found.size() * 2) size *= 2;
+    m_mask = quint64(size - 1);
+    m_table.fill(-1, size);
+    for (qsizetype i = 0; i < found.size(); ++i) {
+        Entry &entry = m_entries[i];
+        entry.utf8Path = found.at(i).first.toUtf8();
+        entry.hash = resourcePathHash(entry.utf8Path);
+        entry.location = found.at(i).second;
+        quint64 slot = entry.hash & m_mask;
+        while (m_table.at(slot) >= 0) slot = (slot + 1) & m_mask;
+        m_table[slot] = qint32(i);
+    }
+
+    qDebug() << "[Lazy] 已索引加密资源目录:" << directory << "条目数:" << m_entryCount;
+    return true;
+}
+
+QStringList EncryptedResourceDirectory::entryPaths() const
+{
+    QStringList paths;
+    paths.reserve(int(m_entryCount));
+    for (quint32 i = 0; i < m_entryCount; ++i)
+        paths.append(QString::fromUtf8(m_entries[i].utf8Path));
+    return paths;
+}
+
+const EncryptedResourceDirectory::Entry *EncryptedResourceDirectory::findEntry(const ResourcePath &path) const
+{
+    if (m_entryCount == 0) return nullptr;
+    const QByteArrayView utf8 = path.utf8();
+    for (quint64 slot = path.hash() & m_mask;; slot = (slot + 1) & m_mask) {
+        const qint32 index = m_table.at(slot);
+        if (index < 0) return nullptr;
+        const Entry &entry = m_entries[index];
+        if (entry.hash == path.hash() && QByteArrayView(entry.utf8Path) == utf8) return &entry;
+    }
+}
+
+bool EncryptedResourceDirectory::contains(const ResourcePath &path) const
+{
+    return findEntry(path) != nullptr;
+}
+
+bool EncryptedResourceDirectory::lookup(const ResourcePath &path, QByteArray *data, quint32 *flags) const
+{
+    const Entry *entry = findEntry(path);
+    if (!entry) return false;
+    if (!entry->resolved.load(std::memory_order_acquire))
+        resolve(*entry);
+    if (entry->data.isNull()) return false;
+    *data = entry->data;
+    if (flags) *flags = EncryptedArchive::Encrypted;
+    return true;
+}
+
+void EncryptedResourceDirectory::resolve(const Entry &entry) const
+{
+    QMutexLocker locker(&m_resolveMutex);
+    if (entry.resolved.load(std::memory_order_relaxed))
+        return;
+
+    if (m_isResource) {
+        const QResource resource(entry.location);
+        if (resource.isValid() && resource.size() == 0) {
+            entry.data = QByteArray("");
+        } else if (resource.isValid() && resource.compressionAlgorithm() == QResource::NoCompression) {
+            // 数据位于程序映像中,进程生命周期内有效
+            entry.data = QByteArray::fromRawData(reinterpret_cast<const char *>(resource.data()),
+                                                 qsizetype(resource.size()));
+        } else if (resource.isValid()) {
+            // rcc 压缩过的条目(密文通常不会被压缩)只能解压出一份副本
+            entry.data = resource.uncompressedData();
+        }
+    } else {
+        auto file = std::make_unique<QFile>(entry.location);
+        if (file->open(QIODevice::ReadOnly)) {
+            if (file->size() == 0) {
+                entry.data = QByteArray("");
+            } else if (uchar *mapped = file->map(0, file->size())) {
+                entry.data = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), file->size());
+                entry.file = std::move(file);
+            } else {
+                entry.data = file->readAll();
+            }
+        }
+    }
+    if (entry.data.isNull())
+        qWarning() << "[Lazy] 无法读取加密资源:" << entry.location;
+    entry.resolved.store(true, std::memory_order_release);
+}
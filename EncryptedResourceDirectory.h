@@ -0,0 +1,76 @@
+#ifndef ENCRYPTEDRESOURCEDIRECTORY_H
+#define ENCRYPTEDRESOURCEDIRECTORY_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+
+class ResourcePath;
+
+/**
+ * @brief 按需解析的加密资源目录(qrc 前缀或本地目录)
+ *
+ * open() 只遍历文件名,建立"虚拟路径 -> 位置"的查找表,不读取任何文件内容,
+ * 启动开销只与文件数量相关,与资源总字节数无关。条目在首次被请求时才解析:
+ * 未压缩的 qrc 资源直接引用 QResource 的数据指针(零拷贝,数据常驻在程序映像中),
+ * 本地文件映射到内存;两者都不可用时才整体读入。解析结果保留到目录销毁。
+ *
+ * 虚拟路径为相对目录的路径去掉后缀,例如 :/encrypted/images/a.png.enc -> images/a.png。
+ */
+class EncryptedResourceDirectory
+{
+public:
+    EncryptedResourceDirectory() = default;
+    Q_DISABLE_COPY(EncryptedResourceDirectory)
+
+    /**
+     * @brief 索引目录
+     * @param directory qrc 前缀(":/encrypted")或本地目录
+     * @param suffix 只收录带此后缀的文件,虚拟路径中去掉该后缀
+     * @return 目录存在时返回 true
+     */
+    bool open(const QString &directory, const QString &suffix = QStringLiteral(".enc"));
+
+    QString directory() const { return m_directory; }
+    int entryCount() const { return int(m_entryCount); }
+    QStringList entryPaths() const;
+
+    bool contains(const ResourcePath &path) const;
+
+    /**
+     * @brief 查找条目,首次请求时解析数据
+     * 返回的 QByteArray 直接引用资源数据或映射内存,只在目录存活期间有效
+     * @param flags 可选,输出条目标志(EncryptedArchive::EntryFlag),目录中的条目总是密文
+     * @return 条目是否存在且可读
+     */
+    bool lookup(const ResourcePath &path, QByteArray *data, quint32 *flags = nullptr) const;
+
+private:
+    struct Entry {
+        quint64 hash = 0;
+        QByteArray utf8Path;
+        QString location;
+        // 首次请求时在 m_resolveMutex 内填写,resolved 为 true 之后只读,读取不需要加锁
+        mutable std::atomic<bool> resolved{false};
+        mutable QByteArray data;
+        mutable std::unique_ptr<QFile> file; // 映射的本地文件
+    };
+
+    const Entry *findEntry(const ResourcePath &path) const;
+    void resolve(const Entry &entry) const;
+
+    QString m_directory;
+    bool m_isResource = false;
+    std::unique_ptr<Entry[]> m_entries;
+    quint32 m_entryCount = 0;
+    QList<qint32> m_table; // 槽位 -> m_entries 下标,-1 表示空
+    quint64 m_mask = 0;
+    mutable QMutex m_resolveMutex;
+};
+
+#endif // ENCRYPTEDRESOURCEDIRECTORY_H
@@ -0,0 +1,274 @@
+#include "EncryptedResourceMount.h"
+#include "EncryptedResourceSelector.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QLocale>
+#include <QResource>
+#include <QUrl>
+#include <QtEndian>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// rcc 树节点标志
+constexpr quint16 DirectoryFlag = 0x02;
+// 版本 2 的树节点:名称偏移(4) 标志(2) 子节点数/地区+语言(4) 首个子节点/数据偏移(4) 修改时间(8)
+constexpr int NodeSize = 22;
+constexpr int HeaderSize = 20;
+
+/**
+ * @brief QResource 查找子节点时使用的名称哈希(与 qt_hash 相同)
+ */
+quint32 nameHash(QStringView name)
+{
+    quint32 h = 0;
+    for (QChar c : name) {
+        h = (h << 4) + c.unicode();
+        h ^= (h & 0xf0000000) >> 23;
+        h &= 0x0fffffff;
+    }
+    return h;
+}
+
+void append16(QByteArray &out, quint16 value)
+{
+    value = qToBigEndian(value);
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void append32(QByteArray &out, quint32 value)
+{
+    value = qToBigEndian(value);
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void append64(QByteArray &out, quint64 value)
+{
+    value = qToBigEndian(value);
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+struct Node {
+    QString name;
+    quint32 hash = 0;
+    int file = -1; // files 下标,-1 表示目录
+    QList<int> children;
+    quint32 firstChild = 0;
+    quint32 nameOffset = 0;
+    quint32 dataOffset = 0;
+};
+
+} // namespace
+
+EncryptedResourceMount::EncryptedResourceMount(EncryptedResourceSelector *selector, const QString &root)
+    : m_selector(selector)
+    , m_root(root.endsWith(QLatin1Char('/')) ? root.chopped(1) : root)
+{
+}
+
+EncryptedResourceMount::~EncryptedResourceMount()
+{
+    if (m_registered) {
+        QResource::unregisterResource(reinterpret_cast<const uchar *>(m_data.constData()), m_root);
+    }
+    // 注销后不再有人引用这块内存,清除其中的明文
+    std::fill(m_data.begin(), m_data.end(), '\0');
+}
+
+bool EncryptedResourceMount::mount(const QStringList &paths)
+{
+    if (m_registered) {
+        qWarning() << "[Mount] 已经挂载,不能重复挂载:" << m_root;
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<QPair<QString, QByteArray>> files;
+    // files 中是明文的视图,构建完成前句柄必须存活
+    QList<PlaintextBuffer> plaintexts;
+    files.reserve(paths.size());
+    plaintexts.reserve(paths.size());
+    for (const QString &raw : paths) {
+        QString path = raw;
+        while (path.startsWith(QLatin1Char('/'))) path.remove(0, 1);
+        if (path.isEmpty() || m_paths.contains(path)) {
+            continue;
+        }
+        const PlaintextBuffer plaintext = m_selector->decryptedBuffer(path);
+        // 空文件(例如空的 qmldir)同样挂载,只跳过不存在或解密失败的条目
+        if (plaintext.isEmpty() && !m_selector->hasResource(path)) {
+            qWarning() << "[Mount] 资源不存在,跳过:" << path;
+            continue;
+        }
+        files.append({path, plaintext.bytes()});
+        plaintexts.append(plaintext);
+        m_paths.insert(path);
+    }
+
+    m_data = buildResourceData(files);
+    // 明文已经复制进资源树,释放句柄后内存池中的副本随之清零
+    files.clear();
+    plaintexts.clear();
+    if (!QResource::registerResource(reinterpret_cast<const uchar *>(m_data.constData()), m_root)) {
+        qWarning() << "[Mount] 注册内存资源失败:" << m_root;
+        m_paths.clear();
+        std::fill(m_data.begin(), m_data.end(), '\0');
+        m_data.clear();
+        return false;
+    }
+    m_registered = true;
+
+    qDebug() << "[Mount] 已挂载到" << (QLatin1Char(':') + m_root) << "条目数:" << m_paths.size()
+             << "字节数:" << m_data.size() << "耗时(ms):" << timer.nsecsElapsed() / 1e6;
+    return true;
+}
+
+QUrl EncryptedResourceMount::localUrl(const QString &path) const
+{
+    QUrl url;
+    url.setScheme(QStringLiteral("qrc"));
+    url.setPath(m_root + QLatin1Char('/') + path);
+    return url;
+}
+
+QUrl EncryptedResourceMount::intercept(const QUrl &url, DataType type)
+{
+    Q_UNUSED(type);
+    // 由引擎的加载线程调用;挂载完成后 m_paths 只读,不需要加锁
+    if (!m_registered) {
+        return url;
+    }
+    const QString scheme = url.scheme();
+    if (scheme == QLatin1String("encrypted")) {
+        QString path = url.path();
+        while (path.startsWith(QLatin1Char('/'))) path.remove(0, 1);
+        return m_paths.contains(path) ? localUrl(path) : url;
+    }
+    if (scheme == QLatin1String("qrc")) {
+        const QString path = url.path();
+        if (path.size() > m_root.size() && path.startsWith(m_root) && path.at(m_root.size()) == QLatin1Char('/')) {
+            const QString relative = path.mid(m_root.size() + 1);
+            if (!m_paths.contains(relative)) {
+                // 挂载的组件按相对路径引用了未挂载的资源(例如图片),交回网络管理器
+                QUrl remote;
+                remote.setScheme(QStringLiteral("encrypted"));
+                remote.setPath(QLatin1Char('/') + relative);
+                return remote;
+            }
+        }
+    }
+    return url;
+}
+
+QStringList EncryptedResourceMount::codePaths(const QStringList &paths)
+{
+    QStringList result;
+    for (const QString &path : paths) {
+        if (path.endsWith(QLatin1String(".qml")) || path.endsWith(QLatin1String(".js"))
+            || path.endsWith(QLatin1String(".mjs")) || path == QLatin1String("qmldir")
+            || path.endsWith(QLatin1String("/qmldir"))) {
+            result.append(path);
+        }
+    }
+    return result;
+}
+
+QByteArray EncryptedResourceMount::buildResourceData(const QList<QPair<QString, QByteArray>> &files)
+{
+    // 按路径建立目录树,nodes[0] 为根目录
+    std::vector<Node> nodes(1);
+    for (int i = 0; i < files.size(); ++i) {
+        const QStringList segments = files.at(i).first.split(QLatin1Char('/'), Qt::SkipEmptyParts);
+        int current = 0;
+        for (int s = 0; s < segments.size(); ++s) {
+            const bool last = s + 1 == segments.size();
+            int found = -1;
+            for (int child : nodes[current].children) {
+                if (nodes[child].name == segments.at(s)) {
+                    found = child;
+                    break;
+                }
+            }
+            if (found >= 0 && (last || nodes[found].file >= 0)) {
+                qWarning() << "[Mount] 资源路径冲突,跳过:" << files.at(i).first;
+                break;
+            }
+            if (found < 0) {
+                Node node;
+                node.name = segments.at(s);
+                node.hash = nameHash(node.name);
+                node.file = last ? i : -1;
+                nodes.push_back(node);
+                found = int(nodes.size()) - 1;
+                nodes[current].children.append(found);
+            }
+            current = found;
+        }
+    }
+
+    // 按广度优先排列:同一目录的子节点连续存放并按名称哈希升序,QResource 在其中二分查找
+    QList<int> order{0};
+    for (int i = 0; i < order.size(); ++i) {
+        Node &node = nodes[order.at(i)];
+        if (node.file >= 0) {
+            continue;
+        }
+        std::sort(node.children.begin(), node.children.end(), [&nodes](int a, int b) {
+            return nodes[a].hash != nodes[b].hash ? nodes[a].hash < nodes[b].hash : nodes[a].name < nodes[b].name;
+        });
+        node.firstChild = quint32(order.size());
+        order += node.children;
+    }
+
+    QByteArray names;
+    QByteArray payloads;
+    for (int index : order) {
+        Node &node = nodes[index];
+        if (index != 0) {
+            node.nameOffset = quint32(names.size());
+            append16(names, quint16(node.name.size()));
+            append32(names, node.hash);
+            for (QChar c : node.name) append16(names, c.unicode());
+        }
+        if (node.file >= 0) {
+            const QByteArray &content = files.at(node.file).second;
+            node.dataOffset = quint32(payloads.size());
+            append32(payloads, quint32(content.size()));
+            payloads.append(content);
+        }
+    }
+
+    QByteArray tree;
+    tree.reserve(order.size() * NodeSize);
+    for (int index : order) {
+        const Node &node = nodes[index];
+        append32(tree, node.nameOffset);
+        if (node.file >= 0) {
+            append16(tree, 0);
+            append16(tree, quint16(QLocale::AnyTerritory));
+            append16(tree, quint16(QLocale::C));
+            append32(tree, node.dataOffset);
+        } else {
+            append16(tree, DirectoryFlag);
+            append32(tree, quint32(node.children.size()));
+            append32(tree, node.firstChild);
+        }
+        // 修改时间为 0:引擎不为没有时间戳的源码写磁盘缓存
+        append64(tree, 0);
+    }
+
+    QByteArray data;
+    data.reserve(HeaderSize + tree.size() + names.size() + payloads.size());
+    data.append("qres", 4);
+    append32(data, 2);
+    append32(data, quint32(HeaderSize));                             // 树
+    append32(data, quint32(HeaderSize + tree.size() + names.size())); // 数据
+    append32(data, quint32(HeaderSize + tree.size()));               // 名称
+    data.append(tree);
+    data.append(names);
+    data.append(payloads);
+    std::fill(payloads.begin(), payloads.end(), '\0');
+    return data;
+}
@@ -0,0 +1,83 @@
+#ifndef ENCRYPTEDRESOURCEMOUNT_H
+#define ENCRYPTEDRESOURCEMOUNT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QQmlAbstractUrlInterceptor>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class EncryptedResourceSelector;
+
+/**
+ * @brief 把加密资源解密到内存,以 qrc 资源的形式交给引擎
+ *
+ * encrypted:/ 走 QNetworkAccessManager:每个请求都要创建应答对象、排队发出信号,
+ * 引擎也把它当作远程 URL 异步加载。挂载时把选定条目一次解密,在内存中按 rcc 格式
+ * 生成资源树并通过 QResource::registerResource 注册到 :/<根>/ 下;
+ * 同时作为 URL 拦截器把已挂载的 encrypted:/ 地址改写为 qrc:/<根>/,
+ * 引擎随即按本地文件同步加载。未挂载的路径保持原样,仍由网络管理器提供,
+ * 指向挂载根下但未挂载的 qrc 地址则改回 encrypted:/。
+ *
+ * 资源树不带修改时间,引擎不会把由明文编译的缓存写到磁盘。
+ * 注意明文在挂载期间常驻内存,进程内任何代码都能以 ":/<根>/..." 读到,
+ * 只适合挂载 QML/JS 等需要快速加载的少量条目。
+ *
+ * 必须在引擎开始加载之前挂载,并在引擎销毁之后才销毁本对象。
+ */
+class EncryptedResourceMount : public QQmlAbstractUrlInterceptor
+{
+public:
+    /**
+     * @param selector 提供解密的选择器
+     * @param root 挂载根,例如 "/encrypted-mount"
+     */
+    explicit EncryptedResourceMount(EncryptedResourceSelector *selector,
+                                    const QString &root = QStringLiteral("/encrypted-mount"));
+    ~EncryptedResourceMount() override;
+
+    EncryptedResourceMount(const EncryptedResourceMount &) = delete;
+    EncryptedResourceMount &operator=(const EncryptedResourceMount &) = delete;
+
+    /**
+     * @brief 解密并注册资源,只能调用一次
+     * @param paths 资源路径(相对路径,例如 "main.qml")
+     * @return 注册成功时返回 true;不存在的路径跳过并给出警告
+     */
+    bool mount(const QStringList &paths);
+
+    bool isMounted() const { return m_registered; }
+    bool contains(const QString &path) const { return m_paths.contains(path); }
+    int entryCount() const { return int(m_paths.size()); }
+    qint64 byteCount() const { return m_data.size(); }
+    QString root() const { return m_root; }
+
+    /**
+     * @brief 已挂载路径对应的 qrc URL
+     */
+    QUrl localUrl(const QString &path) const;
+
+    QUrl intercept(const QUrl &url, DataType type) override;
+
+    /**
+     * @brief 从路径列表中挑出引擎直接加载的条目(.qml/.js/.mjs/qmldir)
+     */
+    static QStringList codePaths(const QStringList &paths);
+
+    /**
+     * @brief 按 rcc 二进制格式(版本 2)生成资源树,可直接交给 QResource::registerResource
+     * @param files 相对路径 -> 内容
+     */
+    static QByteArray buildResourceData(const QList<QPair<QString, QByteArray>> &files);
+
+private:
+    EncryptedResourceSelector *m_selector;
+    QString m_root;
+    QSet<QString> m_paths;
+    QByteArray m_data;
+    bool m_registered = false;
+};
+
+#endif // ENCRYPTEDRESOURCEMOUNT_H
@@ -1,46 +1,674 @@
 #include "EncryptedResourceSelector.h"
+#include "CipherBackend.h"
+#include "EncryptedArchive.h"
+#include "EncryptedResourceDirectory.h"
+#include "PlaintextArena.h"
 #include "ResourceEncryption.h"
+#include "ResourceMetrics.h"
+#include "ResourcePath.h"
+#include <QDateTime>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
 #include <QIODevice>
+#include <QMutexLocker>
+#include <QPromise>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// 可取消的解密每处理这么多字节检查一次取消请求
+constexpr qsizetype CancelCheckInterval = 1024 * 1024;
+
+/**
+ * @brief 把密文解密到内存池的块中，期间定期检查是否已被取消
+ * 密文与注册表共享或直接引用归档映射，不复制；明文只写入一次
+ * @param requireTags 拒绝没有认证标签的密文
+ * @param canceled 输出是否被取消
+ * @return 明文，失败或被取消时为空
+ */
+PlaintextBuffer decryptToBuffer(const QByteArray &ciphertext,
+                                const DerivedKey &key, bool requireTags,
+                                const std::function<bool()> &isCanceled,
+                                bool *canceled) {
+  *canceled = false;
+  qsizetype offset = 0;
+  const auto cipher =
+      ResourceEncryption::openCipher(ciphertext, key, &offset, requireTags);
+  if (!cipher)
+    return PlaintextBuffer();
+  PlaintextArena &arena = PlaintextArena::instance();
+  const qsizetype size = ciphertext.size() - offset;
+  PlaintextBuffer plaintext = arena.allocate(size);
+  if (plaintext.isNull())
+    return PlaintextBuffer();
+  const char *src = ciphertext.constData() + offset;
+  char *dst = plaintext.data();
+  for (qsizetype pos = 0; pos < size; pos += CancelCheckInterval) {
+    if (isCanceled && isCanceled()) {
+      *canceled = true;
+      return PlaintextBuffer();
+    }
+    const qsizetype n = qMin(CancelCheckInterval, size - pos);
+    // 标签按密文计算，解密前先校验这一段；间隔是标签块大小的整数倍
+    if (!ResourceEncryption::verifyChunks(ciphertext, key, pos, n)) {
+      qWarning() << "完整性校验失败: 密文已被修改";
+      return PlaintextBuffer();
+    }
+    cipher->process(src + pos, dst + pos, n, pos);
+  }
+
+  const CompressionMethod compression =
+      ResourceEncryption::compressionOf(ciphertext);
+  if (compression == CompressionMethod::None)
+    return plaintext;
+  // 解压只能输出到堆上的 QByteArray：复制进内存池后立即清零
+  QByteArray inflated = plaintext.bytes();
+  if (!ResourceEncryption::decompress(inflated, compression))
+    return PlaintextBuffer();
+  PlaintextBuffer result = arena.copy(inflated.constData(), inflated.size());
+  std::fill(inflated.begin(), inflated.end(), '\0');
+  return result;
+}
+
+} // namespace
 
 EncryptedResourceSelector::EncryptedResourceSelector(
     QQmlEngine *engine, const QString &decryptionKey, QObject *parent)
-    : QObject(parent), m_engine(engine), m_decryptionKey(decryptionKey) {}
+    : QObject(parent), m_engine(engine),
+      m_decryptionKey(ResourceEncryption::deriveKey(decryptionKey)),
+      m_cache(0) {
+  // 留一个核心给 GUI 线程和引擎
+  m_warmPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+  m_warmClock.start();
+  m_warmExpiryTimer.setSingleShot(true);
+  connect(&m_warmExpiryTimer, &QTimer::timeout, this,
+          &EncryptedResourceSelector::expireWarmEntries);
+}
+
+EncryptedResourceSelector::~EncryptedResourceSelector() {
+  // 工作线程引用了选择器的成员，必须在析构前全部结束；
+  // 异步解密任务不从队列中移除(移除后 future 永远不会结束)，
+  // 回复销毁时已取消的任务开始后立即返回
+  m_warmPool.clear();
+  {
+    // clear() 只移除尚未开始的任务；清空预热队列后，正在运行的工作线程
+    // 解密完手头的条目就退出，不会把剩余的访问记录全部解密完
+    QMutexLocker locker(&m_warmMutex);
+    m_warmQueue.clear();
+  }
+  m_requestPool.waitForDone();
+  m_warmPool.waitForDone();
+}
 
 void EncryptedResourceSelector::setRawMode(bool isRawMode,
                                            const QString &basePath) {
+  {
+    QMutexLocker locker(&m_rawMutex);
+    // 只规范化一次，请求时直接拼接相对路径
+    m_basePath = QDir::cleanPath(basePath);
+    m_rawFiles.clear();
+  }
   m_isRawMode = isRawMode;
-  m_basePath = basePath;
+  delete m_rawWatcher;
+  m_rawWatcher = nullptr;
+  if (!isRawMode)
+    return;
+  m_rawWatcher = new QFileSystemWatcher(this);
+  connect(m_rawWatcher, &QFileSystemWatcher::fileChanged, this,
+          &EncryptedResourceSelector::onRawFileChanged);
 }
 
 void EncryptedResourceSelector::registerEncryptedResource(
     const QString &virtualPath, const QByteArray &encryptedData) {
-  m_encryptedResources.insert(virtualPath, encryptedData);
+  m_registry.insert(virtualPath, encryptedData);
+  {
+    // 重新注册后旧的明文已失效；递增代数使仍在解密旧密文的请求不再写入缓存
+    QMutexLocker locker(&m_mutex);
+    m_cacheGeneration.fetch_add(1, std::memory_order_release);
+    m_cache.remove(virtualPath);
+  }
+  QMutexLocker locker(&m_warmMutex);
+  m_warmEntries.remove(virtualPath);
+  updateWarmEntryCount();
+}
+
+void EncryptedResourceSelector::registerEncryptedResources(
+    const QHash<QString, QByteArray> &resources) {
+  m_registry.insert(resources);
+  {
+    QMutexLocker locker(&m_mutex);
+    m_cacheGeneration.fetch_add(1, std::memory_order_release);
+    for (auto it = resources.constBegin(); it != resources.constEnd(); ++it)
+      m_cache.remove(it.key());
+  }
+  QMutexLocker locker(&m_warmMutex);
+  for (auto it = resources.constBegin(); it != resources.constEnd(); ++it)
+    m_warmEntries.remove(it.key());
+  updateWarmEntryCount();
 }
 
-QByteArray
-EncryptedResourceSelector::getDecryptedResource(const QString &path) {
+QByteArray EncryptedResourceSelector::getDecryptedResource(
+    QStringView path, const std::function<bool()> &isCanceled) {
+  return decryptedBuffer(path, isCanceled).toByteArray();
+}
+
+QFuture<PlaintextBuffer>
+EncryptedResourceSelector::decryptedBufferAsync(const QString &path) {
+  return QtConcurrent::run(
+      &m_requestPool, [this, path](QPromise<PlaintextBuffer> &promise) {
+        // 排队期间已被取消的任务直接放弃
+        if (promise.isCanceled())
+          return;
+        PlaintextBuffer data = decryptedBuffer(
+            path, [&promise] { return promise.isCanceled(); });
+        if (!promise.isCanceled())
+          promise.addResult(std::move(data));
+      });
+}
+
+PlaintextBuffer EncryptedResourceSelector::decryptedBuffer(
+    QStringView requestPath, const std::function<bool()> &isCanceled) {
+  // 路径只转换一次 UTF-8 和哈希；QString 只在缓存、预热或访问记录用到时才构造
+  const ResourcePath resourcePath(requestPath);
+  const QStringView path = resourcePath.view();
+  // 未开启计量时 metrics 为空，下面的计时全部跳过
+  ResourceMetrics &meter = ResourceMetrics::instance();
+  ResourceMetrics::Record *metrics = meter.record(resourcePath);
+  const qint64 started = metrics ? meter.now() : 0;
+  if (metrics)
+    metrics->requests.fetch_add(1, std::memory_order_relaxed);
+  // 只有开启访问记录或缓存时才需要进入锁，否则整个查找过程不加锁
+  QMutexLocker locker(&m_mutex, QMutexLocker::Unlocked);
+  if (m_recordAccesses.load(std::memory_order_relaxed)) {
+    const QString key = path.toString();
+    locker.relock();
+    if (!m_accessSeen.contains(key)) {
+      m_accessSeen.insert(key);
+      m_accessLog.append(key);
+    }
+    locker.unlock();
+  }
+
   // 如果是原始模式，直接从本地文件系统加载
   if (m_isRawMode) {
-    QString fullPath = m_basePath + "/" + path;
-    QFile file(fullPath);
-    if (file.open(QIODevice::ReadOnly)) {
-      return file.readAll();
+    PlaintextBuffer data;
+    bool cached = false;
+    if (readRawResource(path, &data, &cached)) {
+      if (metrics) {
+        if (cached)
+          metrics->cacheHits.fetch_add(1, std::memory_order_relaxed);
+        else
+          metrics->addDecrypt(meter.now() - started, data.size());
+      }
+      return data;
+    }
+    if (metrics)
+      metrics->failures.fetch_add(1, std::memory_order_relaxed);
+    qWarning() << "[RawMode] 资源未找到:"
+               << rawBasePath() + u'/' + path.toString();
+    return PlaintextBuffer();
+  }
+
+  // 在查找密文之前读取代数：之后的重新注册一定会使本次插入失效
+  const quint64 generation =
+      m_cacheGeneration.load(std::memory_order_acquire);
+  if (m_cacheEnabled.load(std::memory_order_relaxed)) {
+    const QString key = path.toString();
+    locker.relock();
+    // 命中时直接返回与缓存共享的数据，不再解密
+    if (const PlaintextBuffer *cached = m_cache.object(key)) {
+      ++m_cacheStats.hits;
+      if (metrics)
+        metrics->cacheHits.fetch_add(1, std::memory_order_relaxed);
+      return *cached;
     }
-    qWarning() << "[RawMode] 资源未找到:" << fullPath;
-    return QByteArray();
+    ++m_cacheStats.misses;
+    if (metrics)
+      metrics->cacheMisses.fetch_add(1, std::memory_order_relaxed);
+    locker.unlock();
+  }
+
+  PlaintextBuffer decryptedData;
+  if (m_warmEntryCount.load(std::memory_order_relaxed) > 0 &&
+      takeWarmedResource(path.toString(), &decryptedData)) {
+    locker.relock();
+    ++m_cacheStats.warmHits;
+    if (metrics)
+      metrics->warmHits.fetch_add(1, std::memory_order_relaxed);
+    if (m_cache.maxCost() > 0)
+      insertIntoCache(path.toString(), decryptedData, generation);
+    return decryptedData;
   }
 
-  if (m_encryptedResources.contains(path)) {
-    QByteArray encryptedData = m_encryptedResources.value(path);
-    QByteArray decryptedData =
-        ResourceEncryption::decrypt(encryptedData, m_decryptionKey);
-    if (decryptedData.isEmpty())
+  quint32 flags = EncryptedArchive::Encrypted;
+  // 密文与注册表共享或直接引用归档映射，直接解密到内存池的块中，不再先复制密文；
+  // 解密在锁外进行，多个线程可以同时解密
+  QByteArray ciphertext;
+  const bool found = m_registry.find(resourcePath, &ciphertext, &flags);
+  const qint64 looked = metrics ? meter.now() : 0;
+  if (metrics)
+    metrics->addLookup(looked - started);
+  const bool requireTags = m_requireChunkTags.load(std::memory_order_relaxed);
+  if (found) {
+    if (flags & EncryptedArchive::Encrypted) {
+      bool canceled = false;
+      decryptedData = decryptToBuffer(ciphertext, m_decryptionKey, requireTags,
+                                      isCanceled, &canceled);
+      if (canceled)
+        return PlaintextBuffer();
+    } else if (requireTags) {
+      // 归档索引中的标志不受认证，未加密的条目同样可能是伪造的
+      qWarning() << "拒绝未加密的条目:" << path;
+    } else {
+      // 未加密的条目本来就是明文，不需要池的保护，复制一份脱离映射
+      decryptedData = PlaintextBuffer::fromByteArray(
+          QByteArray(ciphertext.constData(), ciphertext.size()));
+    }
+    if (metrics) {
+      const qint64 decrypted = meter.now();
+      metrics->addDecrypt(decrypted - looked, decryptedData.size());
+      meter.traceSpan("decrypt", metrics, looked, decrypted,
+                      decryptedData.size());
+    }
+    if (decryptedData.isEmpty()) {
+      if (metrics)
+        metrics->failures.fetch_add(1, std::memory_order_relaxed);
       qWarning() << "解密失败: 返回的数据为空" << path;
+    } else if (m_cacheEnabled.load(std::memory_order_relaxed)) {
+      locker.relock();
+      if (m_cache.maxCost() > 0)
+        insertIntoCache(path.toString(), decryptedData, generation);
+    }
     return decryptedData;
   } else {
+    if (metrics)
+      metrics->failures.fetch_add(1, std::memory_order_relaxed);
     qWarning() << "资源未找到:" << path;
   }
-  return QByteArray();
+  return PlaintextBuffer();
+}
+
+bool EncryptedResourceSelector::hasResource(QStringView path) const {
+  if (m_isRawMode) {
+    QMutexLocker locker(&m_rawMutex);
+    if (m_rawFiles.contains(path.toString()))
+      return true;
+    locker.unlock();
+    return QFile::exists(rawBasePath() + u'/' + path.toString());
+  }
+  return m_registry.contains(ResourcePath(path));
+}
+
+QStringList EncryptedResourceSelector::resourcePaths() const {
+  if (m_isRawMode)
+    return {};
+  return m_registry.paths();
+}
+
+bool EncryptedResourceSelector::readRawResource(QStringView path,
+                                                PlaintextBuffer *data,
+                                                bool *cached) {
+  const QString key = path.toString();
+  {
+    QMutexLocker locker(&m_rawMutex);
+    const auto it = m_rawFiles.constFind(key);
+    if (it != m_rawFiles.constEnd()) {
+      *data = it->data;
+      *cached = true;
+      return true;
+    }
+  }
+
+  QFile file(rawBasePath() + u'/' + key);
+  if (!file.open(QIODevice::ReadOnly))
+    return false;
+  RawFile entry;
+  // 先取修改时间再读内容：读取期间被修改时时间对不上，开始监视时会失效重读
+  entry.modified = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+  // 本地文件本来就是明文，包装后与缓存共享，不占用内存池
+  entry.data = PlaintextBuffer::fromByteArray(file.readAll());
+  {
+    QMutexLocker locker(&m_rawMutex);
+    m_rawFiles.insert(key, entry);
+  }
+  // 请求可能来自加载线程，监视器只能在选择器所在线程上操作
+  QMetaObject::invokeMethod(
+      this, [this, key] { watchRawFile(key); }, Qt::QueuedConnection);
+  *data = entry.data;
+  *cached = false;
+  return true;
+}
+
+void EncryptedResourceSelector::watchRawFile(const QString &path) {
+  if (!m_rawWatcher)
+    return;
+  const QString fullPath = rawBasePath() + u'/' + path;
+  if (!m_rawWatcher->files().contains(fullPath))
+    m_rawWatcher->addPath(fullPath);
+  // 读取之后、开始监视之前的修改不会产生通知，在这里补查一次
+  const qint64 modified =
+      QFileInfo(fullPath).lastModified().toMSecsSinceEpoch();
+  QMutexLocker locker(&m_rawMutex);
+  const auto it = m_rawFiles.constFind(path);
+  if (it == m_rawFiles.constEnd() || it->modified == modified)
+    return;
+  m_rawFiles.erase(it);
+  locker.unlock();
+  emit rawResourceChanged(path);
+}
+
+void EncryptedResourceSelector::onRawFileChanged(const QString &fullPath) {
+  const QString basePath = rawBasePath();
+  if (!fullPath.startsWith(basePath + u'/'))
+    return;
+  const QString path = fullPath.mid(basePath.size() + 1);
+  {
+    QMutexLocker locker(&m_rawMutex);
+    m_rawFiles.remove(path);
+  }
+  // 编辑器以“写临时文件再改名”的方式保存时，原路径会被移出监视列表
+  if (QFile::exists(fullPath) && !m_rawWatcher->files().contains(fullPath))
+    m_rawWatcher->addPath(fullPath);
+  qDebug() << "[RawMode] 文件已修改:" << path;
+  emit rawResourceChanged(path);
+}
+
+void EncryptedResourceSelector::setRequireChunkTags(bool require) {
+  m_requireChunkTags = require;
+}
+
+void EncryptedResourceSelector::setStreamingThreshold(qint64 bytes) {
+  m_streamingThreshold = qMax<qint64>(0, bytes);
+}
+
+bool EncryptedResourceSelector::findStreamableResource(
+    QStringView path, QByteArray *ciphertext, bool *exists) const {
+  const qint64 threshold = streamingThreshold();
+  if (m_isRawMode || threshold <= 0) {
+    if (exists)
+      *exists = hasResource(path);
+    return false;
+  }
+  quint32 flags = 0;
+  const bool found = m_registry.find(ResourcePath(path), ciphertext, &flags);
+  if (exists)
+    *exists = found;
+  if (!found)
+    return false;
+  // 压缩过的资源无法从任意偏移解密，只能整体解密后解压；
+  // 要求标签时不带标签的资源留给整体解密路径拒绝并报告
+  if (m_requireChunkTags.load(std::memory_order_relaxed) &&
+      !ResourceEncryption::hasChunkTags(*ciphertext))
+    return false;
+  return (flags & EncryptedArchive::Encrypted) &&
+         ciphertext->size() >= threshold &&
+         ResourceEncryption::compressionOf(*ciphertext) ==
+             CompressionMethod::None;
+}
+
+bool EncryptedResourceSelector::addArchive(const QString &fileName) {
+  auto archive = QSharedPointer<EncryptedArchive>::create();
+  if (!archive->open(fileName))
+    return false;
+  m_registry.addArchive(archive);
+  return true;
+}
+
+bool EncryptedResourceSelector::addResourceDirectory(const QString &directory,
+                                                     const QString &suffix) {
+  auto resources = QSharedPointer<EncryptedResourceDirectory>::create();
+  if (!resources->open(directory, suffix))
+    return false;
+  m_registry.addDirectory(resources);
+  return true;
+}
+
+void EncryptedResourceSelector::setCacheBudget(qint64 bytes) {
+  QMutexLocker locker(&m_mutex);
+  const qsizetype before = m_cache.size();
+  m_cache.setMaxCost(qMax<qint64>(0, bytes));
+  m_cacheStats.evictions += before - m_cache.size();
+  m_cacheEnabled.store(m_cache.maxCost() > 0, std::memory_order_relaxed);
+}
+
+qint64 EncryptedResourceSelector::cacheBudget() const {
+  QMutexLocker locker(&m_mutex);
+  return m_cache.maxCost();
+}
+
+EncryptedResourceSelector::CacheStats
+EncryptedResourceSelector::cacheStats() const {
+  QMutexLocker locker(&m_mutex);
+  CacheStats stats = m_cacheStats;
+  stats.bytes = m_cache.totalCost();
+  stats.budget = m_cache.maxCost();
+  stats.entries = int(m_cache.size());
+  return stats;
+}
+
+void EncryptedResourceSelector::purge() {
+  {
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+  }
+  {
+    // 正在解密的条目标记为丢弃，由工作线程完成后连同结果一起移除
+    QMutexLocker locker(&m_warmMutex);
+    m_warmQueue.clear();
+    for (auto it = m_warmEntries.begin(); it != m_warmEntries.end();) {
+      if (it->state == WarmState::Decrypting ||
+          it->state == WarmState::Discarded) {
+        it->state = WarmState::Discarded;
+        ++it;
+      } else {
+        it = m_warmEntries.erase(it);
+      }
+    }
+    updateWarmEntryCount();
+  }
+  qDebug() << "[Cache] 已清空明文缓存";
+}
+
+void EncryptedResourceSelector::insertIntoCache(const QString &path,
+                                                const PlaintextBuffer &data,
+                                                quint64 generation) {
+  if (generation != m_cacheGeneration.load(std::memory_order_relaxed))
+    return;
+  // QCache 不报告淘汰数量，通过插入前后的条目数推算；
+  // 被淘汰的明文在最后一个持有者释放时清零并归还内存池
+  const qsizetype before = m_cache.size();
+  const bool inserted =
+      m_cache.insert(path, new PlaintextBuffer(data), data.size());
+  m_cacheStats.evictions += before + (inserted ? 1 : 0) - m_cache.size();
+}
+
+void EncryptedResourceSelector::warmUp(const QStringList &paths) {
+  if (m_isRawMode)
+    return;
+
+  QList<QPair<QString, QByteArray>> candidates;
+  {
+    QMutexLocker locker(&m_mutex);
+    for (const QString &path : paths) {
+      QByteArray ciphertext;
+      quint32 flags = 0;
+      if (m_cache.contains(path) ||
+          !m_registry.find(ResourcePath(path), &ciphertext, &flags) ||
+          !(flags & EncryptedArchive::Encrypted))
+        continue;
+      // 大资源走流式解密，不需要也不应该整体预热
+      const qint64 threshold = streamingThreshold();
+      if (threshold > 0 && ciphertext.size() >= threshold &&
+          ResourceEncryption::compressionOf(ciphertext) ==
+              CompressionMethod::None)
+        continue;
+      candidates.append({path, ciphertext});
+    }
+  }
+
+  int queued = 0;
+  {
+    QMutexLocker locker(&m_warmMutex);
+    for (const auto &candidate : std::as_const(candidates)) {
+      if (m_warmEntries.contains(candidate.first))
+        continue;
+      WarmEntry entry;
+      entry.ciphertext = candidate.second;
+      m_warmEntries.insert(candidate.first, entry);
+      m_warmQueue.append(candidate.first);
+      ++queued;
+    }
+    updateWarmEntryCount();
+  }
+  if (queued == 0)
+    return;
+
+  const int workers = qMin(queued, m_warmPool.maxThreadCount());
+  for (int i = 0; i < workers; ++i)
+    m_warmPool.start([this] { runWarmUpWorker(); });
+  // 计时器属于选择器所在线程，warmUp 可能在其他线程上调用
+  if (m_warmExpiryMs.load(std::memory_order_relaxed) > 0)
+    QMetaObject::invokeMethod(&m_warmExpiryTimer, [this] {
+      m_warmExpiryTimer.start(m_warmExpiryMs.load(std::memory_order_relaxed));
+    });
+  qDebug() << "[WarmUp] 后台预解密资源数:" << queued << "工作线程:" << workers;
+}
+
+bool EncryptedResourceSelector::warmUpFromProfile(const QString &fileName) {
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    return false;
+  QStringList paths;
+  while (!file.atEnd()) {
+    const QString line = QString::fromUtf8(file.readLine()).trimmed();
+    if (!line.isEmpty())
+      paths.append(line);
+  }
+  warmUp(paths);
+  return true;
+}
+
+void EncryptedResourceSelector::setWarmUpExpiry(int msecs) {
+  m_warmExpiryMs.store(qMax(0, msecs), std::memory_order_relaxed);
+}
+
+void EncryptedResourceSelector::expireWarmEntries() {
+  const qint64 expiry = m_warmExpiryMs.load(std::memory_order_relaxed);
+  if (expiry <= 0)
+    return;
+  const qint64 now = m_warmClock.elapsed();
+  qint64 next = -1;
+  int expired = 0;
+  {
+    QMutexLocker locker(&m_warmMutex);
+    for (auto it = m_warmEntries.begin(); it != m_warmEntries.end();) {
+      if (it->state == WarmState::Ready && now - it->readyAt >= expiry) {
+        it = m_warmEntries.erase(it);
+        ++expired;
+        continue;
+      }
+      // 尚未完成的条目完成后至少再保留一个完整的过期时间
+      const qint64 remaining = it->state == WarmState::Ready
+                                   ? expiry - (now - it->readyAt)
+                                   : expiry;
+      next = next < 0 ? remaining : qMin(next, remaining);
+      ++it;
+    }
+    updateWarmEntryCount();
+  }
+  if (expired > 0)
+    qDebug() << "[WarmUp] 丢弃无人认领的预热明文:" << expired;
+  if (next >= 0)
+    m_warmExpiryTimer.start(int(next));
+}
+
+void EncryptedResourceSelector::setAccessRecording(bool enabled) {
+  QMutexLocker locker(&m_mutex);
+  m_recordAccesses = enabled;
+}
+
+bool EncryptedResourceSelector::saveAccessProfile(
+    const QString &fileName) const {
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                 QIODevice::Text)) {
+    qWarning() << "[WarmUp] 无法写入访问记录:" << fileName;
+    return false;
+  }
+  QMutexLocker locker(&m_mutex);
+  for (const QString &path : std::as_const(m_accessLog))
+    file.write(path.toUtf8() + '\n');
+  return true;
+}
+
+void EncryptedResourceSelector::runWarmUpWorker() {
+  QMutexLocker locker(&m_warmMutex);
+  while (!m_warmQueue.isEmpty()) {
+    const QString path = m_warmQueue.takeFirst();
+    auto it = m_warmEntries.find(path);
+    // 请求线程已经认领(或资源被重新注册)的条目直接跳过
+    if (it == m_warmEntries.end() || it->state != WarmState::Queued)
+      continue;
+    it->state = WarmState::Decrypting;
+    const QByteArray ciphertext = std::exchange(it->ciphertext, QByteArray());
+
+    locker.unlock();
+    bool canceled = false;
+    const PlaintextBuffer plaintext =
+        decryptToBuffer(ciphertext, m_decryptionKey,
+                        m_requireChunkTags.load(std::memory_order_relaxed),
+                        {}, &canceled);
+    locker.relock();
+
+    it = m_warmEntries.find(path);
+    if (it != m_warmEntries.end() && it->state == WarmState::Discarded) {
+      // 解密期间被 purge()，结果随句柄释放清零
+      m_warmEntries.erase(it);
+      updateWarmEntryCount();
+    } else if (it != m_warmEntries.end() &&
+               it->state == WarmState::Decrypting) {
+      if (plaintext.isEmpty()) {
+        // 解密失败时交给请求线程重新解密并报告
+        m_warmEntries.erase(it);
+        updateWarmEntryCount();
+      } else {
+        it->plaintext = plaintext;
+        it->state = WarmState::Ready;
+        it->readyAt = m_warmClock.elapsed();
+      }
+    }
+    m_warmReady.wakeAll();
+  }
+}
+
+bool EncryptedResourceSelector::takeWarmedResource(const QString &path,
+                                                   PlaintextBuffer *plaintext) {
+  QMutexLocker locker(&m_warmMutex);
+  auto it = m_warmEntries.find(path);
+  if (it == m_warmEntries.end())
+    return false;
+  if (it->state == WarmState::Queued) {
+    // 还没轮到的条目由请求线程自己解密，比排队等待更快
+    m_warmEntries.erase(it);
+    updateWarmEntryCount();
+    return false;
+  }
+  while (it != m_warmEntries.end() &&
+         (it->state == WarmState::Decrypting ||
+          it->state == WarmState::Discarded)) {
+    m_warmReady.wait(&m_warmMutex);
+    it = m_warmEntries.find(path);
+  }
+  if (it == m_warmEntries.end())
+    return false;
+  *plaintext = std::move(it->plaintext);
+  m_warmEntries.erase(it);
+  updateWarmEntryCount();
+  return true;
 }
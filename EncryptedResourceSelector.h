@@ -1,25 +1,64 @@
 #ifndef ENCRYPTEDRESOURCESELECTOR_H
 #define ENCRYPTEDRESOURCESELECTOR_H
 
+#include <QCache>
+#include <QElapsedTimer>
+#include <QFuture>
 #include <QHash>
+#include <QList>
+#include <QMutex>
 #include <QQmlEngine>
+#include <QSet>
+#include <QSharedPointer>
 #include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QWaitCondition>
+#include <atomic>
+#include <functional>
 
+#include "PlaintextArena.h"
+#include "ResourceEncryption.h"
+#include "ResourceRegistry.h"
+
+class QFileSystemWatcher;
 
 /**
  * @brief 加密资源选择器
  * 在加载加密资源（QML、JS、图片等）时，从内存中提供解密后的数据
+ * 所有接口都是线程安全的，可以被多个加载线程和多个引擎共享：
+ * 注册表查找不加锁(见 ResourceRegistry)，解密在锁外进行；
+ * 只有开启明文缓存或访问记录时才会进入互斥锁。
+ * 明文直接解密到 PlaintextArena 的块中，缓存、预热和回复都持有同一块的句柄，
+ * 最后一个持有者释放时清零并归还内存池
  */
 class EncryptedResourceSelector : public QObject {
   Q_OBJECT
 
 public:
+  /**
+   * @brief 明文缓存的统计信息
+   */
+  struct CacheStats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    qint64 bytes = 0;  // 当前缓存占用的字节数
+    qint64 budget = 0; // 字节预算，0 表示未开启缓存
+    int entries = 0;
+    quint64 warmHits = 0; // 由预热直接提供明文的请求数
+  };
+
   explicit EncryptedResourceSelector(QQmlEngine *engine,
                                      const QString &decryptionKey,
                                      QObject *parent = nullptr);
+  ~EncryptedResourceSelector() override;
 
   /**
    * @brief 设置是否为原始模式及基础路径
+   * 原始模式下读过的文件内容按路径缓存并加入文件监视，未修改的文件不再重复读盘；
+   * 文件被修改时缓存失效并发出 rawResourceChanged。需在选择器所在线程调用
    * @param isRawMode 是否开启原始模式
    * @param basePath 原始文件的存放路径
    */
@@ -33,19 +72,249 @@ public:
   void registerEncryptedResource(const QString &virtualPath,
                                  const QByteArray &encryptedData);
 
+  /**
+   * @brief 批量注册加密资源
+   * 注册表每次写入都要复制一份快照，启动时一次注册大量资源应使用本接口
+   * @param resources 虚拟路径 -> 加密数据
+   */
+  void registerEncryptedResources(const QHash<QString, QByteArray> &resources);
+
+  /**
+   * @brief 挂载加密资源归档
+   * 归档被映射到内存，只读取索引；条目在首次请求时才解密
+   * @param fileName 归档路径(本地文件或 ":/" 资源路径)
+   * @return 是否成功
+   */
+  bool addArchive(const QString &fileName);
+
+  /**
+   * @brief 挂载加密资源目录(qrc 前缀或本地目录)，按需解析
+   * 只遍历文件名建立查找表，不读取内容；条目在首次请求时才取得密文，
+   * 未压缩的 qrc 资源直接引用 QResource 数据，本地文件映射到内存
+   * @param directory 目录，例如 ":/encrypted"
+   * @param suffix 只收录带此后缀的文件，虚拟路径中去掉该后缀
+   * @return 目录是否存在
+   */
+  bool addResourceDirectory(const QString &directory,
+                            const QString &suffix = QStringLiteral(".enc"));
+
   /**
    * @brief 获取解密后的资源
+   * 明文位于内存池中，与缓存共享，句柄全部释放后清零
+   * @param path 资源路径
+   * @param isCanceled 可选，解密过程中定期调用，返回 true 时放弃并返回空
+   * @return 解密后的数据，失败时为空
+   */
+  PlaintextBuffer
+  decryptedBuffer(QStringView path,
+                  const std::function<bool()> &isCanceled = {});
+
+  /**
+   * @brief 获取解密后的资源，复制到普通的 QByteArray
+   * 副本不受内存池保护，释放时不会清零；只用于必须持有 QByteArray 的调用方
+   */
+  QByteArray
+  getDecryptedResource(QStringView path,
+                       const std::function<bool()> &isCanceled = {});
+
+  /**
+   * @brief 在选择器自己的线程池上异步解密
+   * 取消返回的 future 时解密尽快放弃；选择器析构前等待全部任务结束，
+   * 任务不会在选择器销毁之后访问它
+   */
+  QFuture<PlaintextBuffer> decryptedBufferAsync(const QString &path);
+
+  /**
+   * @brief 资源是否存在(不解密)
+   */
+  bool hasResource(QStringView path) const;
+
+  /**
+   * @brief 全部已注册的资源路径(不解密)，原始模式下为空
+   */
+  QStringList resourcePaths() const;
+
+  /**
+   * @brief 设置流式解密阈值
+   * 密文不小于该大小的资源不再整体解密，而是交给 EncryptedStreamReply
+   * 按块解密，峰值内存与资源大小无关；0 表示关闭流式解密
+   * @param bytes 阈值(字节)
+   */
+  void setStreamingThreshold(qint64 bytes);
+  qint64 streamingThreshold() const {
+    return m_streamingThreshold.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief 查找应当流式解密的大资源
    * @param path 资源路径
-   * @return 解密后的数据
+   * @param ciphertext 输出密文，与注册表共享或直接引用归档映射
+   * @param exists 可选，输出资源是否存在；请求入口用它代替再调用一次
+   *               hasResource()，每个请求只查找一次注册表
+   * @return 资源存在、已加密且达到流式阈值时返回 true
    */
-  QByteArray getDecryptedResource(const QString &path);
+  bool findStreamableResource(QStringView path, QByteArray *ciphertext,
+                              bool *exists = nullptr) const;
+
+  /**
+   * @brief 只接受带按块认证标签的密文(格式版本 2)
+   * 开启后旧版 XOR 数据、版本 1 的密文和未加密的归档条目一律拒绝，
+   * 否则把头部改写为版本 1 即可绕过校验。发布版本应当开启，默认关闭以兼容旧资源
+   */
+  void setRequireChunkTags(bool require);
+  bool requireChunkTags() const {
+    return m_requireChunkTags.load(std::memory_order_relaxed);
+  }
+
+  const DerivedKey &decryptionKey() const { return m_decryptionKey; }
+
+  /**
+   * @brief 设置解密明文缓存的字节预算
+   * 超出预算时按最近最少使用(LRU)顺序淘汰，默认 0 表示不缓存
+   * @param bytes 字节预算
+   */
+  void setCacheBudget(qint64 bytes);
+  qint64 cacheBudget() const;
+
+  /**
+   * @brief 获取缓存命中/未命中/淘汰计数
+   */
+  CacheStats cacheStats() const;
+
+  /**
+   * @brief 立即丢弃所有缓存的明文
+   * 适用于启动完成后不希望明文继续驻留内存的场景；
+   * 正在解密的预热条目在完成时丢弃结果
+   */
+  void purge();
+
+  /**
+   * @brief 在工作线程上预先解密启动关键资源
+   * 引擎仍在构建时后台解密列表中的条目，之后的请求直接取走现成的明文；
+   * 请求到达时尚未开始解密的条目由请求线程自行解密，不会排队等待。
+   * 密文在调用线程上查找，预热期间可以照常注册资源。
+   * @param paths 按优先级排序的资源路径
+   */
+  void warmUp(const QStringList &paths);
+
+  /**
+   * @brief 按上次运行记录的访问顺序预热
+   * @param fileName 由 saveAccessProfile 写出的文件
+   * @return 文件是否存在且可读
+   */
+  bool warmUpFromProfile(const QString &fileName);
+
+  /**
+   * @brief 预热完成后无人认领的明文保留多久(毫秒)，默认 10 秒
+   * 过期后丢弃，之后的请求照常解密；0 表示一直保留到被认领或 purge()
+   */
+  void setWarmUpExpiry(int msecs);
+
+  /**
+   * @brief 记录资源的首次访问顺序，用于生成下次启动的预热列表
+   */
+  void setAccessRecording(bool enabled);
+  QStringList recordedAccesses() const {
+    QMutexLocker locker(&m_mutex);
+    return m_accessLog;
+  }
+
+  /**
+   * @brief 把记录的访问顺序写入文件(每行一个路径)
+   */
+  bool saveAccessProfile(const QString &fileName) const;
+
+signals:
+  /**
+   * @brief 原始模式下读过的文件被修改或删除，缓存的内容已失效
+   * 编辑器的一次保存可能触发多次，接收方应自行合并
+   * @param path 资源路径(相对于基础路径)
+   */
+  void rawResourceChanged(const QString &path);
 
 private:
+  struct RawFile {
+    PlaintextBuffer data;
+    qint64 modified = 0; // 读取时的修改时间(毫秒)
+  };
+
+  // Discarded: 解密期间被 purge()，工作线程完成后直接丢弃结果
+  enum class WarmState { Queued, Decrypting, Ready, Discarded };
+  struct WarmEntry {
+    WarmState state = WarmState::Queued;
+    QByteArray ciphertext;
+    PlaintextBuffer plaintext;
+    qint64 readyAt = 0; // 进入 Ready 的时间(m_warmClock，毫秒)
+  };
+
+  /**
+   * @brief 读取原始模式的本地文件，优先使用缓存
+   * @param cached 输出是否命中缓存
+   * @return 文件是否存在且可读
+   */
+  bool readRawResource(QStringView path, PlaintextBuffer *data, bool *cached);
+  // 以下两个在选择器所在线程上执行，文件监视器不是线程安全的
+  void watchRawFile(const QString &path);
+  void onRawFileChanged(const QString &fullPath);
+
+  // 基础路径的快照，可在任意线程上调用
+  QString rawBasePath() const {
+    QMutexLocker locker(&m_rawMutex);
+    return m_basePath;
+  }
+  void runWarmUpWorker();
+  // 在选择器所在线程上由 m_warmExpiryTimer 触发
+  void expireWarmEntries();
+  bool takeWarmedResource(const QString &path, PlaintextBuffer *plaintext);
+  // 要求调用方持有 m_mutex；generation 为解密开始前读取的缓存代数，
+  // 期间有资源重新注册时放弃插入，避免旧密文的明文回到缓存
+  void insertIntoCache(const QString &path, const PlaintextBuffer &data,
+                       quint64 generation);
+  void updateWarmEntryCount() {
+    m_warmEntryCount.store(int(m_warmEntries.size()),
+                           std::memory_order_relaxed);
+  }
+
   QQmlEngine *m_engine;
-  QString m_decryptionKey;
-  bool m_isRawMode = false;
+  // 保护明文缓存和访问记录；注册表有自己的同步
+  mutable QMutex m_mutex;
+  // 构造时派生一次，之后每次解密不再重复哈希密钥
+  DerivedKey m_decryptionKey;
+  // 设置方可能与加载线程并发，开关和阈值用原子变量，基础路径由 m_rawMutex 保护
+  std::atomic<bool> m_isRawMode{false};
+  std::atomic<qint64> m_streamingThreshold{8 * 1024 * 1024};
+  std::atomic<bool> m_requireChunkTags{false};
+  // 原始模式的文件内容缓存，由 m_rawMutex 保护；监视器只在选择器所在线程上访问
+  mutable QMutex m_rawMutex;
   QString m_basePath;
-  QHash<QString, QByteArray> m_encryptedResources;
+  QHash<QString, RawFile> m_rawFiles;
+  QFileSystemWatcher *m_rawWatcher = nullptr;
+  ResourceRegistry m_registry;
+  // 解密后的明文缓存，开销以字节计
+  QCache<QString, PlaintextBuffer> m_cache;
+  CacheStats m_cacheStats;
+  // 缓存预算的无锁副本，未开启缓存时查找路径不进入 m_mutex
+  std::atomic<bool> m_cacheEnabled{false};
+  // 每次重新注册资源时在 m_mutex 内递增
+  std::atomic<quint64> m_cacheGeneration{0};
+
+  // 预热状态，工作线程与请求线程共享，由 m_warmMutex 保护
+  QMutex m_warmMutex;
+  QWaitCondition m_warmReady;
+  QHash<QString, WarmEntry> m_warmEntries;
+  QStringList m_warmQueue;
+  QThreadPool m_warmPool;
+  // 异步回复的解密任务，析构时等待结束
+  QThreadPool m_requestPool;
+  QElapsedTimer m_warmClock;
+  QTimer m_warmExpiryTimer;
+  std::atomic<int> m_warmExpiryMs{10000};
+  // m_warmEntries 的条目数，为 0 时请求线程不必进入 m_warmMutex
+  std::atomic<int> m_warmEntryCount{0};
+
+  std::atomic<bool> m_recordAccesses{false};
+  QStringList m_accessLog;
+  QSet<QString> m_accessSeen;
 };
 
 #endif // ENCRYPTEDRESOURCESELECTOR_H
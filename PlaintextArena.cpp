@@ -0,0 +1,346 @@
+#include "PlaintextArena.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+struct PlaintextBuffer::Block {
+    std::atomic<int> ref{1};
+    char *data = nullptr;
+    qsizetype size = 0;     // 有效长度
+    qsizetype used = 0;     // 分配时请求的长度,即释放时需要清零的范围
+    qsizetype capacity = 0;
+    int sizeClass = -1;     // -1 表示超大块或包装的 QByteArray
+    bool locked = false;
+    PlaintextArena *arena = nullptr; // 为空表示包装的 QByteArray
+    QByteArray wrapped;
+    Block *next = nullptr;  // 空闲链表
+};
+
+namespace {
+
+// 块按页映射,超大块的容量按页向上取整
+constexpr qsizetype PageSize = 4096;
+
+/**
+ * @brief 清零,不会因为之后不再读取而被编译器省略
+ */
+void secureZero(void *p, size_t size)
+{
+#if defined(__GNUC__)
+    memset(p, 0, size);
+    __asm__ __volatile__("" : : "r"(p) : "memory");
+#else
+    volatile char *v = static_cast<volatile char *>(p);
+    while (size--) *v++ = 0;
+#endif
+}
+
+char *mapPages(qsizetype size)
+{
+#ifdef Q_OS_WIN
+    return static_cast<char *>(VirtualAlloc(nullptr, SIZE_T(size), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+    void *p = mmap(nullptr, size_t(size), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+#ifdef MADV_DONTDUMP
+    // 明文不进入核心转储
+    madvise(p, size_t(size), MADV_DONTDUMP);
+#endif
+    return static_cast<char *>(p);
+#endif
+}
+
+void unmapPages(char *p, qsizetype size)
+{
+#ifdef Q_OS_WIN
+    Q_UNUSED(size);
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, size_t(size));
+#endif
+}
+
+bool lockPages(char *p, qsizetype size)
+{
+#ifdef Q_OS_WIN
+    return VirtualLock(p, SIZE_T(size));
+#else
+    return mlock(p, size_t(size)) == 0;
+#endif
+}
+
+void unlockPages(char *p, qsizetype size)
+{
+#ifdef Q_OS_WIN
+    VirtualUnlock(p, SIZE_T(size));
+#else
+    munlock(p, size_t(size));
+#endif
+}
+
+} // namespace
+
+// PlaintextBuffer 实现
+PlaintextBuffer::PlaintextBuffer(const PlaintextBuffer &other)
+    : m_block(other.m_block)
+{
+    if (m_block) m_block->ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+PlaintextBuffer &PlaintextBuffer::operator=(const PlaintextBuffer &other)
+{
+    if (other.m_block) other.m_block->ref.fetch_add(1, std::memory_order_relaxed);
+    release();
+    m_block = other.m_block;
+    return *this;
+}
+
+PlaintextBuffer &PlaintextBuffer::operator=(PlaintextBuffer &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_block = other.m_block;
+        other.m_block = nullptr;
+    }
+    return *this;
+}
+
+PlaintextBuffer::~PlaintextBuffer()
+{
+    release();
+}
+
+void PlaintextBuffer::release()
+{
+    if (!m_block) return;
+    Block *block = m_block;
+    m_block = nullptr;
+    if (block->ref.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    if (block->arena) {
+        block->arena->release(block);
+    } else {
+        delete block;
+    }
+}
+
+PlaintextBuffer PlaintextBuffer::fromByteArray(const QByteArray &data)
+{
+    if (data.isEmpty()) return PlaintextBuffer();
+    auto block = new Block;
+    block->wrapped = data;
+    block->data = const_cast<char *>(block->wrapped.constData());
+    block->size = block->used = block->capacity = data.size();
+    return PlaintextBuffer(block);
+}
+
+qsizetype PlaintextBuffer::size() const
+{
+    return m_block ? m_block->size : 0;
+}
+
+const char *PlaintextBuffer::constData() const
+{
+    return m_block ? m_block->data : nullptr;
+}
+
+char *PlaintextBuffer::data()
+{
+    Q_ASSERT(!m_block || (m_block->arena && m_block->ref.load(std::memory_order_relaxed) == 1));
+    return m_block ? m_block->data : nullptr;
+}
+
+void PlaintextBuffer::truncate(qsizetype size)
+{
+    if (m_block && size < m_block->size) m_block->size = qMax<qsizetype>(0, size);
+}
+
+QByteArray PlaintextBuffer::bytes() const
+{
+    if (!m_block) return QByteArray();
+    if (!m_block->arena) return m_block->wrapped.left(m_block->size);
+    return QByteArray::fromRawData(m_block->data, m_block->size);
+}
+
+QByteArray PlaintextBuffer::toByteArray() const
+{
+    if (!m_block) return QByteArray();
+    if (!m_block->arena) return m_block->wrapped.left(m_block->size);
+    return QByteArray(m_block->data, m_block->size);
+}
+
+bool PlaintextBuffer::isPooled() const
+{
+    return m_block && m_block->arena;
+}
+
+// PlaintextArena 实现
+PlaintextArena &PlaintextArena::instance()
+{
+    static PlaintextArena arena;
+    return arena;
+}
+
+PlaintextArena::PlaintextArena() = default;
+
+PlaintextArena::~PlaintextArena()
+{
+    // 仍在使用的块由句柄持有,进程退出前不再归还
+    QMutexLocker locker(&m_mutex);
+    trimTo(0);
+}
+
+int PlaintextArena::sizeClass(qsizetype size)
+{
+    if (size > MaxClassSize) return -1;
+    int index = 0;
+    for (qsizetype capacity = MinClassSize; capacity < size; capacity <<= 1) ++index;
+    return index;
+}
+
+PlaintextBuffer PlaintextArena::allocate(qsizetype size)
+{
+    if (size <= 0) return PlaintextBuffer();
+    const int index = sizeClass(size);
+    Block *block = nullptr;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (index >= 0 && m_free[index]) {
+            block = m_free[index];
+            m_free[index] = block->next;
+            block->next = nullptr;
+            m_stats.pooledBytes -= block->capacity;
+            ++m_stats.reuses;
+        }
+        if (block) {
+            m_stats.inUseBytes += block->capacity;
+            m_stats.peakInUseBytes = qMax(m_stats.peakInUseBytes, m_stats.inUseBytes);
+        }
+    }
+    if (!block) {
+        // 映射和锁定是系统调用,在锁外进行
+        const qsizetype capacity =
+            index >= 0 ? MinClassSize << index : (size + PageSize - 1) / PageSize * PageSize;
+        block = mapBlock(capacity, index);
+        if (!block) {
+            qWarning() << "[Arena] 分配明文缓冲区失败:" << size << "字节";
+            return PlaintextBuffer();
+        }
+    }
+    block->ref.store(1, std::memory_order_relaxed);
+    block->size = block->used = size;
+    return PlaintextBuffer(block);
+}
+
+PlaintextBuffer PlaintextArena::copy(const char *data, qsizetype size)
+{
+    PlaintextBuffer buffer = allocate(size);
+    if (!buffer.isNull()) memcpy(buffer.data(), data, size_t(size));
+    return buffer;
+}
+
+PlaintextArena::Block *PlaintextArena::mapBlock(qsizetype capacity, int sizeClass)
+{
+    char *data = mapPages(capacity);
+    if (!data) return nullptr;
+    auto block = new Block;
+    block->data = data;
+    block->capacity = capacity;
+    block->sizeClass = sizeClass;
+    block->arena = this;
+    bool lockFailed = false;
+    if (m_locking.load(std::memory_order_relaxed)) {
+        block->locked = lockPages(data, capacity);
+        lockFailed = !block->locked;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.allocations;
+    m_stats.inUseBytes += capacity;
+    m_stats.peakInUseBytes = qMax(m_stats.peakInUseBytes, m_stats.inUseBytes);
+    if (block->locked) m_stats.lockedBytes += capacity;
+    if (lockFailed) {
+        ++m_stats.lockFailures;
+        if (!m_lockWarned) {
+            m_lockWarned = true;
+            qWarning() << "[Arena] 锁定内存失败(超出系统限额),明文可能被换出:" << capacity << "字节";
+        }
+    }
+    return block;
+}
+
+void PlaintextArena::unmapBlock(Block *block)
+{
+    if (block->locked) unlockPages(block->data, block->capacity);
+    unmapPages(block->data, block->capacity);
+    delete block;
+}
+
+void PlaintextArena::release(Block *block)
+{
+    // 清零在锁外进行,大块不阻塞其他线程的分配
+    secureZero(block->data, size_t(block->used));
+    block->size = block->used = 0;
+
+    QMutexLocker locker(&m_mutex);
+    ++m_stats.releases;
+    m_stats.inUseBytes -= block->capacity;
+    if (block->sizeClass >= 0 && m_stats.pooledBytes + block->capacity <= m_poolBudget) {
+        block->next = m_free[block->sizeClass];
+        m_free[block->sizeClass] = block;
+        m_stats.pooledBytes += block->capacity;
+        return;
+    }
+    if (block->locked) m_stats.lockedBytes -= block->capacity;
+    locker.unlock();
+    unmapBlock(block);
+}
+
+void PlaintextArena::setLockingEnabled(bool enabled)
+{
+    m_locking.store(enabled, std::memory_order_relaxed);
+}
+
+void PlaintextArena::setPoolBudget(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_poolBudget = qMax<qint64>(0, bytes);
+    trimTo(m_poolBudget);
+}
+
+qint64 PlaintextArena::poolBudget() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_poolBudget;
+}
+
+void PlaintextArena::trim()
+{
+    QMutexLocker locker(&m_mutex);
+    trimTo(0);
+}
+
+void PlaintextArena::trimTo(qint64 budget)
+{
+    // 先释放大块,尽量保留热路径上常用的小块
+    for (int index = ClassCount - 1; index >= 0 && m_stats.pooledBytes > budget; --index) {
+        while (m_free[index] && m_stats.pooledBytes > budget) {
+            Block *block = m_free[index];
+            m_free[index] = block->next;
+            m_stats.pooledBytes -= block->capacity;
+            if (block->locked) m_stats.lockedBytes -= block->capacity;
+            unmapBlock(block);
+        }
+    }
+}
+
+PlaintextArena::Stats PlaintextArena::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
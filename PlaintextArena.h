@@ -0,0 +1,164 @@
+#ifndef PLAINTEXTARENA_H
+#define PLAINTEXTARENA_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <atomic>
+
+class PlaintextArena;
+
+/**
+ * @brief 解密明文的 RAII 句柄
+ *
+ * 指向 PlaintextArena 分配的块,可以复制,复制只增加引用计数;最后一个句柄释放时
+ * 块被清零并归还内存池。也可以包装普通的 QByteArray(原始模式读到的本地文件等
+ * 不需要保护的数据),此时不经过内存池,释放时也不清零。
+ *
+ * 句柄本身是线程安全的引用计数;同一块的内容在发布给其他线程之后只读。
+ */
+class PlaintextBuffer
+{
+public:
+    PlaintextBuffer() = default;
+    PlaintextBuffer(const PlaintextBuffer &other);
+    PlaintextBuffer(PlaintextBuffer &&other) noexcept : m_block(other.m_block) { other.m_block = nullptr; }
+    PlaintextBuffer &operator=(const PlaintextBuffer &other);
+    PlaintextBuffer &operator=(PlaintextBuffer &&other) noexcept;
+    ~PlaintextBuffer();
+
+    /**
+     * @brief 包装不需要清零的数据,与 data 隐式共享
+     */
+    static PlaintextBuffer fromByteArray(const QByteArray &data);
+
+    bool isNull() const { return !m_block; }
+    bool isEmpty() const { return size() == 0; }
+    qsizetype size() const;
+    const char *constData() const;
+    /**
+     * @brief 可写指针,只能在句柄尚未复制、内容尚未发布时使用
+     */
+    char *data();
+
+    /**
+     * @brief 缩短有效长度,容量和清零范围不变
+     */
+    void truncate(qsizetype size);
+
+    /**
+     * @brief 不复制的 QByteArray 视图(QByteArray::fromRawData)
+     * 只在句柄存活期间有效,不能保存到句柄之外
+     */
+    QByteArray bytes() const;
+
+    /**
+     * @brief 复制到普通堆内存,明文从此不受内存池保护
+     * 包装的 QByteArray 直接返回共享的副本
+     */
+    QByteArray toByteArray() const;
+
+    /**
+     * @brief 数据是否位于内存池(按页对齐,释放时清零)
+     */
+    bool isPooled() const;
+
+private:
+    friend class PlaintextArena;
+    struct Block;
+    explicit PlaintextBuffer(Block *block) : m_block(block) {}
+    void release();
+
+    Block *m_block = nullptr;
+};
+
+/**
+ * @brief 解密明文专用的分级内存池
+ *
+ * 按 2 的幂划分大小级别(4KB ~ 16MB),每块按页对齐单独映射,释放后清零并留在
+ * 所属级别的空闲链表中供后续请求复用,热路径上不再向通用堆申请内存;
+ * 超过最大级别的请求单独分配,释放时清零后直接归还系统。
+ * 空闲块总量受 poolBudget 限制,超出的部分释放回系统,因此明文的内存占用 =
+ * 正在使用的块(受缓存预算和并发请求数约束) + 不超过预算的空闲块。
+ *
+ * 开启锁定后块在分配时锁定在物理内存中(mlock / VirtualLock),明文不会被换出到
+ * 交换文件;锁定失败(超出系统限额)时照常使用并计入 lockFailures。
+ *
+ * 所有接口线程安全。
+ */
+class PlaintextArena
+{
+public:
+    static constexpr qsizetype MinClassSize = 4 * 1024;
+    static constexpr qsizetype MaxClassSize = 16 * 1024 * 1024;
+    static constexpr int ClassCount = 13; // 4KB, 8KB, ..., 16MB
+
+    struct Stats {
+        quint64 allocations = 0;  // 向系统申请的块数
+        quint64 reuses = 0;       // 从空闲链表复用的次数
+        quint64 releases = 0;     // 清零归还的次数
+        quint64 lockFailures = 0; // 锁定失败的块数
+        qint64 inUseBytes = 0;    // 正在使用的块容量
+        qint64 peakInUseBytes = 0;
+        qint64 pooledBytes = 0;   // 空闲链表中的块容量
+        qint64 lockedBytes = 0;   // 当前锁定的字节数
+    };
+
+    static PlaintextArena &instance();
+
+    PlaintextArena();
+    ~PlaintextArena();
+    Q_DISABLE_COPY(PlaintextArena)
+
+    /**
+     * @brief 分配 size 字节,内容未初始化;size 为 0 时返回空句柄
+     */
+    PlaintextBuffer allocate(qsizetype size);
+
+    /**
+     * @brief 复制 size 字节到新分配的块
+     */
+    PlaintextBuffer copy(const char *data, qsizetype size);
+
+    /**
+     * @brief 之后分配的块是否锁定在物理内存中,默认关闭
+     */
+    void setLockingEnabled(bool enabled);
+    bool isLockingEnabled() const { return m_locking.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 空闲块总量的上限(字节),默认 32MB;缩小时立即释放超出的空闲块
+     */
+    void setPoolBudget(qint64 bytes);
+    qint64 poolBudget() const;
+
+    /**
+     * @brief 释放全部空闲块
+     */
+    void trim();
+
+    Stats stats() const;
+
+    /**
+     * @brief 请求大小对应的级别,超过最大级别时返回 -1
+     */
+    static int sizeClass(qsizetype size);
+
+private:
+    friend class PlaintextBuffer;
+    using Block = PlaintextBuffer::Block;
+
+    void release(Block *block);
+    // 要求调用方持有 m_mutex
+    void trimTo(qint64 budget);
+    Block *mapBlock(qsizetype capacity, int sizeClass);
+    void unmapBlock(Block *block);
+
+    mutable QMutex m_mutex;
+    Block *m_free[ClassCount] = {};
+    qint64 m_poolBudget = 32 * 1024 * 1024;
+    Stats m_stats;
+    std::atomic<bool> m_locking{false};
+    bool m_lockWarned = false;
+};
+
+#endif // PLAINTEXTARENA_H
@@ -1,17 +1,373 @@
 #include "ResourceEncryption.h"
+#include "ChunkMac.h"
+#include "CipherBackend.h"
 #include <QCryptographicHash>
+#include <QDebug>
+#include <QMessageAuthenticationCode>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QtEndian>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+struct DerivedKey::MacState {
+    std::once_flag once;
+    std::unique_ptr<ChunkMac> mac;
+};
+
+namespace {
+
+// 校验区间达到这个大小时分片并行
+constexpr qsizetype ParallelVerifyThreshold = 1024 * 1024;
+// 并行时每片至少包含的块数,避免任务调度开销超过校验本身
+constexpr qsizetype MinChunksPerTask = 16;
+
+// 解压前检查负载声明的原始长度,防止被篡改的长度字段迫使一次性分配巨大的缓冲区:
+// deflate 的压缩比不超过约 1032:1,单个资源也不应超过 1GB
+constexpr qint64 MaxCompressionRatio = 1032;
+constexpr qint64 MaxDecompressedSize = 1024LL * 1024 * 1024;
+
+/**
+ * @brief 版本 2 头部描述的标签表布局
+ */
+struct TagLayout {
+    qsizetype chunkSize = 0;
+    qsizetype chunkCount = 0;
+    qsizetype payloadOffset = 0;
+    qsizetype payloadSize = 0;
+};
+
+qsizetype chunkCountFor(qsizetype payloadSize, qsizetype chunkSize)
+{
+    return (payloadSize + chunkSize - 1) / chunkSize;
+}
+
+/**
+ * @brief 标签表的块数:空负载也有一块(长度为 0)的标签,截断成空负载同样会被发现
+ */
+qsizetype tagChunkCount(qsizetype payloadSize, qsizetype chunkSize)
+{
+    return qMax<qsizetype>(1, chunkCountFor(payloadSize, chunkSize));
+}
+
+/**
+ * @brief 读取并检查标签表布局,调用方已确认头部存在且版本为 2
+ */
+bool readTagLayout(const QByteArray &data, TagLayout *layout)
+{
+    const char *p = data.constData();
+    layout->chunkSize = qsizetype(qFromLittleEndian<quint32>(p + 24));
+    layout->chunkCount = qsizetype(qFromLittleEndian<quint32>(p + 28));
+    if (!ChunkMac::isValidChunkSize(layout->chunkSize)
+        || layout->chunkCount > (data.size() - ResourceEncryption::HeaderSize) / ChunkMac::TagSize)
+        return false;
+    layout->payloadOffset = ResourceEncryption::HeaderSize + layout->chunkCount * ChunkMac::TagSize;
+    layout->payloadSize = data.size() - layout->payloadOffset;
+    // 块数量必须与负载长度一致;它也参与每块标签的计算,截断负载后改小块数量无法通过校验
+    return tagChunkCount(layout->payloadSize, layout->chunkSize) == layout->chunkCount;
+}
+
+/**
+ * @brief 逐块比较 [first, last) 的标签
+ */
+bool verifyChunkRange(const QByteArray &data, const ChunkMac &mac, const TagLayout &layout,
+                      qsizetype first, qsizetype last)
+{
+    const char *header = data.constData();
+    const char *tags = data.constData() + ResourceEncryption::HeaderSize;
+    const char *payload = data.constData() + layout.payloadOffset;
+    for (qsizetype i = first; i < last; ++i) {
+        const qsizetype begin = i * layout.chunkSize;
+        const qsizetype size = qMin(layout.chunkSize, layout.payloadSize - begin);
+        const quint64 expected = qFromLittleEndian<quint64>(tags + i * ChunkMac::TagSize);
+        if (mac.tag(payload + begin, size, quint64(i), header) != expected) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+DerivedKey::DerivedKey(const QByteArray &material)
+    : m_material(material)
+    , m_mac(std::make_shared<MacState>())
+{
+}
+
+const ChunkMac &DerivedKey::chunkMac() const
+{
+    Q_ASSERT(m_mac);
+    std::call_once(m_mac->once, [this] { m_mac->mac = std::make_unique<ChunkMac>(*this); });
+    return *m_mac->mac;
+}
+
+QByteArray DerivedKey::fingerprint() const
+{
+    // 对密钥材料再做一次带域分隔的哈希，指纹无法反推出密钥
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(QByteArrayView("QtResourceEncryption/fingerprint"));
+    hash.addData(m_material);
+    return hash.result().toHex().left(16);
+}
+
+DerivedKey ResourceEncryption::deriveKey(const QString &key)
+{
+    return DerivedKey(generateKey(key));
+}
 
 QByteArray ResourceEncryption::encrypt(const QByteArray &data, const QString &key)
 {
-    QByteArray keyHash = generateKey(key);
-    return xorEncrypt(data, keyHash);
+    return encrypt(data, deriveKey(key));
 }
 
 QByteArray ResourceEncryption::decrypt(const QByteArray &encryptedData, const QString &key)
 {
-    // XOR加密的特性:加密和解密使用相同的操作
-    QByteArray keyHash = generateKey(key);
-    return xorEncrypt(encryptedData, keyHash);
+    return decrypt(encryptedData, deriveKey(key));
+}
+
+void ResourceEncryption::encryptInPlace(QByteArray &data, const QString &key)
+{
+    encryptInPlace(data, deriveKey(key));
+}
+
+void ResourceEncryption::decryptInPlace(QByteArray &data, const QString &key)
+{
+    decryptInPlace(data, deriveKey(key));
+}
+
+QByteArray ResourceEncryption::encrypt(const QByteArray &data, const DerivedKey &key,
+                                       CipherAlgorithm algorithm, CompressionMethod compression)
+{
+    return encryptPayload(compress(data, compression), key, algorithm, compression);
+}
+
+qsizetype ResourceEncryption::encryptedSize(qsizetype payloadSize)
+{
+    return HeaderSize + tagChunkCount(payloadSize, TagChunkSize) * ChunkMac::TagSize + payloadSize;
+}
+
+QByteArray ResourceEncryption::encryptPayload(const QByteArray &payload, const DerivedKey &key,
+                                              CipherAlgorithm algorithm, CompressionMethod compression)
+{
+    const QByteArray header = makeHeader(payload, key, algorithm, compression);
+    const auto cipher = CipherBackend::create(algorithm, key, header.mid(8, IvSize));
+    if (!cipher) return QByteArray();
+
+    // 头部、标签表和密文一次分配，密文直接写入结果缓冲区
+    QByteArray result(header.size() + payload.size(), Qt::Uninitialized);
+    memcpy(result.data(), header.constData(), header.size());
+    cipher->process(payload.constData(), result.data() + header.size(), payload.size(), 0);
+    writeChunkTags(result, key);
+    return result;
+}
+
+QByteArray ResourceEncryption::decrypt(const QByteArray &encryptedData, const DerivedKey &key)
+{
+    QByteArray result = decryptPayload(encryptedData, key);
+    const CompressionMethod compression = compressionOf(encryptedData);
+    // 解压失败按解密失败处理,不返回残缺的数据
+    if (compression != CompressionMethod::None && !decompress(result, compression)) return QByteArray();
+    return result;
+}
+
+QByteArray ResourceEncryption::decryptPayload(const QByteArray &encryptedData, const DerivedKey &key)
+{
+    qsizetype offset = 0;
+    const auto cipher = openCipher(encryptedData, key, &offset);
+    if (!cipher) return QByteArray();
+    if (!verifyChunks(encryptedData, key)) {
+        qWarning() << "完整性校验失败: 密文已被修改";
+        return QByteArray();
+    }
+
+    QByteArray result(encryptedData.size() - offset, Qt::Uninitialized);
+    cipher->process(encryptedData.constData() + offset, result.data(), result.size(), 0);
+    return result;
+}
+
+void ResourceEncryption::encryptInPlace(QByteArray &data, const DerivedKey &key,
+                                        CipherAlgorithm algorithm, CompressionMethod compression)
+{
+    if (compression != CompressionMethod::None) data = compress(data, compression);
+    const QByteArray header = makeHeader(data, key, algorithm, compression);
+    const auto cipher = CipherBackend::create(algorithm, key, header.mid(8, IvSize));
+    if (!cipher) {
+        data.clear();
+        return;
+    }
+    // 容量已预留时 resize 不会重新分配;负载后移到头部之后再原地加密
+    const qsizetype payloadSize = data.size();
+    if (data.capacity() < header.size() + payloadSize) data.reserve(header.size() + payloadSize);
+    data.resize(header.size() + payloadSize);
+    char *p = data.data();
+    memmove(p + header.size(), p, size_t(payloadSize));
+    memcpy(p, header.constData(), size_t(header.size()));
+    cipher->process(p + header.size(), p + header.size(), payloadSize, 0);
+    writeChunkTags(data, key);
+}
+
+void ResourceEncryption::decryptInPlace(QByteArray &data, const DerivedKey &key)
+{
+    qsizetype offset = 0;
+    const auto cipher = openCipher(data, key, &offset);
+    if (!cipher) {
+        data.clear();
+        return;
+    }
+    if (!verifyChunks(data, key)) {
+        qWarning() << "完整性校验失败: 密文已被修改";
+        data.clear();
+        return;
+    }
+    const CompressionMethod compression = compressionOf(data);
+    char *p = data.data() + offset;
+    cipher->process(p, p, data.size() - offset, 0);
+    // 从头部删除只移动起始指针，不搬移明文
+    data.remove(0, offset);
+    if (compression != CompressionMethod::None && !decompress(data, compression)) data.clear();
+}
+
+CipherAlgorithm ResourceEncryption::algorithmOf(const QByteArray &encryptedData)
+{
+    if (encryptedData.size() < HeaderSize
+        || memcmp(encryptedData.constData(), Magic, sizeof(Magic)) != 0)
+        return CipherAlgorithm::Xor;
+    return CipherAlgorithm(quint8(encryptedData.at(5)));
+}
+
+CompressionMethod ResourceEncryption::compressionOf(const QByteArray &encryptedData)
+{
+    if (encryptedData.size() < HeaderSize
+        || memcmp(encryptedData.constData(), Magic, sizeof(Magic)) != 0)
+        return CompressionMethod::None;
+    return CompressionMethod(quint8(encryptedData.at(6)));
+}
+
+bool ResourceEncryption::decompress(QByteArray &payload, CompressionMethod method)
+{
+    switch (method) {
+    case CompressionMethod::None:
+        return true;
+    case CompressionMethod::Zlib: {
+        // qUncompress 按负载前 4 字节(大端)记录的原始长度预先分配输出缓冲区,先检查长度是否可信
+        const qint64 claimed = payload.size() < 4 ? -1 : qint64(qFromBigEndian<quint32>(payload.constData()));
+        if (claimed < 0 || claimed > MaxDecompressedSize || claimed > (payload.size() - 4) * MaxCompressionRatio) {
+            qWarning() << "解压失败: 声明的原始长度不可信:" << claimed;
+            payload.clear();
+            return false;
+        }
+        if (claimed == 0) {
+            payload.clear();
+            return true;
+        }
+        payload = qUncompress(payload);
+        if (payload.size() != claimed) {
+            qWarning() << "解压失败: 数据损坏";
+            payload.clear();
+            return false;
+        }
+        return true;
+    }
+    }
+    qWarning() << "不支持的压缩方式:" << quint8(method);
+    payload.clear();
+    return false;
+}
+
+std::unique_ptr<CipherBackend> ResourceEncryption::openCipher(const QByteArray &encryptedData,
+                                                              const DerivedKey &key,
+                                                              qsizetype *payloadOffset,
+                                                              bool requireTags)
+{
+    if (requireTags && !hasChunkTags(encryptedData)) {
+        qWarning() << "拒绝没有认证标签的加密数据(旧版或格式版本 1)";
+        return nullptr;
+    }
+    if (encryptedData.size() < HeaderSize
+        || memcmp(encryptedData.constData(), Magic, sizeof(Magic)) != 0) {
+        // 旧版文件没有头部，整体是 XOR 密文
+        *payloadOffset = 0;
+        return CipherBackend::create(CipherAlgorithm::Xor, key, QByteArray());
+    }
+
+    const quint8 version = quint8(encryptedData.at(4));
+    const quint8 algorithm = quint8(encryptedData.at(5));
+    // 版本 1 没有标签表,仍然可以读取
+    TagLayout layout;
+    layout.payloadOffset = HeaderSize;
+    if (version == FormatVersion) {
+        if (!readTagLayout(encryptedData, &layout)) {
+            qWarning() << "加密数据的标签表损坏";
+            return nullptr;
+        }
+    } else if (version != 1) {
+        qWarning() << "不支持的加密格式版本:" << version;
+        return nullptr;
+    }
+    auto cipher = CipherBackend::create(CipherAlgorithm(algorithm), key,
+                                        encryptedData.mid(8, IvSize));
+    if (!cipher) {
+        qWarning() << "不支持的加密算法:" << algorithm;
+        return nullptr;
+    }
+    *payloadOffset = layout.payloadOffset;
+    return cipher;
+}
+
+bool ResourceEncryption::hasChunkTags(const QByteArray &encryptedData)
+{
+    return encryptedData.size() >= HeaderSize
+           && memcmp(encryptedData.constData(), Magic, sizeof(Magic)) == 0
+           && quint8(encryptedData.at(4)) == FormatVersion;
+}
+
+bool ResourceEncryption::verifyChunks(const QByteArray &encryptedData, const DerivedKey &key,
+                                      qsizetype offset, qsizetype size)
+{
+    if (!hasChunkTags(encryptedData)) return true;
+    TagLayout layout;
+    if (key.isNull() || !readTagLayout(encryptedData, &layout)) return false;
+    if (size < 0) size = layout.payloadSize - offset;
+    if (offset < 0 || offset > layout.payloadSize || size > layout.payloadSize - offset) return false;
+    // 空负载仍然校验它唯一的那一块
+    if (size == 0 && layout.payloadSize > 0) return true;
+
+    const qsizetype first = offset / layout.chunkSize;
+    const qsizetype last = qMax(first + 1, chunkCountFor(offset + size, layout.chunkSize));
+    const ChunkMac &mac = key.chunkMac();
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const qsizetype tasks = qMin<qsizetype>(pool->maxThreadCount(), (last - first) / MinChunksPerTask);
+    if (size < ParallelVerifyThreshold || tasks < 2)
+        return verifyChunkRange(encryptedData, mac, layout, first, last);
+
+    // 第 0 片由调用线程处理,其余交给线程池;等待前把还没开始的任务取回自己执行,
+    // 即使在线程池的工作线程中调用、线程池已满也不会死锁
+    std::atomic<bool> ok{true};
+    QSemaphore done;
+    const qsizetype perTask = (last - first + tasks - 1) / tasks;
+    auto slice = [&](qsizetype index) {
+        const qsizetype begin = first + index * perTask;
+        const qsizetype end = qMin(last, begin + perTask);
+        if (ok.load(std::memory_order_relaxed) && !verifyChunkRange(encryptedData, mac, layout, begin, end))
+            ok.store(false, std::memory_order_relaxed);
+    };
+    std::vector<std::unique_ptr<QRunnable>> runnables;
+    for (qsizetype i = 1; i < tasks; ++i) {
+        runnables.emplace_back(QRunnable::create([&slice, &done, i] {
+            slice(i);
+            done.release();
+        }));
+        runnables.back()->setAutoDelete(false);
+        pool->start(runnables.back().get());
+    }
+    slice(0);
+    for (const auto &runnable : runnables) {
+        if (pool->tryTake(runnable.get())) runnable->run();
+    }
+    done.acquire(int(runnables.size()));
+    return ok.load();
 }
 
 QByteArray ResourceEncryption::generateKey(const QString &key)
@@ -20,24 +376,48 @@ QByteArray ResourceEncryption::generateKey(const QString &key)
     return QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha256);
 }
 
-/**
- * @brief 使用 XOR 算法进行加解密
- * 由于 XOR 的特性：(A ^ B) ^ B = A，因此加解密可以使用同一个函数。
- * @param data 原始数据或已加密的数据
- * @param key  加密密钥
- * @return QByteArray 处理后的结果
- */
-QByteArray ResourceEncryption::xorEncrypt(const QByteArray &data, const QByteArray &key)
-{
-    // 复制原始数据到结果缓存
-    QByteArray result = data;
-    int keyLen = key.size();    
-    // 如果密钥为空，则直接返回原数据
-    if (keyLen <= 0) return result;
-    // 遍历每一个字节进行异或处理
-    for (int i = 0; i < result.size(); ++i) {
-        // 使用循环密钥（通过取模运算 i % keyLen 循环使用密钥字节）
-        result[i] = result[i] ^ key[i % keyLen];
-    }  
-    return result;
+QByteArray ResourceEncryption::makeHeader(const QByteArray &data, const DerivedKey &key,
+                                          CipherAlgorithm algorithm, CompressionMethod compression)
+{
+    // 标签按密文计算,加密完成后由 writeChunkTags 填写
+    const qsizetype chunkCount = tagChunkCount(data.size(), TagChunkSize);
+    QByteArray header(HeaderSize + chunkCount * ChunkMac::TagSize, '\0');
+    memcpy(header.data(), Magic, sizeof(Magic));
+    header[4] = char(FormatVersion);
+    header[5] = char(algorithm);
+    header[6] = char(compression);
+    qToLittleEndian(quint32(TagChunkSize), header.data() + 24);
+    qToLittleEndian(quint32(chunkCount), header.data() + 28);
+    if (algorithm != CipherAlgorithm::Xor) {
+        const QByteArray iv = QMessageAuthenticationCode::hash(data, key.material(),
+                                                               QCryptographicHash::Sha256);
+        memcpy(header.data() + 8, iv.constData(), IvSize);
+    }
+    return header;
+}
+
+void ResourceEncryption::writeChunkTags(QByteArray &data, const DerivedKey &key)
+{
+    TagLayout layout;
+    if (!readTagLayout(data, &layout)) return;
+    const ChunkMac &mac = key.chunkMac();
+    char *p = data.data();
+    for (qsizetype i = 0; i < layout.chunkCount; ++i) {
+        const qsizetype begin = i * layout.chunkSize;
+        const qsizetype size = qMin(layout.chunkSize, layout.payloadSize - begin);
+        qToLittleEndian(mac.tag(p + layout.payloadOffset + begin, size, quint64(i), p),
+                        p + HeaderSize + i * ChunkMac::TagSize);
+    }
+}
+
+QByteArray ResourceEncryption::compress(const QByteArray &data, CompressionMethod compression)
+{
+    switch (compression) {
+    case CompressionMethod::None:
+        return data;
+    case CompressionMethod::Zlib:
+        // 压缩只在构建时进行一次，使用最高压缩级别
+        return qCompress(data, 9);
+    }
+    return data;
 }
@@ -4,14 +4,100 @@
 #include <QByteArray>
 #include <QString>
 #include <QCryptographicHash>
+#include <memory>
+
+class ChunkMac;
+class CipherBackend;
+
+/**
+ * @brief 加密算法编号,写入 .enc 文件头部,运行时据此按文件分派
+ */
+enum class CipherAlgorithm : quint8 {
+    Xor = 0,       // 旧版循环密钥 XOR,仅用于兼容没有头部的旧文件
+    Aes256Ctr = 1, // AES-256 计数器模式
+};
+
+/**
+ * @brief 加密前的压缩方式,同样写入文件头部
+ */
+enum class CompressionMethod : quint8 {
+    None = 0,
+    Zlib = 1, // qCompress 格式:4 字节大端原始长度 + zlib 数据流
+};
+
+/**
+ * @brief 预先派生好的密钥材料
+ * 由 ResourceEncryption::deriveKey 生成一次,之后的加解密不再重复做哈希运算
+ */
+class DerivedKey
+{
+public:
+    DerivedKey() = default;
+
+    bool isNull() const { return m_material.isEmpty(); }
+    const QByteArray &material() const { return m_material; }
+
+    /**
+     * @brief 按块校验密文用的认证码,第一次使用时生成,同一密钥的副本共享
+     * 空密钥不能调用
+     */
+    const ChunkMac &chunkMac() const;
+
+    /**
+     * @brief 密钥指纹,可以安全地写入清单等文件用于判断密钥是否变化
+     */
+    QByteArray fingerprint() const;
+
+private:
+    friend class ResourceEncryption;
+    explicit DerivedKey(const QByteArray &material);
+
+    struct MacState;
+
+    QByteArray m_material;
+    std::shared_ptr<MacState> m_mac;
+};
 
 /**
  * @brief 资源加密/解密核心类
  * 使用AES-256算法进行资源加密
+ *
+ * 加密结果带 32 字节头部,记录算法和初始向量,解密时按文件分派到对应的后端:
+ * @code
+ *   0  char[4] magic "QENC"
+ *   4  u8      格式版本
+ *   5  u8      算法(CipherAlgorithm)
+ *   6  u8      压缩方式(CompressionMethod),先压缩后加密
+ *   7  u8      保留
+ *   8  u8[16]  初始向量
+ *   24 u32     校验块大小(小端,版本 2)
+ *   28 u32     校验块数量(小端,版本 2)
+ *   32 u64[n]  每块密文的认证标签(ChunkMac,小端,版本 2)
+ * @endcode
+ * 版本 2 在头部之后附带按块的认证标签,读取时只需校验实际读到的块;标签同时覆盖
+ * 头部的字节 4-31(版本、算法、压缩方式、初始向量、块大小和块数量)。
+ * 块数量必须等于 ceil(负载长度 / 块大小),否则整个资源被拒绝;
+ * 块数量受认证,因此负载也无法在块边界上被截断。
+ * 版本 1 没有标签,照常解密但不做校验。没有头部的数据按旧版 XOR 格式解密。
+ * 发布版本应使用 openCipher 的 requireTags 拒绝这两种数据,否则把头部改写为版本 1
+ * 即可绕过校验。
  */
 class ResourceEncryption
 {
 public:
+    static constexpr char Magic[4] = {'Q', 'E', 'N', 'C'};
+    static constexpr quint8 FormatVersion = 2;
+    static constexpr qsizetype HeaderSize = 32;
+    static constexpr qsizetype IvSize = 16;
+    static constexpr qsizetype TagChunkSize = 16 * 1024;
+
+    /**
+     * @brief 从密钥字符串派生密钥材料
+     * @param key 原始密钥字符串
+     * @return 可重复使用的派生密钥
+     */
+    static DerivedKey deriveKey(const QString &key);
+
     /**
      * @brief 加密数据
      * @param data 原始数据
@@ -27,7 +113,104 @@ public:
      * @return 解密后的数据
      */
     static QByteArray decrypt(const QByteArray &encryptedData, const QString &key);
-    
+
+    /**
+     * @brief 原地加密数据,头部和标签表写在同一缓冲区的开头
+     * data 的容量不小于 encryptedSize(data.size()) 时不重新分配,负载在缓冲区内后移一次;
+     * 容量不足时扩容一次。启用压缩时压缩结果本身是新的缓冲区
+     * @param data 待加密的数据,处理后即为密文
+     * @param key 加密密钥
+     */
+    static void encryptInPlace(QByteArray &data, const QString &key);
+
+    /**
+     * @brief 原地解密数据,不产生额外的整块拷贝
+     * @param data 加密的数据,处理后即为明文
+     * @param key 解密密钥
+     */
+    static void decryptInPlace(QByteArray &data, const QString &key);
+
+    /**
+     * @name 使用派生密钥的重载
+     * 适用于同一密钥反复解密大量资源的场景,每次调用不再做哈希运算
+     */
+    ///@{
+    static QByteArray encrypt(const QByteArray &data, const DerivedKey &key,
+                              CipherAlgorithm algorithm = CipherAlgorithm::Aes256Ctr,
+                              CompressionMethod compression = CompressionMethod::None);
+    static QByteArray decrypt(const QByteArray &encryptedData, const DerivedKey &key);
+    static void encryptInPlace(QByteArray &data, const DerivedKey &key,
+                               CipherAlgorithm algorithm = CipherAlgorithm::Aes256Ctr,
+                               CompressionMethod compression = CompressionMethod::None);
+    static void decryptInPlace(QByteArray &data, const DerivedKey &key);
+    ///@}
+
+    /**
+     * @brief 加密 payloadSize 字节的负载后的总长度(头部 + 标签表 + 密文)
+     * 调用方可以按此预留容量,使 encryptInPlace 不再重新分配
+     */
+    static qsizetype encryptedSize(qsizetype payloadSize);
+
+    /**
+     * @brief 加密已经按 compression 压缩好的负载,头部照常记录压缩方式
+     * 与 encrypt() 的结果逐字节相同,用于在不重新压缩的情况下重建密文(差分更新)
+     */
+    static QByteArray encryptPayload(const QByteArray &payload, const DerivedKey &key,
+                                     CipherAlgorithm algorithm, CompressionMethod compression);
+
+    /**
+     * @brief 解密但不解压,返回加密前的负载
+     */
+    static QByteArray decryptPayload(const QByteArray &encryptedData, const DerivedKey &key);
+
+    /**
+     * @brief 读取加密数据头部记录的算法,旧版无头部数据视为 XOR
+     */
+    static CipherAlgorithm algorithmOf(const QByteArray &encryptedData);
+
+    /**
+     * @brief 读取加密数据头部记录的压缩方式,旧版无头部数据视为未压缩
+     */
+    static CompressionMethod compressionOf(const QByteArray &encryptedData);
+
+    /**
+     * @brief 解压已解密的负载
+     * 输出缓冲区按负载中记录的原始长度一次性分配
+     * @return 是否成功,失败时 payload 被清空
+     */
+    static bool decompress(QByteArray &payload, CompressionMethod method);
+
+    /**
+     * @brief 数据是否带按块的认证标签(格式版本 2)
+     */
+    static bool hasChunkTags(const QByteArray &encryptedData);
+
+    /**
+     * @brief 校验密文负载中 [offset, offset + size) 所覆盖的块
+     * 偏移相对于密文负载(openCipher 输出的 payloadOffset 之后);区间会向外扩展到块边界,
+     * 因此按 TagChunkSize 的整数倍对齐读取时每块只校验一次。较大的区间在全局线程池上并行校验。
+     * 没有标签的旧数据直接返回 true
+     * @param size 长度,-1 表示到负载末尾
+     * @return 所有覆盖的块都通过校验
+     */
+    static bool verifyChunks(const QByteArray &encryptedData, const DerivedKey &key,
+                             qsizetype offset = 0, qsizetype size = -1);
+
+    /**
+     * @brief 解析加密数据的头部并创建对应的解密后端
+     * 用于流式读取大资源:调用方持有(映射的)密文,按需把片段解密到自己的缓冲区,
+     * 解密前用 verifyChunks 校验对应的区间
+     * @param encryptedData 加密的数据
+     * @param key 派生密钥
+     * @param payloadOffset 输出密文负载在 encryptedData 中的起始偏移
+     * @param requireTags 为 true 时拒绝没有认证标签的数据(旧版 XOR 和版本 1)
+     * @return 解密后端,头部无效、算法不受支持或缺少要求的标签时返回 nullptr
+     */
+    static std::unique_ptr<CipherBackend> openCipher(const QByteArray &encryptedData,
+                                                     const DerivedKey &key,
+                                                     qsizetype *payloadOffset,
+                                                     bool requireTags = false);
+
 private:
     /**
      * @brief 生成256位密钥
@@ -35,14 +218,24 @@ private:
      * @return 256位密钥
      */
     static QByteArray generateKey(const QString &key);
-    
+
+    /**
+     * @brief 生成文件头部和(全零的)标签表
+     * 初始向量由密钥和明文经 HMAC 确定性地派生:相同输入得到相同密文(构建可复现),
+     * 不同明文的初始向量不同,不会复用 CTR 密钥流
+     */
+    static QByteArray makeHeader(const QByteArray &data, const DerivedKey &key,
+                                 CipherAlgorithm algorithm, CompressionMethod compression);
+
+    /**
+     * @brief 为已加密的负载填写标签表,data 由 makeHeader 的结果和密文组成
+     */
+    static void writeChunkTags(QByteArray &data, const DerivedKey &key);
+
     /**
-     * @brief 简单的XOR加密(演示用,生产环境建议使用OpenSSL的AES)
-     * @param data 数据
-     * @param key 密钥
-     * @return 处理后的数据
+     * @brief 按压缩方式处理待加密的数据
      */
-    static QByteArray xorEncrypt(const QByteArray &data, const QByteArray &key);
+    static QByteArray compress(const QByteArray &data, CompressionMethod compression);
 };
 
 #endif // RESOURCEENCRYPTION_H
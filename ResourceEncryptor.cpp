@@ -1,11 +1,133 @@
 #include "ResourceEncryptor.h"
 #include "ResourceEncryption.h"
+#include "EncryptedArchive.h"
 #include <QFile>
 #include <QDir>
 #include <QDirIterator>
 #include <QDebug>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLibraryInfo>
+#include <QMutex>
+#include <QProcess>
+#include <QSaveFile>
+#include <QSemaphore>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThreadPool>
+#include <utility>
 
-bool ResourceEncryptor::encryptFile(const QString &inputPath, const QString &outputPath, const QString &key)
+namespace {
+
+// 增量构建清单,位于输出目录下
+const char MANIFEST_FILE[] = ".encmanifest.json";
+// 输出格式变化时递增,旧清单整体失效(版本 2: 输出改为带头部的 AES-256-CTR;
+// 版本 3: 输出附带按块的认证标签; 版本 4: 标签同时认证头部的算法和压缩方式;
+// 版本 5: 标签绑定块数量,空负载也带一块标签)
+const int MANIFEST_VERSION = 5;
+
+struct ManifestEntry {
+    qint64 size = -1;
+    qint64 mtime = 0;
+    QByteArray hash; // 源文件内容的 SHA-256(十六进制)
+    int compression = 0; // 输出使用的 CompressionMethod
+    bool precompiled = false; // 输出为预编译字节码(xxx.qmlc.enc)
+};
+
+using Manifest = QHash<QString, ManifestEntry>;
+
+/**
+ * @brief 读取待加密的文件,按加密后的总长度预留容量
+ * 之后的 encryptInPlace 直接在同一缓冲区内写入头部和密文,不再重新分配
+ */
+QByteArray readForEncryption(QFile &file)
+{
+    const qint64 size = file.size();
+    QByteArray data;
+    data.reserve(ResourceEncryption::encryptedSize(size));
+    data.resize(size);
+    const qint64 read = file.read(data.data(), size);
+    data.resize(qMax<qint64>(0, read));
+    return data;
+}
+
+void loadManifest(const QString &path, const QByteArray &keyFingerprint, Manifest *manifest)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != MANIFEST_VERSION) {
+        qDebug() << "输出格式已变化,忽略旧的增量清单";
+        return;
+    }
+    if (root.value("keyFingerprint").toString().toLatin1() != keyFingerprint) {
+        qDebug() << "密钥已变化,忽略旧的增量清单";
+        return;
+    }
+    const QJsonObject files = root.value("files").toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        ManifestEntry entry;
+        entry.size = obj.value("size").toInteger(-1);
+        entry.mtime = obj.value("mtime").toInteger();
+        entry.hash = obj.value("hash").toString().toLatin1();
+        entry.compression = obj.value("compression").toInt();
+        entry.precompiled = obj.value("precompiled").toBool();
+        manifest->insert(it.key(), entry);
+    }
+}
+
+void saveManifest(const QString &path, const QByteArray &keyFingerprint, const Manifest &manifest)
+{
+    QJsonObject files;
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        QJsonObject obj;
+        obj.insert("size", it->size);
+        obj.insert("mtime", it->mtime);
+        obj.insert("hash", QString::fromLatin1(it->hash));
+        obj.insert("compression", it->compression);
+        obj.insert("precompiled", it->precompiled);
+        files.insert(it.key(), obj);
+    }
+    QJsonObject root;
+    root.insert("version", MANIFEST_VERSION);
+    root.insert("keyFingerprint", QString::fromLatin1(keyFingerprint));
+    root.insert("files", files);
+    
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入增量清单:" << path;
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+}
+
+/**
+ * @brief 输出的相对路径:预编译的 QML 以 .qmlc 结尾
+ */
+QString outputRelativePath(const QString &relativePath, bool precompiled)
+{
+    return precompiled ? relativePath + "c" : relativePath;
+}
+
+} // namespace
+
+bool ResourceEncryptor::encryptFile(const QString &inputPath, const QString &outputPath, const QString &key,
+                                    CompressionMethod compression)
+{
+    return encryptFile(inputPath, outputPath, ResourceEncryption::deriveKey(key), nullptr, compression);
+}
+
+bool ResourceEncryptor::encryptFile(const QString &inputPath, const QString &outputPath,
+                                    const DerivedKey &key, qint64 *bytes,
+                                    CompressionMethod compression)
 {
     QFile inputFile(inputPath);
     if (!inputFile.open(QIODevice::ReadOnly)) {
@@ -13,21 +135,42 @@ bool ResourceEncryptor::encryptFile(const QString &inputPath, const QString &out
         return false;
     }
     
-    QByteArray data = inputFile.readAll();
+    QByteArray data = readForEncryption(inputFile);
     inputFile.close();
     
-    QByteArray encryptedData = ResourceEncryption::encrypt(data, key);
+    const qint64 sourceBytes = data.size();
+    if (!writeEncryptedFile(std::move(data), outputPath, key, compression)) {
+        return false;
+    }
     
-    QFile outputFile(outputPath);
+    if (bytes) {
+        *bytes = sourceBytes;
+    }
+    qDebug() << "加密成功:" << inputPath << "->" << outputPath;
+    return true;
+}
+
+bool ResourceEncryptor::writeEncryptedFile(QByteArray data, const QString &outputPath, const DerivedKey &key,
+                                           CompressionMethod compression)
+{
+    ResourceEncryption::encryptInPlace(data, key, CipherAlgorithm::Aes256Ctr, compression);
+    // 密文至少带头部,为空说明加密失败(例如不支持的算法)
+    if (data.isEmpty()) {
+        qWarning() << "加密失败:" << outputPath;
+        return false;
+    }
+    
+    // 先写临时文件,完整写入后才替换输出;磁盘已满或写入不完整时保留原来的输出,
+    // 增量清单也不会把残缺的文件记为最新
+    QSaveFile outputFile(outputPath);
     if (!outputFile.open(QIODevice::WriteOnly)) {
         qWarning() << "无法创建输出文件:" << outputPath;
         return false;
     }
-    
-    outputFile.write(encryptedData);
-    outputFile.close();
-    
-    qDebug() << "加密成功:" << inputPath << "->" << outputPath;
+    if (outputFile.write(data) != data.size() || !outputFile.commit()) {
+        qWarning() << "写入输出文件失败:" << outputPath << outputFile.errorString();
+        return false;
+    }
     return true;
 }
 
@@ -39,10 +182,16 @@ bool ResourceEncryptor::decryptFile(const QString &inputPath, const QString &out
         return false;
     }
     
-    QByteArray encryptedData = inputFile.readAll();
+    QByteArray data = inputFile.readAll();
     inputFile.close();
     
-    QByteArray decryptedData = ResourceEncryption::decrypt(encryptedData, key);
+    const bool hadInput = !data.isEmpty();
+    ResourceEncryption::decryptInPlace(data, key);
+    // 密钥错误、密文被修改或格式不受支持时 decryptInPlace 清空数据,不写出空文件
+    if (data.isEmpty() && hadInput) {
+        qWarning() << "解密失败(密钥错误或数据已损坏):" << inputPath;
+        return false;
+    }
     
     QFile outputFile(outputPath);
     if (!outputFile.open(QIODevice::WriteOnly)) {
@@ -50,7 +199,7 @@ bool ResourceEncryptor::decryptFile(const QString &inputPath, const QString &out
         return false;
     }
     
-    outputFile.write(decryptedData);
+    outputFile.write(data);
     outputFile.close();
     
     qDebug() << "解密成功:" << inputPath << "->" << outputPath;
@@ -58,36 +207,292 @@ bool ResourceEncryptor::decryptFile(const QString &inputPath, const QString &out
 }
 
 int ResourceEncryptor::encryptDirectory(const QString &inputDir, const QString &outputDir, 
-                                        const QString &key, const QStringList &extensions)
+                                        const QString &key, const QStringList &extensions,
+                                        int jobs, bool incremental,
+                                        const QStringList &compressExtensions,
+                                        const QString &qmlCompiler)
 {
+    QElapsedTimer timer;
+    timer.start();
+    
     QDir outDir(outputDir);
     if (!outDir.exists()) {
         outDir.mkpath(".");
     }
     
+    jobs = qMax(1, jobs);
+    const DerivedKey derivedKey = ResourceEncryption::deriveKey(key);
+    const QDir baseDir(inputDir);
+    QSet<QString> createdDirs;
+    
+    // 增量模式:读取上次的清单,密钥变化时清单整体作废
+    const QString manifestPath = outDir.filePath(MANIFEST_FILE);
+    Manifest oldManifest;
+    Manifest newManifest;
+    QMutex manifestMutex;
+    QSet<QString> seen;
+    if (incremental) {
+        loadManifest(manifestPath, derivedKey.fingerprint(), &oldManifest);
+    }
+    
+    // 扫描在当前线程进行,读取/加密/写入交给线程池;
+    // 在途任务数以信号量限制,目录树再大也不会一次性堆积所有任务
+    QThreadPool pool;
+    pool.setMaxThreadCount(jobs);
+    QSemaphore pending(jobs * 2);
+    QAtomicInt count(0);
+    QAtomicInt skipped(0);
+    QAtomicInteger<qint64> totalBytes(0);
+    QAtomicInteger<qint64> outputBytes(0);
+    
+    QDirIterator it(inputDir, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString filePath = it.next();
+        const QFileInfo fileInfo = it.fileInfo();
+        const QString suffix = "." + fileInfo.suffix();
+        if (!extensions.contains(suffix, Qt::CaseInsensitive)) {
+            continue;
+        }
+        
+        const QString relativePath = baseDir.relativeFilePath(filePath);
+        const bool precompile = !qmlCompiler.isEmpty() && suffix.compare(".qml", Qt::CaseInsensitive) == 0;
+        const QString outputPath = outputDir + "/" + outputRelativePath(relativePath, precompile) + ".enc";
+        
+        const CompressionMethod compression = compressionFor(filePath, compressExtensions);
+        ManifestEntry current;
+        current.size = fileInfo.size();
+        current.mtime = fileInfo.lastModified().toMSecsSinceEpoch();
+        current.compression = int(compression);
+        current.precompiled = precompile;
+        QByteArray oldHash;
+        if (incremental) {
+            seen.insert(relativePath);
+            const auto old = oldManifest.constFind(relativePath);
+            if (old != oldManifest.constEnd()) {
+                // 大小和修改时间都没变:不读文件,直接沿用上次的结果
+                if (old->size == current.size && old->mtime == current.mtime
+                    && old->compression == current.compression && old->precompiled == current.precompiled
+                    && QFile::exists(outputPath)) {
+                    QMutexLocker locker(&manifestMutex);
+                    newManifest.insert(relativePath, *old);
+                    skipped.fetchAndAddRelaxed(1);
+                    continue;
+                }
+                // 压缩方式或预编译开关变化时必须重新加密
+                if (old->compression == current.compression && old->precompiled == current.precompiled) {
+                    oldHash = old->hash;
+                }
+            }
+        }
+        
+        // 确保输出目录存在,每个目录只创建一次
+        const QString outputPathDir = QFileInfo(outputPath).absolutePath();
+        if (!createdDirs.contains(outputPathDir)) {
+            QDir().mkpath(outputPathDir);
+            createdDirs.insert(outputPathDir);
+        }
+        
+        pending.acquire();
+        pool.start([=, &derivedKey, &pending, &count, &skipped, &totalBytes, &outputBytes,
+                    &newManifest, &manifestMutex]() mutable {
+            QFile inputFile(filePath);
+            if (!inputFile.open(QIODevice::ReadOnly)) {
+                qWarning() << "无法打开输入文件:" << filePath;
+                pending.release();
+                return;
+            }
+            QByteArray data = readForEncryption(inputFile);
+            inputFile.close();
+            
+            bool unchanged = false;
+            if (incremental) {
+                // 仅修改时间变化而内容相同的文件不重新加密
+                current.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+                unchanged = current.hash == oldHash && QFile::exists(outputPath);
+            }
+            
+            const qint64 sourceBytes = data.size();
+            if (!unchanged && precompile) {
+                data = compileQml(filePath, qmlCompiler);
+                if (data.isEmpty()) {
+                    pending.release();
+                    return;
+                }
+            }
+            
+            bool ok = unchanged;
+            if (unchanged) {
+                skipped.fetchAndAddRelaxed(1);
+            } else if (writeEncryptedFile(std::move(data), outputPath, derivedKey, compression)) {
+                ok = true;
+                count.fetchAndAddRelaxed(1);
+                totalBytes.fetchAndAddRelaxed(sourceBytes);
+                outputBytes.fetchAndAddRelaxed(QFileInfo(outputPath).size());
+                // 预编译开关切换后,另一种形式的旧输出不应继续留在输出目录
+                if (suffix.compare(".qml", Qt::CaseInsensitive) == 0) {
+                    QFile::remove(outputDir + "/" + outputRelativePath(relativePath, !precompile) + ".enc");
+                }
+                qDebug() << "加密成功:" << filePath << "->" << outputPath;
+            }
+            if (incremental && ok) {
+                QMutexLocker locker(&manifestMutex);
+                newManifest.insert(relativePath, current);
+            }
+            pending.release();
+        });
+    }
+    pool.waitForDone();
+    
+    int removed = 0;
+    if (incremental) {
+        // 源文件已删除的条目,同时删除对应的加密输出
+        for (auto old = oldManifest.constBegin(); old != oldManifest.constEnd(); ++old) {
+            if (seen.contains(old.key())) {
+                continue;
+            }
+            const QString outputPath = outputDir + "/" + outputRelativePath(old.key(), old->precompiled) + ".enc";
+            if (QFile::remove(outputPath)) {
+                qDebug() << "已删除过期输出:" << outputPath;
+                removed++;
+            } else if (QFile::exists(outputPath)) {
+                qWarning() << "删除过期输出失败:" << outputPath;
+            }
+        }
+        saveManifest(manifestPath, derivedKey.fingerprint(), newManifest);
+    }
+    
+    const double seconds = qMax<qint64>(1, timer.elapsed()) / 1000.0;
+    const int files = count.loadRelaxed();
+    const double megabytes = totalBytes.loadRelaxed() / (1024.0 * 1024.0);
+    qDebug() << "总共加密了" << files << "个文件";
+    if (incremental) {
+        qDebug().noquote() << QString("增量构建: 重新加密 %1, 未变化 %2, 删除 %3")
+                                  .arg(files)
+                                  .arg(skipped.loadRelaxed())
+                                  .arg(removed);
+    }
+    if (!compressExtensions.isEmpty() && files > 0) {
+        qDebug().noquote() << QString("压缩: 原始 %1 KB -> 输出 %2 KB (%3%)")
+                                  .arg(totalBytes.loadRelaxed() / 1024.0, 0, 'f', 1)
+                                  .arg(outputBytes.loadRelaxed() / 1024.0, 0, 'f', 1)
+                                  .arg(100.0 * outputBytes.loadRelaxed()
+                                           / qMax<qint64>(1, totalBytes.loadRelaxed()), 0, 'f', 1);
+    }
+    qDebug().noquote() << QString("吞吐量: %1 个线程, 耗时 %2 s, %3 文件/秒, %4 MB/s")
+                              .arg(jobs)
+                              .arg(seconds, 0, 'f', 3)
+                              .arg(files / seconds, 0, 'f', 1)
+                              .arg(megabytes / seconds, 0, 'f', 2);
+    return files;
+}
+
+int ResourceEncryptor::packDirectory(const QString &inputDir, const QString &outputPath,
+                                     const QString &key, const QStringList &extensions,
+                                     const QStringList &compressExtensions,
+                                     const QString &qmlCompiler)
+{
+    EncryptedArchiveWriter writer(outputPath);
+    if (!writer.open()) {
+        return -1;
+    }
+    
+    const DerivedKey derivedKey = ResourceEncryption::deriveKey(key);
+    const QDir baseDir(inputDir);
     int count = 0;
-    QDirIterator it(inputDir, QDirIterator::Subdirectories);
+    qint64 inputBytes = 0;
+    qint64 totalBytes = 0;
+    QDirIterator it(inputDir, QDir::Files, QDirIterator::Subdirectories);
     
     while (it.hasNext()) {
         QString filePath = it.next();
         QFileInfo fileInfo(filePath);
         
-        if (fileInfo.isFile()) {
-            QString suffix = "." + fileInfo.suffix();
-            if (extensions.contains(suffix, Qt::CaseInsensitive)) {
-                QString relativePath = QDir(inputDir).relativeFilePath(filePath);
-                QString outputPath = outputDir + "/" + relativePath + ".enc";
-                
-                // 确保输出目录存在
-                QDir().mkpath(QFileInfo(outputPath).absolutePath());
-                
-                if (encryptFile(filePath, outputPath, key)) {
-                    count++;
-                }
+        // 没有后缀的文件(例如 qmldir)按文件名匹配
+        QString suffix = fileInfo.suffix().isEmpty() ? fileInfo.fileName() : "." + fileInfo.suffix();
+        if (!extensions.contains(suffix, Qt::CaseInsensitive)) {
+            continue;
+        }
+        
+        QFile inputFile(filePath);
+        if (!inputFile.open(QIODevice::ReadOnly)) {
+            qWarning() << "无法打开输入文件:" << filePath;
+            continue;
+        }
+        QByteArray data = readForEncryption(inputFile);
+        inputFile.close();
+        
+        inputBytes += data.size();
+        const bool precompile = !qmlCompiler.isEmpty() && suffix.compare(".qml", Qt::CaseInsensitive) == 0;
+        if (precompile) {
+            data = compileQml(filePath, qmlCompiler);
+            if (data.isEmpty()) {
+                return -1;
             }
         }
+        ResourceEncryption::encryptInPlace(data, derivedKey, CipherAlgorithm::Aes256Ctr,
+                                           compressionFor(filePath, compressExtensions));
+        const QString virtualPath = outputRelativePath(baseDir.relativeFilePath(filePath), precompile);
+        if (!writer.addEntry(virtualPath, data)) {
+            return -1;
+        }
+        totalBytes += data.size();
+        count++;
+        qDebug() << "已打包:" << virtualPath;
     }
     
-    qDebug() << "总共加密了" << count << "个文件";
+    if (!writer.finish()) {
+        return -1;
+    }
+    
+    qDebug() << "总共打包了" << count << "个文件," << inputBytes << "字节 ->" << totalBytes
+             << "字节 ->" << outputPath;
     return count;
 }
+
+CompressionMethod ResourceEncryptor::compressionFor(const QString &filePath,
+                                                    const QStringList &compressExtensions)
+{
+    const QFileInfo fileInfo(filePath);
+    const QString suffix = fileInfo.suffix().isEmpty() ? fileInfo.fileName() : "." + fileInfo.suffix();
+    return compressExtensions.contains(suffix, Qt::CaseInsensitive) ? CompressionMethod::Zlib
+                                                                    : CompressionMethod::None;
+}
+
+QByteArray ResourceEncryptor::compileQml(const QString &qmlPath, const QString &qmlCompiler)
+{
+    QTemporaryDir tempDir;
+    if (!tempDir.isValid()) {
+        qWarning() << "无法创建临时目录:" << tempDir.errorString();
+        return QByteArray();
+    }
+    
+    // 输出文件不以 .cpp 结尾时 qmlcachegen 直接写出二进制编译单元;
+    // 只生成字节码,不做 C++ AOT 编译,因此不需要导入路径和类型信息
+    const QString outputPath = tempDir.filePath(QFileInfo(qmlPath).fileName() + "c");
+    QProcess process;
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(qmlCompiler, {"--only-bytecode", "-o", outputPath, qmlPath});
+    if (!process.waitForFinished(-1) || process.exitStatus() != QProcess::NormalExit
+        || process.exitCode() != 0) {
+        const QString detail = process.error() == QProcess::FailedToStart
+                                   ? process.errorString()
+                                   : QString::fromLocal8Bit(process.readAll()).trimmed();
+        qWarning().noquote() << "预编译失败:" << qmlPath << "\n" << detail;
+        return QByteArray();
+    }
+    
+    QFile outputFile(outputPath);
+    if (!outputFile.open(QIODevice::ReadOnly)) {
+        qWarning() << "无法读取预编译结果:" << outputPath;
+        return QByteArray();
+    }
+    return outputFile.readAll();
+}
+
+QString ResourceEncryptor::defaultQmlCompiler()
+{
+    // Qt 6 把 qmlcachegen 安装在 libexec 目录,Windows 上则与 qmake 同在 bin 目录
+    return QStandardPaths::findExecutable("qmlcachegen",
+                                          {QLibraryInfo::path(QLibraryInfo::LibraryExecutablesPath),
+                                           QLibraryInfo::path(QLibraryInfo::BinariesPath)});
+}
@@ -4,6 +4,8 @@
 #include <QString>
 #include <QByteArray>
 
+#include "ResourceEncryption.h"
+
 /**
  * @brief 资源加密工具类
  * 用于在构建时加密资源文件
@@ -16,9 +18,24 @@ public:
      * @param inputPath 输入文件路径
      * @param outputPath 输出文件路径
      * @param key 加密密钥
+     * @param compression 加密前的压缩方式
+     * @return 是否成功
+     */
+    static bool encryptFile(const QString &inputPath, const QString &outputPath, const QString &key,
+                            CompressionMethod compression = CompressionMethod::None);
+
+    /**
+     * @brief 使用已派生的密钥加密文件(线程安全,供并行加密使用)
+     * @param inputPath 输入文件路径
+     * @param outputPath 输出文件路径
+     * @param key 派生密钥
+     * @param bytes 可选,输出处理的字节数
+     * @param compression 加密前的压缩方式
      * @return 是否成功
      */
-    static bool encryptFile(const QString &inputPath, const QString &outputPath, const QString &key);
+    static bool encryptFile(const QString &inputPath, const QString &outputPath,
+                            const DerivedKey &key, qint64 *bytes = nullptr,
+                            CompressionMethod compression = CompressionMethod::None);
     
     /**
      * @brief 解密文件
@@ -35,10 +52,61 @@ public:
      * @param outputDir 输出目录
      * @param key 加密密钥
      * @param extensions 要加密的文件扩展名(例如: .qml, .js)
-     * @return 成功加密的文件数量
+     * @param jobs 并行线程数
+     * @param incremental 增量模式:依据输出目录中的清单跳过未变化的文件,
+     *                    并删除源文件已不存在的输出
+     * @param compressExtensions 加密前先压缩的文件扩展名(例如: .qml, .js, qmldir)
+     * @param qmlCompiler 非空时用该 qmlcachegen 预编译 .qml,输出 xxx.qmlc.enc 代替源码
+     * @return 本次实际加密的文件数量
      */
     static int encryptDirectory(const QString &inputDir, const QString &outputDir, 
-                               const QString &key, const QStringList &extensions);
+                               const QString &key, const QStringList &extensions,
+                               int jobs = 1, bool incremental = false,
+                               const QStringList &compressExtensions = QStringList(),
+                               const QString &qmlCompiler = QString());
+
+    /**
+     * @brief 将目录中的文件加密并打包为单个资源归档
+     * @param inputDir 输入目录
+     * @param outputPath 输出归档路径
+     * @param key 加密密钥
+     * @param extensions 要打包的文件扩展名(例如: .qml, .js)
+     * @param compressExtensions 加密前先压缩的文件扩展名
+     * @param qmlCompiler 非空时用该 qmlcachegen 预编译 .qml,打包 xxx.qmlc 条目代替源码
+     * @return 打包的条目数量,失败时返回 -1
+     */
+    static int packDirectory(const QString &inputDir, const QString &outputPath,
+                             const QString &key, const QStringList &extensions,
+                             const QStringList &compressExtensions = QStringList(),
+                             const QString &qmlCompiler = QString());
+
+    /**
+     * @brief 按扩展名列表选择压缩方式
+     * 没有后缀的文件(例如 qmldir)按文件名匹配
+     */
+    static CompressionMethod compressionFor(const QString &filePath,
+                                            const QStringList &compressExtensions);
+
+    /**
+     * @brief 用 qmlcachegen 把 QML 源码编译为字节码(.qmlc)
+     * 字节码与编译它的 Qt 版本绑定,必须使用与运行时相同版本的 qmlcachegen
+     * @param qmlPath QML 源文件
+     * @param qmlCompiler qmlcachegen 路径
+     * @return 编译结果,失败时为空
+     */
+    static QByteArray compileQml(const QString &qmlPath, const QString &qmlCompiler);
+
+    /**
+     * @brief 当前 Qt 安装中 qmlcachegen 的路径,找不到时为空
+     */
+    static QString defaultQmlCompiler();
+
+    /**
+     * @brief 原地加密 data 并写出到 outputPath
+     * 完整写入后才替换已有的输出;加密或写入失败时返回 false,原来的输出保持不变
+     */
+    static bool writeEncryptedFile(QByteArray data, const QString &outputPath, const DerivedKey &key,
+                                   CompressionMethod compression = CompressionMethod::None);
 };
 
 #endif // RESOURCEENCRYPTOR_H
@@ -0,0 +1,309 @@
+#include "ResourceMetrics.h"
+#include "ResourcePath.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <algorithm>
+
+namespace {
+
+// 追踪事件中的线程号:按线程首次记录的顺序编号,比原生线程 ID 更易读
+int traceThreadId()
+{
+    static std::atomic<int> nextId{1};
+    thread_local const int id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+double toMs(quint64 ns)
+{
+    return double(ns) / 1e6;
+}
+
+} // namespace
+
+void ResourceMetrics::Record::addDecrypt(qint64 ns, qint64 size)
+{
+    decrypts.fetch_add(1, std::memory_order_relaxed);
+    decryptNs.fetch_add(quint64(ns), std::memory_order_relaxed);
+    bytes.fetch_add(quint64(size), std::memory_order_relaxed);
+    quint64 max = maxDecryptNs.load(std::memory_order_relaxed);
+    while (quint64(ns) > max && !maxDecryptNs.compare_exchange_weak(max, quint64(ns), std::memory_order_relaxed)) {
+    }
+}
+
+void ResourceMetrics::Record::addDelivery(qint64 ns)
+{
+    deliveries.fetch_add(1, std::memory_order_relaxed);
+    deliveryNs.fetch_add(quint64(ns), std::memory_order_relaxed);
+}
+
+ResourceMetrics &ResourceMetrics::instance()
+{
+    static ResourceMetrics metrics;
+    return metrics;
+}
+
+ResourceMetrics::ResourceMetrics()
+    : m_slots(new std::atomic<Record *>[Capacity])
+    , m_overflow(new Record(0, QStringLiteral("<other>")))
+{
+    for (int i = 0; i < Capacity; ++i) {
+        m_slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+    m_clock.start();
+}
+
+ResourceMetrics::~ResourceMetrics()
+{
+    for (int i = 0; i < Capacity; ++i) {
+        delete m_slots[i].load(std::memory_order_relaxed);
+    }
+}
+
+ResourceMetrics::Record *ResourceMetrics::record(const ResourcePath &path)
+{
+    if (!isEnabled()) {
+        return nullptr;
+    }
+
+    const quint64 mask = Capacity - 1;
+    Record *created = nullptr;
+    for (quint64 probe = 0, slot = path.hash() & mask; probe < Capacity; ++probe, slot = (slot + 1) & mask) {
+        Record *current = m_slots[slot].load(std::memory_order_acquire);
+        if (!current) {
+            if (!created) {
+                created = new Record(path.hash(), path.view().toString());
+            }
+            // 槽位只会从空变为非空;抢占失败时 current 变为胜者,继续按普通槽位比较
+            if (m_slots[slot].compare_exchange_strong(current, created, std::memory_order_acq_rel)) {
+                return created;
+            }
+        }
+        if (current->hash == path.hash() && current->path == path.view()) {
+            delete created;
+            return current;
+        }
+    }
+    delete created;
+    return m_overflow.get();
+}
+
+void ResourceMetrics::startTrace(int capacity)
+{
+    m_tracing.store(false);
+    m_trace.reset(new TraceEvent[capacity]);
+    m_traceCapacity = capacity;
+    m_traceNext.store(0);
+    m_traceDropped.store(0);
+    m_tracing.store(true);
+}
+
+void ResourceMetrics::traceSpan(const char *name, const Record *record, qint64 start, qint64 end, qint64 bytes)
+{
+    if (!isTracing()) {
+        return;
+    }
+    const quint64 index = m_traceNext.fetch_add(1, std::memory_order_relaxed);
+    if (index >= quint64(m_traceCapacity)) {
+        m_traceDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceEvent &event = m_trace[index];
+    event.name = name;
+    event.record = record;
+    event.start = start;
+    event.duration = end - start;
+    event.bytes = bytes;
+    event.thread = traceThreadId();
+    event.ready.store(true, std::memory_order_release);
+}
+
+QList<ResourceMetrics::Snapshot> ResourceMetrics::snapshot() const
+{
+    QList<Snapshot> result;
+    auto append = [&result](const Record *record) {
+        Snapshot s;
+        s.path = record->path;
+        s.requests = record->requests.load(std::memory_order_relaxed);
+        s.cacheHits = record->cacheHits.load(std::memory_order_relaxed);
+        s.cacheMisses = record->cacheMisses.load(std::memory_order_relaxed);
+        s.warmHits = record->warmHits.load(std::memory_order_relaxed);
+        s.failures = record->failures.load(std::memory_order_relaxed);
+        s.bytes = record->bytes.load(std::memory_order_relaxed);
+        s.lookupNs = record->lookupNs.load(std::memory_order_relaxed);
+        s.decryptNs = record->decryptNs.load(std::memory_order_relaxed);
+        s.maxDecryptNs = record->maxDecryptNs.load(std::memory_order_relaxed);
+        s.decrypts = record->decrypts.load(std::memory_order_relaxed);
+        s.deliveryNs = record->deliveryNs.load(std::memory_order_relaxed);
+        s.deliveries = record->deliveries.load(std::memory_order_relaxed);
+        if (s.requests || s.deliveries) {
+            result.append(s);
+        }
+    };
+    for (int i = 0; i < Capacity; ++i) {
+        if (const Record *record = m_slots[i].load(std::memory_order_acquire)) {
+            append(record);
+        }
+    }
+    append(m_overflow.get());
+
+    std::sort(result.begin(), result.end(), [](const Snapshot &a, const Snapshot &b) {
+        return a.decryptNs != b.decryptNs ? a.decryptNs > b.decryptNs : a.path < b.path;
+    });
+    return result;
+}
+
+QJsonObject ResourceMetrics::toJson() const
+{
+    QJsonArray resources;
+    quint64 requests = 0, hits = 0, misses = 0, bytes = 0, decryptNs = 0;
+    for (const Snapshot &s : snapshot()) {
+        QJsonObject entry;
+        entry["path"] = s.path;
+        entry["requests"] = qint64(s.requests);
+        entry["cacheHits"] = qint64(s.cacheHits);
+        entry["cacheMisses"] = qint64(s.cacheMisses);
+        entry["warmHits"] = qint64(s.warmHits);
+        entry["failures"] = qint64(s.failures);
+        entry["bytes"] = qint64(s.bytes);
+        entry["decrypts"] = qint64(s.decrypts);
+        entry["lookupMs"] = toMs(s.lookupNs);
+        entry["decryptMs"] = toMs(s.decryptNs);
+        entry["maxDecryptMs"] = toMs(s.maxDecryptNs);
+        entry["deliveries"] = qint64(s.deliveries);
+        entry["deliveryMs"] = toMs(s.deliveryNs);
+        resources.append(entry);
+
+        requests += s.requests;
+        hits += s.cacheHits;
+        misses += s.cacheMisses;
+        bytes += s.bytes;
+        decryptNs += s.decryptNs;
+    }
+
+    QJsonObject totals;
+    totals["requests"] = qint64(requests);
+    totals["cacheHits"] = qint64(hits);
+    totals["cacheMisses"] = qint64(misses);
+    totals["bytes"] = qint64(bytes);
+    totals["decryptMs"] = toMs(decryptNs);
+
+    QJsonObject root;
+    root["elapsedMs"] = toMs(quint64(now()));
+    root["totals"] = totals;
+    root["resources"] = resources;
+    return root;
+}
+
+bool ResourceMetrics::writeJson(const QString &fileName) const
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入计量文件:" << fileName << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(toJson()).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+bool ResourceMetrics::writeChromeTrace(const QString &fileName)
+{
+    stopTrace();
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "无法写入追踪文件:" << fileName << file.errorString();
+        return false;
+    }
+
+    const qint64 count = qMin<quint64>(m_traceNext.load(), quint64(m_traceCapacity));
+    QJsonArray events;
+    for (qint64 i = 0; i < count; ++i) {
+        const TraceEvent &event = m_trace[i];
+        // 停止追踪时仍在写入的事件直接跳过
+        if (!event.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+        QJsonObject args;
+        if (event.record) {
+            args["path"] = event.record->path;
+        }
+        if (event.bytes) {
+            args["bytes"] = event.bytes;
+        }
+        QJsonObject entry;
+        entry["name"] = QLatin1String(event.name);
+        entry["cat"] = QStringLiteral("resource");
+        entry["ph"] = QStringLiteral("X");
+        entry["ts"] = double(event.start) / 1e3;
+        entry["dur"] = double(event.duration) / 1e3;
+        entry["pid"] = 1;
+        entry["tid"] = event.thread;
+        entry["args"] = args;
+        events.append(entry);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = QStringLiteral("ms");
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        return false;
+    }
+
+    const quint64 dropped = m_traceDropped.load();
+    qDebug() << "追踪已写入" << fileName << "事件数:" << events.size()
+             << (dropped ? QStringLiteral("丢弃: %1").arg(dropped) : QString());
+    return true;
+}
+
+void ResourceMetrics::logSummary(int top) const
+{
+    const QList<Snapshot> all = snapshot();
+    quint64 requests = 0, hits = 0, bytes = 0, decryptNs = 0;
+    for (const Snapshot &s : all) {
+        requests += s.requests;
+        hits += s.cacheHits + s.warmHits;
+        bytes += s.bytes;
+        decryptNs += s.decryptNs;
+    }
+    qDebug().noquote() << QStringLiteral("资源计量: %1 个资源, %2 次请求, 命中 %3, 解密 %4 KB 共 %5 ms")
+                              .arg(all.size())
+                              .arg(requests)
+                              .arg(hits)
+                              .arg(bytes / 1024)
+                              .arg(toMs(decryptNs), 0, 'f', 2);
+    for (int i = 0; i < qMin(top, int(all.size())); ++i) {
+        const Snapshot &s = all.at(i);
+        qDebug().noquote() << QStringLiteral("  %1  解密 %2 ms (最长 %3 ms)  查找 %4 ms  交付 %5 ms  %6 B  命中 %7/%8")
+                                  .arg(s.path)
+                                  .arg(toMs(s.decryptNs), 0, 'f', 2)
+                                  .arg(toMs(s.maxDecryptNs), 0, 'f', 2)
+                                  .arg(toMs(s.lookupNs), 0, 'f', 3)
+                                  .arg(s.deliveries ? toMs(s.deliveryNs / s.deliveries) : 0.0, 0, 'f', 2)
+                                  .arg(s.bytes)
+                                  .arg(s.cacheHits + s.warmHits)
+                                  .arg(s.requests);
+    }
+}
+
+void ResourceMetrics::reset()
+{
+    auto clear = [](Record *record) {
+        for (std::atomic<quint64> *counter : {&record->requests, &record->cacheHits, &record->cacheMisses,
+                                              &record->warmHits, &record->failures, &record->bytes,
+                                              &record->lookupNs, &record->decryptNs, &record->maxDecryptNs,
+                                              &record->decrypts, &record->deliveryNs, &record->deliveries}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    };
+    // 记录本身保留,其它线程可能仍持有指针
+    for (int i = 0; i < Capacity; ++i) {
+        if (Record *record = m_slots[i].load(std::memory_order_acquire)) {
+            clear(record);
+        }
+    }
+    clear(m_overflow.get());
+}
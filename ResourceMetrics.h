@@ -0,0 +1,153 @@
+#ifndef RESOURCEMETRICS_H
+#define RESOURCEMETRICS_H
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+class ResourcePath;
+
+/**
+ * @brief 资源加载的计量与追踪
+ *
+ * 按资源路径累计查找耗时、解密耗时、字节数、缓存命中/未命中和回复交付延迟。
+ * 记录表是固定容量的开放寻址表,槽位只在路径首次出现时以 CAS 填入,之后永不删除;
+ * 各计数器都是独立的原子变量,热路径上不加锁也不分配内存。
+ * 表满后新路径的数据计入 "<other>" 记录。
+ *
+ * 可选的追踪把每次解密和请求记录为 Chrome Trace 事件(chrome://tracing 或 Perfetto 打开),
+ * 事件写入预先分配的缓冲区,写满后丢弃并计数。
+ */
+class ResourceMetrics
+{
+public:
+    /**
+     * @brief 单个资源路径的计数器(耗时单位为纳秒)
+     */
+    struct Record {
+        explicit Record(quint64 pathHash, QString resourcePath)
+            : hash(pathHash), path(std::move(resourcePath)) {}
+
+        const quint64 hash;
+        const QString path;
+        std::atomic<quint64> requests{0};
+        std::atomic<quint64> cacheHits{0};
+        std::atomic<quint64> cacheMisses{0};
+        std::atomic<quint64> warmHits{0};
+        std::atomic<quint64> failures{0};
+        std::atomic<quint64> bytes{0};
+        std::atomic<quint64> lookupNs{0};
+        std::atomic<quint64> decryptNs{0};
+        std::atomic<quint64> maxDecryptNs{0};
+        std::atomic<quint64> decrypts{0};
+        std::atomic<quint64> deliveryNs{0};
+        std::atomic<quint64> deliveries{0};
+
+        void addLookup(qint64 ns) { lookupNs.fetch_add(quint64(ns), std::memory_order_relaxed); }
+        void addDecrypt(qint64 ns, qint64 size);
+        void addDelivery(qint64 ns);
+    };
+
+    /**
+     * @brief 某一时刻的计数器快照,用于展示和导出
+     */
+    struct Snapshot {
+        QString path;
+        quint64 requests = 0;
+        quint64 cacheHits = 0;
+        quint64 cacheMisses = 0;
+        quint64 warmHits = 0;
+        quint64 failures = 0;
+        quint64 bytes = 0;
+        quint64 lookupNs = 0;
+        quint64 decryptNs = 0;
+        quint64 maxDecryptNs = 0;
+        quint64 decrypts = 0;
+        quint64 deliveryNs = 0;
+        quint64 deliveries = 0;
+    };
+
+    static ResourceMetrics &instance();
+
+    ResourceMetrics(const ResourceMetrics &) = delete;
+    ResourceMetrics &operator=(const ResourceMetrics &) = delete;
+
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 取得路径的计数器,首次出现时创建
+     * @return 未开启计量时返回 nullptr,调用方据此跳过计时
+     */
+    Record *record(const ResourcePath &path);
+
+    /**
+     * @brief 计量时钟(进程内单调,纳秒)
+     */
+    qint64 now() const { return m_clock.nsecsElapsed(); }
+
+    /**
+     * @brief 开始追踪,预先分配 capacity 个事件;应在加载开始前调用
+     */
+    void startTrace(int capacity = 1 << 16);
+    void stopTrace() { m_tracing.store(false); }
+    bool isTracing() const { return m_tracing.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 记录一个完整的时间段事件
+     * @param name 事件名,必须是静态字符串
+     * @param record 关联的资源,可为空
+     * @param start now() 得到的开始时间
+     * @param end now() 得到的结束时间
+     * @param bytes 附带的字节数
+     */
+    void traceSpan(const char *name, const Record *record, qint64 start, qint64 end, qint64 bytes = 0);
+
+    QList<Snapshot> snapshot() const;
+    QJsonObject toJson() const;
+    bool writeJson(const QString &fileName) const;
+
+    /**
+     * @brief 停止追踪并写出 Chrome Trace JSON
+     */
+    bool writeChromeTrace(const QString &fileName);
+
+    /**
+     * @brief 按解密耗时输出最慢的若干资源到日志
+     */
+    void logSummary(int top = 10) const;
+
+    void reset();
+
+private:
+    ResourceMetrics();
+    ~ResourceMetrics();
+
+    struct TraceEvent {
+        std::atomic<bool> ready{false};
+        const char *name = nullptr;
+        const Record *record = nullptr;
+        qint64 start = 0;
+        qint64 duration = 0;
+        qint64 bytes = 0;
+        int thread = 0;
+    };
+
+    static constexpr int Capacity = 4096;
+
+    std::atomic<bool> m_enabled{false};
+    QElapsedTimer m_clock;
+    std::unique_ptr<std::atomic<Record *>[]> m_slots;
+    std::unique_ptr<Record> m_overflow;
+
+    std::atomic<bool> m_tracing{false};
+    std::unique_ptr<TraceEvent[]> m_trace;
+    int m_traceCapacity = 0;
+    std::atomic<quint64> m_traceNext{0};
+    std::atomic<quint64> m_traceDropped{0};
+};
+
+#endif // RESOURCEMETRICS_H
@@ -0,0 +1,83 @@
+#include "ResourceMetricsModule.h"
+#include "ResourceMetrics.h"
+#include <QJsonDocument>
+#include <QVariantMap>
+
+ResourceMetricsModule::ResourceMetricsModule(QObject *parent)
+    : QObject(parent) {
+  refresh();
+}
+
+bool ResourceMetricsModule::enabled() const {
+  return ResourceMetrics::instance().isEnabled();
+}
+
+void ResourceMetricsModule::setEnabled(bool enabled) {
+  if (enabled == this->enabled())
+    return;
+  ResourceMetrics::instance().setEnabled(enabled);
+  emit updated();
+}
+
+bool ResourceMetricsModule::tracing() const {
+  return ResourceMetrics::instance().isTracing();
+}
+
+void ResourceMetricsModule::refresh() {
+  const QList<ResourceMetrics::Snapshot> all =
+      ResourceMetrics::instance().snapshot();
+  quint64 requests = 0, hits = 0, bytes = 0, decryptNs = 0;
+  for (const ResourceMetrics::Snapshot &s : all) {
+    requests += s.requests;
+    hits += s.cacheHits + s.warmHits;
+    bytes += s.bytes;
+    decryptNs += s.decryptNs;
+  }
+  m_resourceCount = int(all.size());
+  m_requests = qint64(requests);
+  m_bytes = qint64(bytes);
+  m_decryptMs = double(decryptNs) / 1e6;
+  m_cacheHitRate = requests ? double(hits) / double(requests) : 0.0;
+  emit updated();
+}
+
+QVariantList ResourceMetricsModule::resources() const {
+  QVariantList result;
+  for (const ResourceMetrics::Snapshot &s :
+       ResourceMetrics::instance().snapshot()) {
+    QVariantMap entry;
+    entry["path"] = s.path;
+    entry["requests"] = qint64(s.requests);
+    entry["cacheHits"] = qint64(s.cacheHits + s.warmHits);
+    entry["cacheMisses"] = qint64(s.cacheMisses);
+    entry["failures"] = qint64(s.failures);
+    entry["bytes"] = qint64(s.bytes);
+    entry["lookupMs"] = double(s.lookupNs) / 1e6;
+    entry["decryptMs"] = double(s.decryptNs) / 1e6;
+    entry["maxDecryptMs"] = double(s.maxDecryptNs) / 1e6;
+    entry["deliveryMs"] =
+        s.deliveries ? double(s.deliveryNs) / 1e6 / double(s.deliveries) : 0.0;
+    result.append(entry);
+  }
+  return result;
+}
+
+QString ResourceMetricsModule::toJson() const {
+  return QString::fromUtf8(
+      QJsonDocument(ResourceMetrics::instance().toJson()).toJson());
+}
+
+bool ResourceMetricsModule::saveJson(const QString &fileName) const {
+  return ResourceMetrics::instance().writeJson(fileName);
+}
+
+bool ResourceMetricsModule::saveTrace(const QString &fileName) {
+  const bool ok = ResourceMetrics::instance().writeChromeTrace(fileName);
+  emit updated();
+  return ok;
+}
+
+void ResourceMetricsModule::reset() {
+  ResourceMetrics::instance().reset();
+  refresh();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QObject>
+#include <QVariantList>
+#include <QtQml/qqmlregistration.h>
+
+/**
+ * @brief 资源计量的 QML 接口
+ *
+ * 在 QML 中以单例 ResourceMetrics 访问；数据来自 ResourceMetrics::instance()，
+ * 调用 refresh() 后汇总属性更新，resources() 返回按解密耗时排序的明细。
+ */
+class ResourceMetricsModule : public QObject {
+  Q_OBJECT
+  QML_NAMED_ELEMENT(ResourceMetrics)
+  QML_SINGLETON
+  Q_PROPERTY(bool enabled READ enabled WRITE setEnabled NOTIFY updated)
+  Q_PROPERTY(bool tracing READ tracing NOTIFY updated)
+  Q_PROPERTY(int resourceCount READ resourceCount NOTIFY updated)
+  Q_PROPERTY(qint64 requests READ requests NOTIFY updated)
+  Q_PROPERTY(qint64 bytes READ bytes NOTIFY updated)
+  Q_PROPERTY(double decryptMs READ decryptMs NOTIFY updated)
+  Q_PROPERTY(double cacheHitRate READ cacheHitRate NOTIFY updated)
+public:
+  explicit ResourceMetricsModule(QObject *parent = nullptr);
+
+  bool enabled() const;
+  void setEnabled(bool enabled);
+  bool tracing() const;
+  int resourceCount() const { return m_resourceCount; }
+  qint64 requests() const { return m_requests; }
+  qint64 bytes() const { return m_bytes; }
+  double decryptMs() const { return m_decryptMs; }
+  double cacheHitRate() const { return m_cacheHitRate; }
+
+  Q_INVOKABLE void refresh();
+  Q_INVOKABLE QVariantList resources() const;
+  Q_INVOKABLE QString toJson() const;
+  Q_INVOKABLE bool saveJson(const QString &fileName) const;
+  Q_INVOKABLE bool saveTrace(const QString &fileName);
+  Q_INVOKABLE void reset();
+
+signals:
+  void updated();
+
+private:
+  int m_resourceCount = 0;
+  qint64 m_requests = 0;
+  qint64 m_bytes = 0;
+  double m_decryptMs = 0;
+  double m_cacheHitRate = 0;
+};
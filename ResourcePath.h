@@ -0,0 +1,81 @@
+#ifndef RESOURCEPATH_H
+#define RESOURCEPATH_H
+
+#include <QByteArrayView>
+#include <QStringEncoder>
+#include <QStringView>
+#include <QVarLengthArray>
+#include <QtEndian>
+#include <cstring>
+
+/**
+ * @brief 64 位整数混合函数(splitmix64 的终结步骤)
+ */
+inline quint64 resourceHashMix(quint64 x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * @brief 资源路径的 64 位哈希,按 UTF-8 字节计算
+ * 打包工具和运行时使用同一个函数,结果写入归档,因此不能随平台或 Qt 版本变化
+ */
+inline quint64 resourcePathHash(QByteArrayView utf8)
+{
+    const char *p = utf8.data();
+    qsizetype n = utf8.size();
+    quint64 h = 0x9e3779b97f4a7c15ULL * quint64(n + 1);
+    for (; n >= 8; p += 8, n -= 8)
+        h = resourceHashMix(h ^ qFromLittleEndian<quint64>(p));
+    if (n > 0) {
+        uchar tail[8] = {};
+        std::memcpy(tail, p, size_t(n));
+        h = resourceHashMix(h ^ qFromLittleEndian<quint64>(tail));
+    }
+    return h;
+}
+
+/**
+ * @brief 请求中的资源路径
+ *
+ * 去掉开头的 '/' 后在栈上转换为 UTF-8(不超过 256 字节时不分配内存),并计算一次哈希;
+ * 注册表和所有归档都用这份 UTF-8 视图和哈希查找,同一次请求不会重复转换。
+ */
+class ResourcePath
+{
+public:
+    explicit ResourcePath(QStringView path)
+    {
+        while (path.startsWith(u'/'))
+            path = path.mid(1);
+        m_view = path;
+
+        // 绝大多数路径是 ASCII,逐字符收窄;含非 ASCII 字符时交给 UTF-8 编码器
+        m_utf8.resize(path.size());
+        qsizetype i = 0;
+        for (; i < path.size() && path[i].unicode() < 0x80; ++i)
+            m_utf8[i] = char(path[i].unicode());
+        if (i < path.size()) {
+            QStringEncoder encoder(QStringEncoder::Utf8);
+            m_utf8.resize(encoder.requiredSpace(path.size()));
+            m_utf8.resize(encoder.appendToBuffer(m_utf8.data(), path) - m_utf8.data());
+        }
+        m_hash = resourcePathHash(utf8());
+    }
+
+    QStringView view() const { return m_view; }
+    QByteArrayView utf8() const { return QByteArrayView(m_utf8.constData(), m_utf8.size()); }
+    quint64 hash() const { return m_hash; }
+
+private:
+    QStringView m_view;
+    QVarLengthArray<char, 256> m_utf8;
+    quint64 m_hash = 0;
+};
+
+#endif // RESOURCEPATH_H
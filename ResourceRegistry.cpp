@@ -0,0 +1,209 @@
+#include "ResourceRegistry.h"
+#include "EncryptedArchive.h"
+#include "EncryptedResourceDirectory.h"
+#include "ResourcePath.h"
+#include <QMutexLocker>
+#include <QThread>
+
+ResourceRegistry::ReadGuard::ReadGuard(const ResourceRegistry *registry)
+{
+    ReaderSlot &slot = registry->m_slots[slotIndex()];
+    // 先登记再确认阶段未变:写者切换阶段后只等待旧阶段的读者,
+    // 登记时阶段已被切换的读者必须改到新阶段重新登记
+    for (;;) {
+        const int phase = registry->m_phase.load();
+        m_counter = &slot.readers[phase];
+        m_counter->fetch_add(1);
+        if (registry->m_phase.load() == phase) {
+            break;
+        }
+        m_counter->fetch_sub(1);
+    }
+    m_snapshot = registry->m_current.load();
+}
+
+ResourceRegistry::ReadGuard::~ReadGuard()
+{
+    m_counter->fetch_sub(1, std::memory_order_release);
+}
+
+ResourceRegistry::ResourceRegistry()
+    : m_current(new Snapshot)
+{
+    m_current.load()->rebuildIndex();
+}
+
+ResourceRegistry::~ResourceRegistry()
+{
+    delete m_current.load();
+}
+
+int ResourceRegistry::slotIndex()
+{
+    // 线程首次查找时分配槽位,前 SlotCount 个线程各自独占一个
+    static std::atomic<int> nextSlot{0};
+    thread_local const int slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % SlotCount;
+    return slot;
+}
+
+void ResourceRegistry::Snapshot::rebuildIndex()
+{
+    entries.clear();
+    entries.reserve(resources.size());
+    for (auto it = resources.constBegin(); it != resources.constEnd(); ++it) {
+        Entry entry;
+        entry.utf8Path = it.key().toUtf8();
+        entry.hash = resourcePathHash(entry.utf8Path);
+        entry.data = it.value();
+        entries.append(entry);
+    }
+
+    // 装载因子不超过 1/2,线性探测
+    qsizetype size = 16;
+    while (size < entries.size() * 2) size *= 2;
+    mask = quint64(size - 1);
+    table.fill(-1, size);
+    for (qsizetype i = 0; i < entries.size(); ++i) {
+        quint64 slot = entries.at(i).hash & mask;
+        while (table.at(slot) >= 0) slot = (slot + 1) & mask;
+        table[slot] = qint32(i);
+    }
+}
+
+const ResourceRegistry::Entry *ResourceRegistry::Snapshot::findEntry(const ResourcePath &path) const
+{
+    const QByteArrayView utf8 = path.utf8();
+    for (quint64 slot = path.hash() & mask;; slot = (slot + 1) & mask) {
+        const qint32 index = table.at(slot);
+        if (index < 0) return nullptr;
+        const Entry &entry = entries.at(index);
+        if (entry.hash == path.hash() && QByteArrayView(entry.utf8Path) == utf8) return &entry;
+    }
+}
+
+bool ResourceRegistry::find(const ResourcePath &path, QByteArray *data, quint32 *flags) const
+{
+    ReadGuard guard(this);
+    const Snapshot *snapshot = guard.snapshot();
+    if (const Entry *entry = snapshot->findEntry(path)) {
+        *data = entry->data;
+        *flags = EncryptedArchive::Encrypted;
+        return true;
+    }
+    // 归档条目本来就直接引用映射内存,不涉及引用计数
+    for (const QSharedPointer<EncryptedArchive> &archive : snapshot->archives) {
+        if (archive->lookup(path, data, flags)) {
+            return true;
+        }
+    }
+    // 目录条目在首次请求时才解析,之后同样直接引用资源数据或映射内存
+    for (const QSharedPointer<EncryptedResourceDirectory> &directory : snapshot->directories) {
+        if (directory->lookup(path, data, flags)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ResourceRegistry::contains(const ResourcePath &path) const
+{
+    ReadGuard guard(this);
+    const Snapshot *snapshot = guard.snapshot();
+    if (snapshot->findEntry(path)) {
+        return true;
+    }
+    for (const QSharedPointer<EncryptedArchive> &archive : snapshot->archives) {
+        if (archive->contains(path)) {
+            return true;
+        }
+    }
+    for (const QSharedPointer<EncryptedResourceDirectory> &directory : snapshot->directories) {
+        if (directory->contains(path)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qsizetype ResourceRegistry::size() const
+{
+    ReadGuard guard(this);
+    return guard.snapshot()->resources.size();
+}
+
+QStringList ResourceRegistry::paths() const
+{
+    ReadGuard guard(this);
+    const Snapshot *snapshot = guard.snapshot();
+    QStringList result = snapshot->resources.keys();
+    for (const QSharedPointer<EncryptedArchive> &archive : snapshot->archives) {
+        result += archive->entryPaths();
+    }
+    for (const QSharedPointer<EncryptedResourceDirectory> &directory : snapshot->directories) {
+        result += directory->entryPaths();
+    }
+    result.removeDuplicates();
+    return result;
+}
+
+void ResourceRegistry::insert(const QString &path, const QByteArray &data)
+{
+    QMutexLocker locker(&m_writeMutex);
+    Snapshot *next = copyCurrent();
+    next->resources.insert(path, data);
+    publish(next);
+}
+
+void ResourceRegistry::insert(const QHash<QString, QByteArray> &resources)
+{
+    if (resources.isEmpty()) {
+        return;
+    }
+    QMutexLocker locker(&m_writeMutex);
+    Snapshot *next = copyCurrent();
+    next->resources.reserve(next->resources.size() + resources.size());
+    for (auto it = resources.constBegin(); it != resources.constEnd(); ++it) {
+        next->resources.insert(it.key(), it.value());
+    }
+    publish(next);
+}
+
+void ResourceRegistry::addArchive(const QSharedPointer<EncryptedArchive> &archive)
+{
+    QMutexLocker locker(&m_writeMutex);
+    Snapshot *next = copyCurrent();
+    next->archives.append(archive);
+    publish(next);
+}
+
+void ResourceRegistry::addDirectory(const QSharedPointer<EncryptedResourceDirectory> &directory)
+{
+    QMutexLocker locker(&m_writeMutex);
+    Snapshot *next = copyCurrent();
+    next->directories.append(directory);
+    publish(next);
+}
+
+ResourceRegistry::Snapshot *ResourceRegistry::copyCurrent() const
+{
+    // 写者之间由 m_writeMutex 串行,当前快照不会在复制期间被释放
+    // 新快照与旧快照共享 QHash 数据,第一次修改时才分离,旧快照的读者不受影响
+    return new Snapshot(*m_current.load(std::memory_order_relaxed));
+}
+
+void ResourceRegistry::publish(Snapshot *next)
+{
+    next->rebuildIndex();
+    Snapshot *old = m_current.exchange(next);
+
+    // 切换读者阶段:之后登记的读者只会读到新快照,
+    // 旧快照只可能被旧阶段的读者持有,等它们全部离开后即可释放
+    const int oldPhase = m_phase.load(std::memory_order_relaxed);
+    m_phase.store(oldPhase ^ 1);
+    for (ReaderSlot &slot : m_slots) {
+        while (slot.readers[oldPhase].load() != 0) {
+            QThread::yieldCurrentThread();
+        }
+    }
+    delete old;
+}
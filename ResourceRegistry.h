@@ -0,0 +1,112 @@
+#ifndef RESOURCEREGISTRY_H
+#define RESOURCEREGISTRY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+
+class EncryptedArchive;
+class EncryptedResourceDirectory;
+class ResourcePath;
+
+/**
+ * @brief 加密资源注册表(密文、已挂载的归档和按需解析的资源目录)
+ *
+ * 读多写少:注册基本发生在启动阶段,之后所有加载线程和引擎只做查找。
+ * 查找读取当前发布的不可变快照,不加锁;注册在写锁内复制快照、修改后整体发布(RCU),
+ * 再等待仍可能持有旧快照的读者离开后释放旧快照。
+ * 读者计数按线程分散到不同缓存行,多个线程同时查找时不会争用同一个计数器。
+ * 每个快照发布前构建一张按 UTF-8 路径开放寻址的扁平查找表,查找不需要 QString 键,
+ * 与归档共用请求路径已经转换好的 UTF-8 视图和哈希。
+ */
+class ResourceRegistry
+{
+public:
+    ResourceRegistry();
+    ~ResourceRegistry();
+
+    ResourceRegistry(const ResourceRegistry &) = delete;
+    ResourceRegistry &operator=(const ResourceRegistry &) = delete;
+
+    /**
+     * @brief 查找资源,单独注册的资源优先于归档,归档优先于资源目录中的同名条目
+     * @param path 资源路径(UTF-8 视图和哈希)
+     * @param data 输出密文;与注册表共享,或直接引用归档映射
+     * @param flags 输出条目标志(EncryptedArchive::EntryFlag)
+     */
+    bool find(const ResourcePath &path, QByteArray *data, quint32 *flags) const;
+    bool contains(const ResourcePath &path) const;
+
+    void insert(const QString &path, const QByteArray &data);
+    /**
+     * @brief 批量注册,只复制和发布一次快照
+     */
+    void insert(const QHash<QString, QByteArray> &resources);
+    void addArchive(const QSharedPointer<EncryptedArchive> &archive);
+    void addDirectory(const QSharedPointer<EncryptedResourceDirectory> &directory);
+
+    qsizetype size() const;
+    /**
+     * @brief 全部已注册的资源路径(单独注册的资源、归档条目和目录条目,去重)
+     */
+    QStringList paths() const;
+
+private:
+    struct Entry {
+        quint64 hash = 0;
+        QByteArray utf8Path;
+        QByteArray data;
+    };
+
+    struct Snapshot {
+        QHash<QString, QByteArray> resources;
+        QList<QSharedPointer<EncryptedArchive>> archives;
+        QList<QSharedPointer<EncryptedResourceDirectory>> directories;
+        // resources 的只读查找表,发布前由 rebuildIndex() 生成
+        QList<Entry> entries;
+        QList<qint32> table; // 槽位 -> entries 下标,-1 表示空
+        quint64 mask = 0;
+
+        void rebuildIndex();
+        const Entry *findEntry(const ResourcePath &path) const;
+    };
+
+    // 每个槽位独占一条缓存行,两个计数器分别对应当前和上一个读者阶段
+    struct alignas(64) ReaderSlot {
+        std::atomic<int> readers[2] = {0, 0};
+    };
+    static constexpr int SlotCount = 64;
+
+    /**
+     * @brief 读者临界区,期间持有的快照不会被释放
+     */
+    class ReadGuard
+    {
+    public:
+        explicit ReadGuard(const ResourceRegistry *registry);
+        ~ReadGuard();
+        const Snapshot *snapshot() const { return m_snapshot; }
+
+    private:
+        std::atomic<int> *m_counter;
+        const Snapshot *m_snapshot;
+    };
+
+    // 以下两个函数要求调用方持有 m_writeMutex
+    Snapshot *copyCurrent() const;
+    void publish(Snapshot *next);
+
+    static int slotIndex();
+
+    std::atomic<Snapshot *> m_current;
+    std::atomic<int> m_phase{0};
+    mutable ReaderSlot m_slots[SlotCount];
+    QMutex m_writeMutex;
+};
+
+#endif // RESOURCEREGISTRY_H
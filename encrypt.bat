@@ -22,9 +22,9 @@ if %errorlevel% equ 0 (
     echo [错误] qmldir 加密失败
 )
 
-./resource_encryptor.exe -m encrypt -i ..\..\test_image.png -o ../../test_image.png.enc -k "MySecretKey123!@#"
+./resource_encryptor.exe -m encrypt -i ../../CMake-Logo.png -o ../../CMake-Logo.png.enc -k "MySecretKey123!@#"
 if %errorlevel% equ 0 (
-    echo [成功] test_image.png 加密成功
+    echo [成功] CMake-Logo.png 加密成功
 ) else (
-    echo [错误] test_image.png 加密失败
+    echo [错误] CMake-Logo.png 加密失败
 )
@@ -1,6 +1,9 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QThread>
+#include <utility>
+#include "EncryptedArchiveDelta.h"
 #include "ResourceEncryptor.h"
 
 int main(int argc, char *argv[])
@@ -16,7 +19,8 @@ int main(int argc, char *argv[])
     
     // 定义命令行选项
     QCommandLineOption modeOption(QStringList() << "m" << "mode",
-                                  "操作模式: encrypt(加密) 或 decrypt(解密)",
+                                  "操作模式: encrypt(加密)、decrypt(解密)、pack(打包为归档)、"
+                                  "diff(生成归档差分) 或 patch(原地应用差分)",
                                   "mode",
                                   "encrypt");
     parser.addOption(modeOption);
@@ -47,6 +51,41 @@ int main(int argc, char *argv[])
                                        "处理整个目录");
     parser.addOption(directoryOption);
     
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "目录加密的并行线程数(默认为CPU核心数)",
+                                  "N",
+                                  QString::number(QThread::idealThreadCount()));
+    parser.addOption(jobsOption);
+    
+    QCommandLineOption incrementalOption(QStringList() << "incremental",
+                                         "增量加密: 跳过未变化的文件, 删除已不存在的源文件的输出");
+    parser.addOption(incrementalOption);
+    
+    QCommandLineOption compressOption(QStringList() << "z" << "compress",
+                                      "加密前先压缩的文件扩展名(逗号分隔,例如: .qml,.js,qmldir)",
+                                      "extensions");
+    parser.addOption(compressOption);
+    
+    QCommandLineOption precompileOption(QStringList() << "qmlc",
+                                        "用 qmlcachegen 预编译 .qml, 输出字节码(xxx.qmlc)代替源码");
+    parser.addOption(precompileOption);
+    
+    QCommandLineOption qmlCompilerOption(QStringList() << "qmlcachegen",
+                                         "qmlcachegen 路径(默认使用当前 Qt 安装中的版本, 必须与运行时 Qt 版本一致)",
+                                         "path");
+    parser.addOption(qmlCompilerOption);
+    
+    QCommandLineOption baseOption(QStringList() << "base",
+                                  "diff 模式: 旧版本归档, 与 -i 指定的新版本归档比较",
+                                  "archive");
+    parser.addOption(baseOption);
+    
+    QCommandLineOption blockSizeOption(QStringList() << "block-size",
+                                       "diff 模式: 按块比较变化条目的块大小(字节)",
+                                       "bytes",
+                                       QString::number(EncryptedArchiveDelta::DefaultBlockSize));
+    parser.addOption(blockSizeOption);
+    
     parser.process(app);
     
     // 获取参数
@@ -56,6 +95,18 @@ int main(int argc, char *argv[])
     QString key = parser.value(keyOption);
     QString extensions = parser.value(extensionsOption);
     bool isDirectory = parser.isSet(directoryOption);
+    int jobs = qMax(1, parser.value(jobsOption).toInt());
+    bool incremental = parser.isSet(incrementalOption);
+    QStringList compressList = parser.value(compressOption).split(',', Qt::SkipEmptyParts);
+    QString qmlCompiler;
+    if (parser.isSet(precompileOption)) {
+        qmlCompiler = parser.isSet(qmlCompilerOption) ? parser.value(qmlCompilerOption)
+                                                      : ResourceEncryptor::defaultQmlCompiler();
+        if (qmlCompiler.isEmpty()) {
+            qCritical() << "错误: 找不到 qmlcachegen, 请用 --qmlcachegen 指定";
+            return 1;
+        }
+    }
     
     // 验证参数
     if (input.isEmpty()) {
@@ -74,13 +125,55 @@ int main(int argc, char *argv[])
     qDebug() << "输入路径:" << input;
     qDebug() << "输出路径:" << output;
     qDebug() << "使用密钥:" << (key.length() > 0 ? "***" : "无");
+    if (!qmlCompiler.isEmpty()) {
+        qDebug() << "预编译QML:" << qmlCompiler;
+    }
     
     // 执行操作
+    if (mode == "diff") {
+        // -i 新版本归档, --base 旧版本归档, -o 差分文件
+        if (!parser.isSet(baseOption)) {
+            qCritical() << "错误: diff 模式必须用 --base 指定旧版本归档";
+            return 1;
+        }
+        EncryptedArchiveDelta delta;
+        if (!delta.create(parser.value(baseOption), input, output, ResourceEncryption::deriveKey(key),
+                          parser.value(blockSizeOption).toInt())) {
+            qCritical() << "生成差分失败:" << delta.errorString();
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (mode == "patch") {
+        // -i 差分文件, -o 要原地更新的归档
+        EncryptedArchiveDelta delta;
+        if (!delta.apply(output, input, ResourceEncryption::deriveKey(key))) {
+            qCritical() << "应用差分失败:" << delta.errorString();
+            return 1;
+        }
+        return 0;
+    }
+    
+    if (mode == "pack") {
+        // 打包模式总是以目录为输入,输出单个归档文件
+        QStringList extList = extensions.split(',', Qt::SkipEmptyParts);
+        int count = ResourceEncryptor::packDirectory(input, output, key, extList, compressList,
+                                                     qmlCompiler);
+        if (count < 0) {
+            qCritical() << "打包失败";
+            return 1;
+        }
+        qDebug() << "打包完成,共" << count << "个条目";
+        return 0;
+    }
+    
     if (isDirectory) {
         QStringList extList = extensions.split(',', Qt::SkipEmptyParts);
         
         if (mode == "encrypt") {
-            int count = ResourceEncryptor::encryptDirectory(input, output, key, extList);
+            int count = ResourceEncryptor::encryptDirectory(input, output, key, extList, jobs, incremental,
+                                                        compressList, qmlCompiler);
             qDebug() << "加密完成,处理了" << count << "个文件";
         } else if (mode == "decrypt") {
             qCritical() << "目录解密功能暂未实现";
@@ -92,8 +185,17 @@ int main(int argc, char *argv[])
     } else {
         bool success = false;
         
-        if (mode == "encrypt") {
-            success = ResourceEncryptor::encryptFile(input, output, key);
+        if (mode == "encrypt" && !qmlCompiler.isEmpty() && input.endsWith(".qml")) {
+            // 单文件预编译:输出路径由调用方指定,通常为 xxx.qmlc.enc
+            // 与目录模式相同,经 writeEncryptedFile 完整写入后才替换输出
+            QByteArray bytecode = ResourceEncryptor::compileQml(input, qmlCompiler);
+            success = !bytecode.isEmpty()
+                      && ResourceEncryptor::writeEncryptedFile(std::move(bytecode), output,
+                                                               ResourceEncryption::deriveKey(key),
+                                                               ResourceEncryptor::compressionFor(input, compressList));
+        } else if (mode == "encrypt") {
+            success = ResourceEncryptor::encryptFile(input, output, key,
+                                                     ResourceEncryptor::compressionFor(input, compressList));
         } else if (mode == "decrypt") {
             success = ResourceEncryptor::decryptFile(input, output, key);
         } else {
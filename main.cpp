@@ -1,120 +1,99 @@
-#include <QDateTime>
 #include <QDebug>
-#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QDir>
 #include <QFile>
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
-#include <QTextStream>
+#include <QStandardPaths>
+#include <QTimer>
+#include <memory>
 
+#include "AsyncLogger.h"
+#include "EncryptedArchiveDelta.h"
+#include "EncryptedImageProvider.h"
 #include "EncryptedNetworkAccessManager.h"
+#include "EncryptedQmlUnitCache.h"
+#include "EncryptedResourceMount.h"
 #include "EncryptedResourceSelector.h"
+#include "PlaintextArena.h"
+#include "ResourceMetrics.h"
 
 // 原始资源模式开关
 // #define USE_ENCRYPTED_RESOURCES
 
-// 日志文件
-static QFile logFile;
-
-void messageHandler(QtMsgType type, const QMessageLogContext &context,
-                    const QString &msg) {
-  QString txt;
-  switch (type) {
-  case QtDebugMsg:
-    txt = QString("[DEBUG] %1").arg(msg);
-    break;
-  case QtWarningMsg:
-    txt = QString("[WARNING] %1").arg(msg);
-    break;
-  case QtCriticalMsg:
-    txt = QString("[CRITICAL] %1").arg(msg);
-    break;
-  case QtFatalMsg:
-    txt = QString("[FATAL] %1").arg(msg);
-    abort();
-  case QtInfoMsg:
-    txt = QString("[INFO] %1").arg(msg);
-    break;
-  }
-  // 输出到控制台
-  fprintf(stderr, "%s\n", txt.toLocal8Bit().constData());
-  fflush(stderr);
-  // 输出到文件
-  if (logFile.isOpen()) {
-    QTextStream ts(&logFile);
-    ts << QDateTime::currentDateTime().toString("hh:mm:ss.zzz ") << txt << "\n";
-    ts.flush();
-  }
+// 打包后的资源归档，存在时优先于逐个 .enc 文件
+static const char ENCRYPTED_ARCHIVE[] = ":/encrypted/resources.pak";
+
+// 可现场更新的本地归档(位于程序目录)，存在时优先于内置归档；
+// 同目录下的 <归档>.delta 在启动时原地应用
+static const char LOCAL_ARCHIVE[] = "resources.pak";
+
+// 上次启动记录的资源访问顺序，用于本次后台预热；
+// 位于应用数据目录，程序目录在安装后通常不可写
+static const char STARTUP_PROFILE[] = "startup.profile";
+
+// 原始模式下文件修改后等待合并的时间：编辑器一次保存常触发多次通知
+static const int RELOAD_DEBOUNCE_MS = 20;
+
+/**
+ * @brief 访问记录的完整路径(QStandardPaths::AppDataLocation)，目录不存在时创建
+ */
+QString startupProfilePath() {
+  const QString dir =
+      QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  QDir().mkpath(dir);
+  return dir + "/" + STARTUP_PROFILE;
 }
 
 /**
- * @brief 自动加载并注册所有加密资源
- * 扫描 qrc 中 :/encrypted 路径下的所有 .enc 文件并自动注册
+ * @brief 按环境变量 ENCRYPTED_LOG_LEVEL(debug/info/warning/critical)选择最低日志级别
  */
-void loadEncryptedResources(EncryptedResourceSelector *selector) {
-  // // 从加密文件中加载资源
-  // // 这些加密文件可以嵌入到二进制中或从外部加载
-  // QFile encFile(":/encrypted/main.qml.enc");
-  // if (encFile.open(QIODevice::ReadOnly))
-  // {
-  //     QByteArray encryptedData = encFile.readAll();
-  //     selector->registerEncryptedResource("main.qml", encryptedData);
-  //     encFile.close();
-  //     qDebug() << "已注册加密资源: main.qml";
-  // }
-  // QFile encFile2(":/encrypted/MyComponent.qml.enc");
-  // if (encFile2.open(QIODevice::ReadOnly))
-  // {
-  //     QByteArray encryptedData = encFile2.readAll();
-  //     selector->registerEncryptedResource("MyComponent.qml", encryptedData);
-  //     encFile2.close();
-  //     qDebug() << "已注册加密资源: MyComponent.qml";
-  // }
-  // // 测试图片资源 (从本地文件读取加密后的产物)
-  // QFile imgFile(":/encrypted/CMake-Logo.png.enc");
-  // if (imgFile.open(QIODevice::ReadOnly))
-  // {
-  //     QByteArray encryptedData = imgFile.readAll();
-  //     selector->registerEncryptedResource("CMake-Logo.png", encryptedData);
-  //     imgFile.close();
-  //     qDebug() << "已注册加密资源: CMake-Logo.png";
-  // }
-  // // 加载 qmldir
-  // QFile qmldirFile(":/encrypted/qmldir.enc");
-  // if (qmldirFile.open(QIODevice::ReadOnly))
-  // {
-  //     selector->registerEncryptedResource("qmldir", qmldirFile.readAll());
-  //     qDebug() << "成功注册加密资源: qmldir";
-  // }
-
-  // 使用 QDirIterator 遍历资源系统中的加密文件
-  QDirIterator it(":/encrypted", QDirIterator::Subdirectories);
-  while (it.hasNext()) {
-    it.next();
-    QString fullPath = it.filePath(); // 例如 ":/encrypted/main.qml.enc"
-    QString fileName = it.fileName(); // 例如 "main.qml.enc"
-    // 只处理以 .enc 结尾的文件
-    if (fileName.endsWith(".enc")) {
-      QFile file(fullPath);
-      if (file.open(QIODevice::ReadOnly)) {
-        // 自动计算虚拟路径：去掉末尾的 .enc
-        QString virtualName = fileName.left(fileName.length() - 4);
-        selector->registerEncryptedResource(virtualName, file.readAll());
-        file.close();
-        qDebug() << "[AutoLoad] 已注册加密资源:" << virtualName << "<-"
-                 << fileName;
-      }
-    }
-  }
+QtMsgType logLevelFromEnvironment() {
+  const QString level = qEnvironmentVariable("ENCRYPTED_LOG_LEVEL").toLower();
+  if (level == "info")
+    return QtInfoMsg;
+  if (level == "warning")
+    return QtWarningMsg;
+  if (level == "critical")
+    return QtCriticalMsg;
+  return QtDebugMsg;
+}
+
+/**
+ * @brief 挂载归档之前把下发的差分原地应用到本地归档，成功后删除差分
+ * 源版本不匹配或校验失败时归档保持不变，继续使用当前版本
+ */
+void applyPendingUpdate(const QString &archive, const DerivedKey &key) {
+  const QString deltaFile = archive + ".delta";
+  if (!QFile::exists(archive) || !QFile::exists(deltaFile))
+    return;
+  EncryptedArchiveDelta delta;
+  if (delta.apply(archive, deltaFile, key))
+    QFile::remove(deltaFile);
+  else
+    qWarning() << "资源更新失败，继续使用当前版本:" << delta.errorString();
 }
 
 int main(int argc, char *argv[]) {
-  // 安装日志处理器
-  logFile.setFileName("debug.log");
-  logFile.open(QIODevice::WriteOnly | QIODevice::Append);
-  qInstallMessageHandler(messageHandler);
+  // 安装日志处理器：调用线程只入队，格式化和写文件在后台线程成批进行
+  AsyncLogger logger("debug.log");
+  logger.setMinimumLevel(logLevelFromEnvironment());
+  logger.install();
+
+  // 资源计量：每个资源的查找/解密耗时、字节数、命中情况和交付延迟
+  // 设置 ENCRYPTED_TRACE=<文件> 记录整个启动过程的 Chrome Trace，
+  // 设置 ENCRYPTED_METRICS=<文件> 在退出时写出计量 JSON
+  ResourceMetrics &metrics = ResourceMetrics::instance();
+  metrics.setEnabled(true);
+  const QString tracePath = qEnvironmentVariable("ENCRYPTED_TRACE");
+  const QString metricsPath = qEnvironmentVariable("ENCRYPTED_METRICS");
+  if (!tracePath.isEmpty())
+    metrics.startTrace();
 
   QGuiApplication app(argc, argv);
+  // 挂载的内存资源必须比引擎活得久，因此先于引擎声明
+  std::unique_ptr<EncryptedResourceMount> mount;
   QQmlApplicationEngine engine;
 
   // --- 开发调试开关 ---
@@ -126,10 +105,47 @@ int main(int argc, char *argv[]) {
   // 统一创建选择器
   EncryptedResourceSelector *selector =
       new EncryptedResourceSelector(&engine, DECRYPTION_KEY, &app);
+  // 预编译的 QML(xxx.qmlc)直接交给引擎，跳过源码的解析和编译
+  std::unique_ptr<EncryptedQmlUnitCache> unitCache;
 
 #ifdef USE_ENCRYPTED_RESOURCES
   qDebug() << "运行模式: [加密模式]";
-  loadEncryptedResources(selector);
+  // 归档只映射索引，条目在首次请求时才解密；本地归档优先于内置归档，
+  // 都没有时按需解析 qrc 中的 :/encrypted/*.enc，启动时只遍历文件名
+  const QString localArchive =
+      app.applicationDirPath() + "/" + LOCAL_ARCHIVE;
+  applyPendingUpdate(localArchive, selector->decryptionKey());
+  if (!(QFile::exists(localArchive) && selector->addArchive(localArchive)) &&
+      !(QFile::exists(ENCRYPTED_ARCHIVE) &&
+        selector->addArchive(ENCRYPTED_ARCHIVE)))
+    selector->addResourceDirectory(":/encrypted");
+  // 只接受带认证标签的密文，被改写为旧格式以绕过校验的资源拒绝加载
+  selector->setRequireChunkTags(true);
+  // 明文缓存默认关闭，解密结果用完即释放；设置 ENCRYPTED_CACHE_MB=<n> 时
+  // 按 n MB 的预算缓存，同一组件/图片被多处引用时直接复用已解密的明文
+  const int cacheMb = qEnvironmentVariableIntValue("ENCRYPTED_CACHE_MB");
+  if (cacheMb > 0)
+    selector->setCacheBudget(qint64(cacheMb) * 1024 * 1024);
+  // 设置 ENCRYPTED_LOCK_MEMORY 时明文锁定在物理内存中，不会被换出到交换文件；
+  // 超出系统限额的部分照常使用，日志中给出提示
+  if (qEnvironmentVariableIsSet("ENCRYPTED_LOCK_MEMORY"))
+    PlaintextArena::instance().setLockingEnabled(true);
+  // 引擎构建期间在工作线程上预先解密上次启动用到的资源
+  // 设置环境变量 ENCRYPTED_NO_WARMUP 可关闭，用于对比启动耗时
+  const QString profilePath = startupProfilePath();
+  const bool warmUp = !qEnvironmentVariableIsSet("ENCRYPTED_NO_WARMUP");
+  if (warmUp && !selector->warmUpFromProfile(profilePath))
+    qDebug() << "[WarmUp] 没有访问记录，本次启动将生成:" << profilePath;
+  selector->setAccessRecording(true);
+  unitCache = std::make_unique<EncryptedQmlUnitCache>(selector);
+  // 设置 ENCRYPTED_MOUNT 时把 QML/JS/qmldir 预先解密挂载为内存 qrc 资源，
+  // 引擎按本地文件同步加载，不再经过网络管理器；图片等其余资源照常按需解密
+  if (qEnvironmentVariableIsSet("ENCRYPTED_MOUNT")) {
+    mount = std::make_unique<EncryptedResourceMount>(selector);
+    if (mount->mount(
+            EncryptedResourceMount::codePaths(selector->resourcePaths())))
+      engine.addUrlInterceptor(mount.get());
+  }
 #else
   qDebug() << "运行模式: [原始资源模式] - 自定义协议自动映射本地文件";
   // 设置为原始模式，并指向源码根目录
@@ -139,18 +155,66 @@ int main(int argc, char *argv[]) {
   // 无论哪种模式，都注册自定义网络管理，这样 QML 里的 encrypted:/// 永远有效
   engine.setNetworkAccessManagerFactory(
       new EncryptedNetworkAccessManagerFactory(selector));
+  // 图片走 image://encrypted/，在工作线程上解密并按 sourceSize 解码
+  engine.addImageProvider("encrypted", new EncryptedImageProvider(selector));
 
+  QElapsedTimer loadTimer;
+  // 原始模式下保存文件后自动重新加载，之后的加载失败不退出，修正后再次保存即可
+  bool reloaded = false;
   QObject::connect(
       &engine, &QQmlApplicationEngine::objectCreated, &app,
-      [url](QObject *obj, const QUrl &objUrl) {
+      [url, selector, unitCache = unitCache.get(), &loadTimer,
+       &reloaded](QObject *obj, const QUrl &objUrl) {
         if (!obj && url == objUrl) {
+          if (reloaded) {
+            qWarning() << "[RawMode] 重新加载失败，修正后保存即可重试";
+            return;
+          }
           qCritical() << "QML加载失败: 无法创建对象" << objUrl;
           QCoreApplication::exit(-1);
         } else {
-          qDebug() << "QML对象创建成功:" << objUrl;
+          qDebug() << "QML对象创建成功:" << objUrl
+                   << "耗时(ms):" << loadTimer.nsecsElapsed() / 1e6
+                   << "预热命中:" << selector->cacheStats().warmHits
+                   << "预编译单元:" << (unitCache ? unitCache->stats().hits : 0);
+          ResourceMetrics::instance().logSummary();
+#ifdef USE_ENCRYPTED_RESOURCES
+          selector->saveAccessProfile(startupProfilePath());
+#endif
         }
       },
       Qt::QueuedConnection);
+  QObject::connect(&app, &QCoreApplication::aboutToQuit, [&metrics, tracePath,
+                                                         metricsPath] {
+    if (!tracePath.isEmpty())
+      metrics.writeChromeTrace(tracePath);
+    if (!metricsPath.isEmpty())
+      metrics.writeJson(metricsPath);
+  });
+#ifndef USE_ENCRYPTED_RESOURCES
+  // 读过的文件被修改时，销毁当前界面、清空组件缓存并重新加载入口；
+  // 未修改的文件仍由选择器的内容缓存提供，不再读盘
+  QTimer reloadTimer;
+  reloadTimer.setSingleShot(true);
+  reloadTimer.setInterval(RELOAD_DEBOUNCE_MS);
+  QObject::connect(selector, &EncryptedResourceSelector::rawResourceChanged,
+                   &reloadTimer, qOverload<>(&QTimer::start));
+  QObject::connect(&reloadTimer, &QTimer::timeout, &engine,
+                   [&app, &engine, &loadTimer, &reloaded, url] {
+                     reloaded = true;
+                     loadTimer.restart();
+                     // 组件仍被根对象引用时不会从缓存中移除，必须先销毁旧界面；
+                     // 期间没有窗口，暂时关闭“最后一个窗口关闭时退出”
+                     const bool quitOnClose = app.quitOnLastWindowClosed();
+                     app.setQuitOnLastWindowClosed(false);
+                     qDeleteAll(engine.rootObjects());
+                     engine.clearComponentCache();
+                     app.setQuitOnLastWindowClosed(quitOnClose);
+                     engine.load(url);
+                   });
+#endif
+
+  loadTimer.start();
   engine.load(url);
 
   return app.exec();
@@ -58,9 +58,12 @@ Window {
                     }
 
                     Image {
-                        source: "encrypted:///CMake-Logo.png"
+                        source: "image://encrypted/CMake-Logo.png"
                         width: 290
                         height: 82
+                        sourceSize.width: 290
+                        sourceSize.height: 82
+                        asynchronous: true
                         fillMode: Image.PreserveAspectFit
                         anchors.horizontalCenter: parent.horizontalCenter
                     }
@@ -0,0 +1,1332 @@
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QRandomGenerator>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QMutex>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <QUrl>
+#include "AsyncLogger.h"
+#include "CipherBackend.h"
+#include "EncryptedArchive.h"
+#include "EncryptedArchiveDelta.h"
+#include "EncryptedNetworkAccessManager.h"
+#include "EncryptedQmlUnitCache.h"
+#include "EncryptedResourceMount.h"
+#include "EncryptedResourceSelector.h"
+#include "PlaintextArena.h"
+#include "ResourceEncryption.h"
+#include "ResourceEncryptor.h"
+#include "ResourceMetrics.h"
+#include "ResourcePath.h"
+
+namespace {
+
+const QString BENCH_KEY = QStringLiteral("MySecretKey123!@#");
+
+/**
+ * @brief 基线实现:逐字节 XOR,每个字节一次取模和带边界检查的 operator[]
+ * 保留在这里用于对比优化前后的吞吐量
+ */
+QByteArray legacyDecrypt(const QByteArray &data, const QString &key)
+{
+    QByteArray keyHash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha256);
+    QByteArray result = data;
+    int keyLen = keyHash.size();
+    for (int i = 0; i < result.size(); ++i) {
+        result[i] = result[i] ^ keyHash[i % keyLen];
+    }
+    return result;
+}
+
+QByteArray randomBytes(qsizetype size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    QRandomGenerator gen(42);
+    for (qsizetype i = 0; i < size; ++i)
+        data[i] = char(gen.generate() & 0xff);
+    return data;
+}
+
+/**
+ * @brief 当前进程常驻内存(字节),仅 Linux 可用,其他平台返回 -1
+ */
+qint64 currentRss()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1)
+            return fields.at(1).toLongLong() * 4096;
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief 按数据量决定迭代次数,保证每个用例处理约 256MB 数据
+ */
+int iterationsFor(qsizetype size)
+{
+    const qint64 target = 256ll * 1024 * 1024;
+    return int(qMax<qint64>(3, target / size));
+}
+
+/**
+ * @brief 机器可读的结果,字段与 Google Benchmark 的 JSON 输出一致,
+ * 可以直接用其 compare.py 等工具对比两次运行
+ */
+QJsonArray &results()
+{
+    static QJsonArray list;
+    return list;
+}
+
+/**
+ * @param name 用例名,同一次运行内唯一
+ * @param iterations 计时的迭代次数
+ * @param nsPerOp 每次迭代的耗时(纳秒)
+ * @param bytesPerSecond 吞吐量,0 表示不适用
+ * @param counters 其他指标,与 Google Benchmark 的用户计数器一样放在顶层
+ */
+void record(const QString &name, qint64 iterations, double nsPerOp, double bytesPerSecond = 0,
+            const QJsonObject &counters = QJsonObject())
+{
+    QJsonObject result = counters;
+    result["name"] = name;
+    result["run_name"] = name;
+    result["run_type"] = QStringLiteral("iteration");
+    result["iterations"] = iterations;
+    result["real_time"] = nsPerOp;
+    result["time_unit"] = QStringLiteral("ns");
+    if (bytesPerSecond > 0)
+        result["bytes_per_second"] = bytesPerSecond;
+    results().append(result);
+}
+
+template <typename Fn>
+void run(const char *name, qsizetype bytesPerIteration, Fn &&fn)
+{
+    const int iterations = iterationsFor(bytesPerIteration);
+    fn(); // 预热
+    QElapsedTimer timer;
+    timer.start();
+    const std::clock_t cpuStart = std::clock();
+    for (int i = 0; i < iterations; ++i)
+        fn();
+    const double cpuNs = double(std::clock() - cpuStart) * 1e9 / CLOCKS_PER_SEC / iterations;
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    const double gbps = double(bytesPerIteration) * iterations / seconds / 1e9;
+    const double nsPerOp = seconds * 1e9 / iterations;
+    printf("%-32s %10lld B %10.3f GB/s %14.1f ns/op\n", name,
+           static_cast<long long>(bytesPerIteration), gbps, nsPerOp);
+    fflush(stdout);
+    record(QString("%1/%2").arg(QLatin1String(name)).arg(bytesPerIteration), iterations, nsPerOp, gbps * 1e9,
+           {{"cpu_time", cpuNs}, {"bytes", qint64(bytesPerIteration)}});
+}
+
+void benchXor()
+{
+    const qsizetype sizes[] = {1024, 64 * 1024, 64 * 1024 * 1024};
+    for (qsizetype size : sizes) {
+        const QByteArray cipher = randomBytes(size);
+        QByteArray scratch = cipher;
+
+        run("xor/legacy", size, [&] {
+            QByteArray plain = legacyDecrypt(cipher, BENCH_KEY);
+            Q_UNUSED(plain);
+        });
+        run("xor/decrypt", size, [&] {
+            QByteArray plain = ResourceEncryption::decrypt(cipher, BENCH_KEY);
+            Q_UNUSED(plain);
+        });
+        run("xor/decryptInPlace", size, [&] {
+            ResourceEncryption::decryptInPlace(scratch, BENCH_KEY);
+        });
+    }
+}
+
+/**
+ * @brief 完整的加密/解密(文件头、IV、AES-256-CTR)在不同资源大小下的吞吐量
+ */
+void benchRoundTrip()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const qsizetype sizes[] = {1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    for (qsizetype size : sizes) {
+        const QByteArray plain = randomBytes(size);
+        const QByteArray cipher = ResourceEncryption::encrypt(plain, key);
+        run("aes/encrypt", size, [&] {
+            QByteArray encrypted = ResourceEncryption::encrypt(plain, key);
+            Q_UNUSED(encrypted);
+        });
+        run("aes/decrypt", size, [&] {
+            QByteArray decrypted = ResourceEncryption::decrypt(cipher, key);
+            Q_UNUSED(decrypted);
+        });
+    }
+}
+
+/**
+ * @brief 各加密后端的原地处理吞吐量:XOR vs 软件 AES-256-CTR vs AES-NI
+ */
+void benchCiphers()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const QByteArray iv(ResourceEncryption::IvSize, '\x5a');
+    const auto xorCipher = CipherBackend::create(CipherAlgorithm::Xor, key, iv);
+    const auto aesSoftware = CipherBackend::create(CipherAlgorithm::Aes256Ctr, key, iv, false);
+    const auto aesHardware = CipherBackend::create(CipherAlgorithm::Aes256Ctr, key, iv, true);
+
+    const qsizetype sizes[] = {64 * 1024, 64 * 1024 * 1024};
+    for (qsizetype size : sizes) {
+        QByteArray scratch = randomBytes(size);
+        char *p = scratch.data();
+        run("cipher/xor", size, [&] { xorCipher->process(p, p, size, 0); });
+        run("cipher/aes-256-ctr software", size, [&] { aesSoftware->process(p, p, size, 0); });
+        if (CipherBackend::hardwareAesAvailable())
+            run("cipher/aes-256-ctr aes-ni", size, [&] { aesHardware->process(p, p, size, 0); });
+    }
+}
+
+/**
+ * @brief 1 万次小资源解密:每次传入密钥字符串 vs 复用派生密钥
+ */
+void benchSmallResources()
+{
+    const int count = 10000;
+    const qsizetype size = 512;
+    QList<QByteArray> resources;
+    resources.reserve(count);
+    for (int i = 0; i < count; ++i)
+        resources.append(randomBytes(size));
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+
+    run("small/passphrase x10k", size * count, [&] {
+        for (const QByteArray &cipher : resources) {
+            QByteArray plain = ResourceEncryption::decrypt(cipher, BENCH_KEY);
+            Q_UNUSED(plain);
+        }
+    });
+    run("small/derivedKey x10k", size * count, [&] {
+        for (const QByteArray &cipher : resources) {
+            QByteArray plain = ResourceEncryption::decrypt(cipher, key);
+            Q_UNUSED(plain);
+        }
+    });
+}
+
+/**
+ * @brief 20MB 加密 PNG 的端到端加载:选择器解密 -> 回复 -> readAll()
+ * 统计解密之后发生的数据拷贝字节数;引擎只通过 QIODevice 读取,readAll() 的一次拷贝无法避免
+ */
+void benchReplyCopies()
+{
+    const qsizetype size = 20 * 1024 * 1024;
+    const QByteArray cipher = ResourceEncryption::encrypt(randomBytes(size), BENCH_KEY);
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    selector.registerEncryptedResource("big.png", cipher);
+    const QUrl url(QStringLiteral("encrypted:///big.png"));
+
+    qint64 copied = 0;
+    run("reply/load 20MB png", size, [&] {
+        const PlaintextBuffer plain = selector.decryptedBuffer(u"big.png");
+        EncryptedNetworkReply reply(plain, url);
+        const QByteArray loaded = reply.readAll();
+        if (loaded.constData() != plain.constData())
+            copied += loaded.size();
+    });
+    const int iterations = iterationsFor(size) + 1;
+    printf("%-32s %10lld B copied after decrypt per load\n", "reply/load 20MB png",
+           static_cast<long long>(copied / iterations));
+    record("reply/copies 20MB png", iterations, 0, 0, {{"copied_bytes", copied / iterations}});
+}
+
+/**
+ * @brief 200MB 资源:整体解密 vs 流式解密的首字节延迟和常驻内存增量
+ * 密文放在临时归档中通过映射读取,与运行时的归档路径一致
+ */
+void benchStreaming()
+{
+    const qsizetype size = 200 * 1024 * 1024;
+    QTemporaryDir dir;
+    const QString archivePath = dir.filePath(QStringLiteral("bench.pak"));
+    {
+        QByteArray cipher = randomBytes(size);
+        ResourceEncryption::encryptInPlace(cipher, BENCH_KEY);
+        EncryptedArchiveWriter writer(archivePath);
+        if (!writer.open() || !writer.addEntry("video.bin", cipher) || !writer.finish())
+            return;
+    }
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    selector.addArchive(archivePath);
+    const QUrl url(QStringLiteral("encrypted:///video.bin"));
+    QByteArray firstChunk(64 * 1024, Qt::Uninitialized);
+
+    auto report = [](const char *name, qint64 ttfbNs, qint64 rssBefore, qint64 rssAfter) {
+        const double rssDeltaMb = rssBefore < 0 ? -1.0 : (rssAfter - rssBefore) / 1048576.0;
+        printf("%-32s %10.3f ms TTFB %10.1f MB RSS delta\n", name, ttfbNs / 1e6, rssDeltaMb);
+        fflush(stdout);
+        record(name, 1, double(ttfbNs), 0, {{"rss_delta_mb", rssDeltaMb}});
+    };
+
+    {
+        const qint64 rssBefore = currentRss();
+        QElapsedTimer timer;
+        timer.start();
+        const PlaintextBuffer plain = selector.decryptedBuffer(u"video.bin");
+        EncryptedNetworkReply reply(plain, url);
+        QCoreApplication::processEvents();
+        reply.read(firstChunk.data(), firstChunk.size());
+        report("stream/full decrypt 200MB", timer.nsecsElapsed(), rssBefore, currentRss());
+    }
+    {
+        const qint64 rssBefore = currentRss();
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray cipher;
+        selector.findStreamableResource("video.bin", &cipher);
+        EncryptedStreamReply reply(cipher, selector.decryptionKey(), url);
+        QCoreApplication::processEvents();
+        reply.read(firstChunk.data(), firstChunk.size());
+        report("stream/chunked 200MB", timer.nsecsElapsed(), rssBefore, currentRss());
+    }
+}
+
+/**
+ * @brief 项目资源集:加密 vs 压缩后加密的体积和加载(解密+解压)耗时
+ */
+void benchCompression()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const QDir assetDir(QStringLiteral(RESOURCE_BENCH_ASSET_DIR));
+    const QStringList assets = {"main.qml", "MyComponent.qml", "qmldir", "CMake-Logo.png"};
+    const int rounds = 2000;
+
+    auto loadNs = [&](const QByteArray &blob) {
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < rounds; ++i) {
+            QByteArray plain = ResourceEncryption::decrypt(blob, key);
+            Q_UNUSED(plain);
+        }
+        return double(timer.nsecsElapsed()) / rounds;
+    };
+
+    qint64 totalPlain = 0;
+    qint64 totalCompressed = 0;
+    for (const QString &name : assets) {
+        QFile file(assetDir.filePath(name));
+        if (!file.open(QIODevice::ReadOnly)) continue;
+        const QByteArray data = file.readAll();
+        const QByteArray plain = ResourceEncryption::encrypt(data, key);
+        const QByteArray compressed = ResourceEncryption::encrypt(data, key, CipherAlgorithm::Aes256Ctr,
+                                                                  CompressionMethod::Zlib);
+        totalPlain += plain.size();
+        totalCompressed += compressed.size();
+        const double plainNs = loadNs(plain);
+        const double inflateNs = loadNs(compressed);
+        printf("%-32s %8lld B -> %8lld B (%5.1f%%) %10.1f ns load %10.1f ns load+inflate\n",
+               qPrintable("compress/" + name), static_cast<long long>(plain.size()),
+               static_cast<long long>(compressed.size()), 100.0 * compressed.size() / plain.size(),
+               plainNs, inflateNs);
+        fflush(stdout);
+        record("compress/" + name + "/load", rounds, plainNs, 0, {{"bytes", plain.size()}});
+        record("compress/" + name + "/load+inflate", rounds, inflateNs, 0, {{"bytes", compressed.size()}});
+    }
+    printf("%-32s %8lld B -> %8lld B (%5.1f%%)\n", "compress/total",
+           static_cast<long long>(totalPlain), static_cast<long long>(totalCompressed),
+           100.0 * totalCompressed / qMax<qint64>(1, totalPlain));
+}
+
+/**
+ * @brief EncryptedNetworkReply 的读取吞吐量:引擎以 16KB 为单位 read() 与一次 readAll()
+ */
+void benchReplyRead()
+{
+    const qsizetype size = 64 * 1024 * 1024;
+    const PlaintextBuffer plain = PlaintextBuffer::fromByteArray(randomBytes(size));
+    const QUrl url(QStringLiteral("encrypted:///data.bin"));
+    QByteArray chunk(16 * 1024, Qt::Uninitialized);
+
+    run("reply/read 16KB chunks", size, [&] {
+        EncryptedNetworkReply reply(plain, url);
+        while (reply.read(chunk.data(), chunk.size()) > 0) {
+        }
+    });
+    run("reply/readAll", size, [&] {
+        EncryptedNetworkReply reply(plain, url);
+        const QByteArray all = reply.readAll();
+        Q_UNUSED(all);
+    });
+}
+
+/**
+ * @brief 大注册表(10 万个资源)下的单次查找和小资源加载开销,请求顺序随机
+ */
+void benchLargeRegistry()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const int resourceCount = 100000;
+    const int requests = 200000;
+
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    QHash<QString, QByteArray> resources;
+    QStringList paths;
+    resources.reserve(resourceCount);
+    const QByteArray cipher = ResourceEncryption::encrypt(randomBytes(256), key);
+    for (int i = 0; i < resourceCount; ++i) {
+        const QString path = QString("qml/module%1/Component%2.qml").arg(i % 211).arg(i);
+        resources.insert(path, cipher);
+        paths.append(path);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    selector.registerEncryptedResources(resources);
+    const qint64 registerNs = timer.nsecsElapsed();
+
+    QList<int> order(requests);
+    QRandomGenerator gen(7);
+    for (int &index : order)
+        index = int(gen.bounded(resourceCount));
+
+    int found = 0;
+    timer.restart();
+    for (int index : std::as_const(order))
+        found += selector.hasResource(paths.at(index));
+    const double lookupNs = double(timer.nsecsElapsed()) / requests;
+
+    timer.restart();
+    for (int i = 0; i < requests / 10; ++i)
+        found += !selector.getDecryptedResource(paths.at(order.at(i))).isEmpty();
+    const double loadNs = double(timer.nsecsElapsed()) / (requests / 10);
+
+    printf("%-32s %10d entries %10.3f ms register %10.1f ns lookup %10.1f ns load (%d found)\n",
+           "registry/large", resourceCount, registerNs / 1e6, lookupNs, loadNs, found);
+    fflush(stdout);
+    record("registry/large/register", 1, double(registerNs), 0, {{"entries", resourceCount}});
+    record("registry/large/lookup", requests, lookupNs);
+    record("registry/large/load 256B", requests / 10, loadNs);
+}
+
+/**
+ * @brief 多 MB 资源请求在请求线程(GUI 线程)上的阻塞时间:同步解密 vs 异步回复
+ */
+void benchGuiStall()
+{
+    const qsizetype sizes[] = {4 * 1024 * 1024, 16 * 1024 * 1024};
+    for (qsizetype size : sizes) {
+        EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+        selector.setStreamingThreshold(0);
+        selector.registerEncryptedResource("asset.js",
+                                           ResourceEncryption::encrypt(randomBytes(size), BENCH_KEY));
+        const QUrl url(QStringLiteral("encrypted:///asset.js"));
+        const int rounds = 10;
+
+        qint64 syncStall = 0;
+        for (int i = 0; i < rounds; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            EncryptedNetworkReply reply(selector.decryptedBuffer(u"asset.js"), url);
+            syncStall += timer.nsecsElapsed();
+        }
+
+        qint64 asyncStall = 0;
+        qint64 asyncTotal = 0;
+        for (int i = 0; i < rounds; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            EncryptedAsyncReply reply(&selector, QStringLiteral("asset.js"), url);
+            asyncStall += timer.nsecsElapsed();
+            QEventLoop loop;
+            QObject::connect(&reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
+            if (!reply.isFinished()) loop.exec();
+            asyncTotal += timer.nsecsElapsed();
+        }
+
+        printf("%-32s %10lld B %10.3f ms sync stall %10.3f ms async stall %10.3f ms async total\n",
+               "reply/gui stall", static_cast<long long>(size), syncStall / 1e6 / rounds,
+               asyncStall / 1e6 / rounds, asyncTotal / 1e6 / rounds);
+        fflush(stdout);
+        const QString name = QString("reply/gui stall/%1").arg(size);
+        record(name + "/sync", rounds, double(syncStall) / rounds);
+        record(name + "/async", rounds, double(asyncStall) / rounds, 0,
+               {{"async_total_ns", double(asyncTotal) / rounds}});
+    }
+}
+
+/**
+ * @brief 冷加载 main.qml + MyComponent:加密源码 vs 加密的预编译字节码
+ * 每轮使用新的引擎,计时从发起加载到组件 Ready(获取 qmldir、解密、解析和编译两个文件);
+ * 预编译字节码需要当前 Qt 安装中的 qmlcachegen,找不到时只测源码
+ */
+void benchQmlLoad()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const QDir assetDir(QStringLiteral(RESOURCE_BENCH_ASSET_DIR));
+    const QStringList qmlFiles = {"main.qml", "MyComponent.qml"};
+    const QString qmlCompiler = ResourceEncryptor::defaultQmlCompiler();
+    const QUrl url(QStringLiteral("encrypted:/main.qml"));
+    const int rounds = 20;
+
+    // 基准不链接 AppModule,用占位类型满足 MyComponent 的导入
+    qmlRegisterType<QObject>("AppModule", 1, 0, "MyNewCppModule");
+
+    for (const bool precompiled : {false, true}) {
+        if (precompiled && qmlCompiler.isEmpty()) {
+            printf("%-32s skipped: qmlcachegen not found\n", "qml/cold load precompiled");
+            continue;
+        }
+
+        EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+        QFile qmldir(assetDir.filePath("qmldir"));
+        if (qmldir.open(QIODevice::ReadOnly))
+            selector.registerEncryptedResource("qmldir", ResourceEncryption::encrypt(qmldir.readAll(), key));
+        qint64 payloadBytes = 0;
+        for (const QString &name : qmlFiles) {
+            QByteArray payload;
+            QString virtualPath = name;
+            if (precompiled) {
+                payload = ResourceEncryptor::compileQml(assetDir.filePath(name), qmlCompiler);
+                virtualPath = EncryptedQmlUnitCache::unitPath(name);
+            } else {
+                QFile file(assetDir.filePath(name));
+                if (file.open(QIODevice::ReadOnly))
+                    payload = file.readAll();
+            }
+            if (payload.isEmpty()) {
+                printf("%-32s skipped: cannot prepare %s\n", "qml/cold load", qPrintable(name));
+                return;
+            }
+            payloadBytes += payload.size();
+            selector.registerEncryptedResource(virtualPath, ResourceEncryption::encrypt(payload, key));
+        }
+
+        std::unique_ptr<EncryptedQmlUnitCache> unitCache;
+        if (precompiled)
+            unitCache = std::make_unique<EncryptedQmlUnitCache>(&selector);
+        EncryptedNetworkAccessManagerFactory factory(&selector);
+
+        qint64 firstNs = 0;
+        qint64 totalNs = 0;
+        for (int i = 0; i < rounds; ++i) {
+            QQmlEngine engine;
+            engine.setNetworkAccessManagerFactory(&factory);
+            QElapsedTimer timer;
+            timer.start();
+            QQmlComponent component(&engine, url, QQmlComponent::Asynchronous);
+            if (component.isLoading()) {
+                QEventLoop loop;
+                QObject::connect(&component, &QQmlComponent::statusChanged, &loop, &QEventLoop::quit);
+                loop.exec();
+            }
+            const qint64 elapsed = timer.nsecsElapsed();
+            if (!component.isReady()) {
+                printf("%-32s failed: %s\n", "qml/cold load", qPrintable(component.errorString()));
+                return;
+            }
+            if (i == 0)
+                firstNs = elapsed;
+            totalNs += elapsed;
+        }
+
+        printf("%-32s %10lld B %10.3f ms first %10.3f ms mean",
+               precompiled ? "qml/cold load precompiled" : "qml/cold load source",
+               static_cast<long long>(payloadBytes), firstNs / 1e6, totalNs / 1e6 / rounds);
+        if (unitCache)
+            printf(" %4llu units", static_cast<unsigned long long>(unitCache->stats().hits));
+        printf("\n");
+        fflush(stdout);
+        record(precompiled ? "qml/cold load precompiled" : "qml/cold load source", rounds, double(totalNs) / rounds,
+               0, {{"first_ns", firstNs}, {"bytes", payloadBytes}});
+    }
+}
+
+/**
+ * @brief 端到端加载 N 个加密组件:引擎获取 qmldir 和每个组件,解密、编译并创建对象
+ * 分别测量两条路径:encrypted:/// 经网络管理器异步加载,
+ * 以及预先解密挂载为内存 qrc 资源、由 URL 拦截器改写后按本地文件同步加载
+ * 只依赖 QtQml 的 QtObject,不需要 QtQuick 插件和图形环境
+ */
+void benchQmlComponents()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const int components = 200;
+    const int rounds = 5;
+    const QUrl url(QStringLiteral("encrypted:/bench/Main.qml"));
+
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    QHash<QString, QByteArray> resources;
+    QByteArray qmldir = "module bench\n";
+    QByteArray mainSource = "import QtQml\n\nQtObject {\n    property list<QtObject> items: [\n";
+    for (int i = 0; i < components; ++i) {
+        const QByteArray name = "Item" + QByteArray::number(i);
+        const QByteArray source = "import QtQml\n\nQtObject {\n"
+                                  "    property int index: " + QByteArray::number(i) + "\n"
+                                  "    property string label: \"component \" + index\n"
+                                  "    property var values: [index, index * 2, index * 3]\n"
+                                  "    function total() { return values.reduce((a, b) => a + b, 0) }\n"
+                                  "}\n";
+        resources.insert("bench/" + QString::fromLatin1(name) + ".qml", ResourceEncryption::encrypt(source, key));
+        qmldir += name + " 1.0 " + name + ".qml\n";
+        mainSource += "        " + name + " {}" + (i + 1 < components ? ",\n" : "\n");
+    }
+    mainSource += "    ]\n}\n";
+    resources.insert("bench/qmldir", ResourceEncryption::encrypt(qmldir, key));
+    resources.insert("bench/Main.qml", ResourceEncryption::encrypt(mainSource, key));
+    selector.registerEncryptedResources(resources);
+    EncryptedNetworkAccessManagerFactory factory(&selector);
+
+    for (const bool mounted : {false, true}) {
+        const char *mode = mounted ? "mounted" : "network";
+        // 挂载的解密和建树只发生一次,单独计时
+        std::unique_ptr<EncryptedResourceMount> mount;
+        qint64 mountNs = 0;
+        if (mounted) {
+            QElapsedTimer timer;
+            timer.start();
+            mount = std::make_unique<EncryptedResourceMount>(&selector, QStringLiteral("/bench-mount"));
+            if (!mount->mount(resources.keys())) {
+                printf("%-32s mount failed\n", "qml/components");
+                return;
+            }
+            mountNs = timer.nsecsElapsed();
+        }
+
+        qint64 firstNs = 0;
+        qint64 totalNs = 0;
+        for (int i = 0; i < rounds; ++i) {
+            QQmlEngine engine;
+            engine.setNetworkAccessManagerFactory(&factory);
+            if (mount) {
+                engine.addUrlInterceptor(mount.get());
+            }
+            QElapsedTimer timer;
+            timer.start();
+            QQmlComponent component(&engine, url, QQmlComponent::Asynchronous);
+            if (component.isLoading()) {
+                QEventLoop loop;
+                QObject::connect(&component, &QQmlComponent::statusChanged, &loop, &QEventLoop::quit);
+                loop.exec();
+            }
+            std::unique_ptr<QObject> object(component.isReady() ? component.create() : nullptr);
+            const qint64 elapsed = timer.nsecsElapsed();
+            if (!object) {
+                printf("%-32s %s failed: %s\n", "qml/components", mode, qPrintable(component.errorString()));
+                return;
+            }
+            if (i == 0)
+                firstNs = elapsed;
+            totalNs += elapsed;
+        }
+
+        printf("%-32s %10d components %-8s %10.3f ms first %10.3f ms mean", "qml/components", components, mode,
+               firstNs / 1e6, totalNs / 1e6 / rounds);
+        if (mounted)
+            printf(" %10.3f ms mount", mountNs / 1e6);
+        printf("\n");
+        fflush(stdout);
+        record(QString("qml/components:%1/%2").arg(components).arg(mode), rounds, double(totalNs) / rounds, 0,
+               {{"first_ns", firstNs}, {"mount_ns", mountNs}});
+    }
+}
+
+/**
+ * @brief 在 threads 个线程上同时执行 body(线程序号),返回总耗时(纳秒)
+ */
+template <typename Body>
+qint64 runConcurrently(int threads, Body body)
+{
+    std::atomic<bool> go{false};
+    QList<QThread *> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.append(QThread::create([&go, &body, t] {
+            while (!go.load()) QThread::yieldCurrentThread();
+            body(t);
+        }));
+        workers.last()->start();
+    }
+    QElapsedTimer timer;
+    timer.start();
+    go.store(true);
+    for (QThread *worker : std::as_const(workers)) {
+        worker->wait();
+        delete worker;
+    }
+    return timer.nsecsElapsed();
+}
+
+/**
+ * @brief 注册表查找的多线程扩展性:互斥锁保护的 QHash(旧实现) vs RCU 快照
+ * 每个线程做固定次数的查找,吞吐量应随线程数增长而不是被同一把锁串行化
+ */
+void benchRegistryScaling()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const int resourceCount = 512;
+    const int opsPerThread = 200000;
+
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    QMutex legacyMutex;
+    QHash<QString, QByteArray> legacy;
+    QHash<QString, QByteArray> resources;
+    QStringList paths;
+    for (int i = 0; i < resourceCount; ++i) {
+        const QString path = QString("qml/components/Component%1.qml").arg(i);
+        paths.append(path);
+        resources.insert(path, ResourceEncryption::encrypt(randomBytes(64), key));
+    }
+    selector.registerEncryptedResources(resources);
+    legacy = resources;
+
+    for (const int threads : {1, 2, 4, 8, 16}) {
+        std::atomic<int> found{0};
+        const qint64 mutexNs = runConcurrently(threads, [&](int t) {
+            int hits = 0;
+            for (int i = 0; i < opsPerThread; ++i) {
+                QMutexLocker locker(&legacyMutex);
+                hits += legacy.contains(paths.at((i + t * 7) % resourceCount));
+            }
+            found += hits;
+        });
+        const qint64 rcuNs = runConcurrently(threads, [&](int t) {
+            int hits = 0;
+            for (int i = 0; i < opsPerThread; ++i)
+                hits += selector.hasResource(paths.at((i + t * 7) % resourceCount));
+            found += hits;
+        });
+        const qint64 decryptNs = runConcurrently(threads, [&](int t) {
+            int hits = 0;
+            for (int i = 0; i < opsPerThread / 10; ++i)
+                hits += !selector.getDecryptedResource(paths.at((i + t * 7) % resourceCount)).isEmpty();
+            found += hits;
+        });
+
+        const double ops = double(opsPerThread) * threads;
+        printf("registry/%-2d threads %14.2f Mlookup/s mutex %10.2f Mlookup/s rcu %10.2f Mload/s rcu+decrypt\n",
+               threads, ops / mutexNs * 1e3, ops / rcuNs * 1e3, ops / 10 / decryptNs * 1e3);
+        fflush(stdout);
+        const QString name = QString("registry/threads:%1").arg(threads);
+        record(name + "/mutex", qint64(ops), mutexNs / ops * threads, 0, {{"items_per_second", ops / mutexNs * 1e9}});
+        record(name + "/rcu", qint64(ops), rcuNs / ops * threads, 0, {{"items_per_second", ops / rcuNs * 1e9}});
+        record(name + "/rcu+decrypt", qint64(ops / 10), decryptNs / (ops / 10) * threads, 0,
+               {{"items_per_second", ops / 10 / decryptNs * 1e9}});
+    }
+}
+
+/**
+ * @brief 注册表并发正确性:读线程持续解密并校验内容,同时写线程反复重新注册和批量注册
+ * @return 所有读到的内容都与某一次注册的版本一致时返回 true
+ */
+bool stressRegistry()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    const int stableCount = 64;
+    const int churnCount = 16;
+    const int readers = qMax(4, QThread::idealThreadCount());
+    const qint64 durationMs = 1000;
+
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    for (int i = 0; i < stableCount; ++i)
+        selector.registerEncryptedResource(QString("stable/%1.qml").arg(i),
+                                           ResourceEncryption::encrypt("stable-" + QByteArray::number(i), key));
+    for (int i = 0; i < churnCount; ++i)
+        selector.registerEncryptedResource(QString("churn/%1.qml").arg(i),
+                                           ResourceEncryption::encrypt("churn-" + QByteArray::number(i) + "-0", key));
+
+    std::atomic<bool> stop{false};
+    std::atomic<quint64> lookups{0};
+    std::atomic<quint64> failures{0};
+    std::atomic<quint64> writes{0};
+    QElapsedTimer timer;
+    timer.start();
+    runConcurrently(readers + 1, [&](int t) {
+        if (t == readers) {
+            // 写线程:单个重新注册与批量注册交替进行
+            for (int version = 1; timer.elapsed() < durationMs; ++version) {
+                if (version % 8 == 0) {
+                    QHash<QString, QByteArray> batch;
+                    for (int i = 0; i < churnCount; ++i)
+                        batch.insert(QString("churn/%1.qml").arg(i),
+                                     ResourceEncryption::encrypt(
+                                         "churn-" + QByteArray::number(i) + "-" + QByteArray::number(version), key));
+                    selector.registerEncryptedResources(batch);
+                } else {
+                    const int i = version % churnCount;
+                    selector.registerEncryptedResource(
+                        QString("churn/%1.qml").arg(i),
+                        ResourceEncryption::encrypt("churn-" + QByteArray::number(i) + "-" + QByteArray::number(version),
+                                                    key));
+                }
+                ++writes;
+            }
+            stop.store(true);
+            return;
+        }
+        QRandomGenerator gen(t);
+        quint64 local = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            const bool churn = gen.bounded(4) == 0;
+            const int i = gen.bounded(churn ? churnCount : stableCount);
+            const QByteArray plain = selector.getDecryptedResource(
+                QString(churn ? "churn/%1.qml" : "stable/%1.qml").arg(i));
+            const QByteArray expected = (churn ? "churn-" : "stable-") + QByteArray::number(i);
+            const bool ok = churn ? plain.startsWith(expected + "-") : plain == expected;
+            if (!ok) ++failures;
+            ++local;
+        }
+        lookups += local;
+    });
+
+    printf("%-32s %10llu lookups %8llu writes %6llu failures (%d readers)\n", "registry/stress",
+           static_cast<unsigned long long>(lookups.load()), static_cast<unsigned long long>(writes.load()),
+           static_cast<unsigned long long>(failures.load()), readers);
+    fflush(stdout);
+    record("registry/stress", qint64(lookups.load()), double(durationMs) * 1e6 / qMax<quint64>(1, lookups.load()), 0,
+           {{"writes", qint64(writes.load())}, {"failures", qint64(failures.load())}});
+    return failures.load() == 0;
+}
+
+/**
+ * @brief 5 万个不同路径的单次请求查找开销
+ * 旧流程:复制 URL 路径、逐个 remove(0, 1) 去掉前导 '/'、转换 UTF-8、在排序索引上二分查找;
+ * 新流程:QStringView 去掉前导 '/'、栈上转换 UTF-8、完美哈希直接定位记录
+ */
+void benchPathLookup()
+{
+    const int pathCount = 50000;
+    const int rounds = 4;
+
+    QTemporaryDir dir;
+    const QString archivePath = dir.filePath("paths.pak");
+    QList<QUrl> urls;
+    QList<QByteArray> sortedPaths;
+    {
+        EncryptedArchiveWriter writer(archivePath);
+        writer.open();
+        for (int i = 0; i < pathCount; ++i) {
+            const QString path = QString("qml/module%1/Component%2.qml").arg(i % 97).arg(i);
+            writer.addEntry(path, QByteArray(16, 'x'));
+            urls.append(QUrl("encrypted:///" + path));
+            sortedPaths.append(path.toUtf8());
+        }
+        QElapsedTimer timer;
+        timer.start();
+        if (!writer.finish()) {
+            printf("%-32s failed: %s\n", "path/build index", qPrintable(writer.errorString()));
+            return;
+        }
+        printf("%-32s %10d paths %10.3f ms\n", "path/build perfect hash", pathCount, timer.nsecsElapsed() / 1e6);
+        record("path/build perfect hash", 1, double(timer.nsecsElapsed()), 0, {{"paths", pathCount}});
+    }
+    std::sort(sortedPaths.begin(), sortedPaths.end());
+
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    if (!selector.addArchive(archivePath)) return;
+    // 请求路径事先取出,两种流程都从 url.path() 返回的字符串开始计时
+    QStringList urlPaths;
+    for (const QUrl &url : std::as_const(urls))
+        urlPaths.append(url.path());
+
+    int found = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int r = 0; r < rounds; ++r) {
+        for (const QString &urlPath : std::as_const(urlPaths)) {
+            QString path = urlPath;
+            while (path.startsWith('/')) path.remove(0, 1);
+            const QByteArray utf8 = path.toUtf8();
+            found += std::binary_search(sortedPaths.cbegin(), sortedPaths.cend(), utf8);
+        }
+    }
+    const double legacyNs = double(timer.nsecsElapsed()) / (rounds * pathCount);
+
+    // 与 createRequest 相同:一次 findStreamableResource 同时得到是否存在
+    timer.restart();
+    for (int r = 0; r < rounds; ++r) {
+        for (const QString &urlPath : std::as_const(urlPaths)) {
+            QStringView path(urlPath);
+            while (path.startsWith(u'/')) path = path.mid(1);
+            QByteArray ciphertext;
+            bool exists = false;
+            selector.findStreamableResource(path, &ciphertext, &exists);
+            found += exists;
+        }
+    }
+    const double perfectNs = double(timer.nsecsElapsed()) / (rounds * pathCount);
+
+    printf("%-32s %10d paths %10.1f ns legacy %10.1f ns perfect hash (%d found)\n", "path/lookup per request",
+           pathCount, legacyNs, perfectNs, found);
+    // 路径相关的堆分配:旧流程复制后删除 '/' 时分离 1 次、toUtf8 1 次;新流程的查找不分配。
+    // 计时范围之外 createRequest 每个请求还有 url.path() 的 1 次,以及回复对象本身
+    // (QObject/QIODevice 的私有数据)和异步解密任务的分配,这些与查找方式无关
+    printf("%-32s %10d legacy %10d perfect hash (+1 for url.path())\n", "path/allocations per request", 2, 0);
+    fflush(stdout);
+    record("path/lookup/legacy", qint64(rounds) * pathCount, legacyNs, 0, {{"path_allocations", 2}});
+    record("path/lookup/perfect hash", qint64(rounds) * pathCount, perfectNs, 0, {{"path_allocations", 0}});
+}
+
+/**
+ * @brief 启动注册开销:逐个 readAll() 后整体注册 vs 只索引文件名、按需解析
+ * 1000 个 64KB 的 .enc 文件,典型会话只打开其中 5%
+ */
+void benchLazyRegistration()
+{
+    const int fileCount = 1000;
+    const qsizetype size = 64 * 1024;
+    QTemporaryDir dir;
+    const QByteArray cipher = ResourceEncryption::encrypt(randomBytes(size), BENCH_KEY);
+    QStringList paths;
+    for (int i = 0; i < fileCount; ++i) {
+        const QString path = QString("screen%1/View%2.qml").arg(i % 50).arg(i);
+        QDir(dir.path()).mkpath(QFileInfo(dir.filePath(path)).path());
+        QFile file(dir.filePath(path + ".enc"));
+        if (!file.open(QIODevice::WriteOnly)) return;
+        file.write(cipher);
+        paths.append(path);
+    }
+
+    auto openSome = [&](EncryptedResourceSelector &selector) {
+        int loaded = 0;
+        for (int i = 0; i < fileCount; i += 20)
+            loaded += !selector.getDecryptedResource(paths.at(i)).isEmpty();
+        return loaded;
+    };
+
+    qint64 eagerNs = 0, eagerFirstNs = 0;
+    {
+        EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+        QElapsedTimer timer;
+        timer.start();
+        QHash<QString, QByteArray> resources;
+        QDirIterator it(dir.path(), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString fullPath = it.next();
+            QFile file(fullPath);
+            if (file.open(QIODevice::ReadOnly)) {
+                QString virtualPath = QDir(dir.path()).relativeFilePath(fullPath);
+                virtualPath.chop(4);
+                resources.insert(virtualPath, file.readAll());
+            }
+        }
+        selector.registerEncryptedResources(resources);
+        eagerNs = timer.nsecsElapsed();
+        timer.restart();
+        openSome(selector);
+        eagerFirstNs = timer.nsecsElapsed();
+    }
+
+    qint64 lazyNs = 0, lazyFirstNs = 0;
+    int loaded = 0;
+    {
+        EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+        QElapsedTimer timer;
+        timer.start();
+        selector.addResourceDirectory(dir.path());
+        lazyNs = timer.nsecsElapsed();
+        timer.restart();
+        loaded = openSome(selector);
+        lazyFirstNs = timer.nsecsElapsed();
+    }
+
+    printf("%-32s %10d files %10.3f ms eager %10.3f ms lazy (then %.3f / %.3f ms for %d loads)\n",
+           "register/startup", fileCount, eagerNs / 1e6, lazyNs / 1e6, eagerFirstNs / 1e6, lazyFirstNs / 1e6,
+           loaded);
+    fflush(stdout);
+    record("register/startup/eager", 1, double(eagerNs), 0, {{"bytes", qint64(size) * fileCount}});
+    record("register/startup/lazy", 1, double(lazyNs), 0, {{"bytes", qint64(size) * fileCount}});
+    record("register/first loads/eager", loaded, double(eagerFirstNs) / qMax(1, loaded));
+    record("register/first loads/lazy", loaded, double(lazyFirstNs) / qMax(1, loaded));
+}
+
+/**
+ * @brief 归档差分更新:1000 个 16KB 条目,新版本修改 20 个(中部插入 100 字节)、新增 5 个、删除 5 个、改名 3 个
+ * 对比重新打包整个归档与生成/应用差分的耗时,以及差分与归档的大小
+ */
+void benchArchiveDelta()
+{
+    const int entryCount = 1000;
+    const qsizetype size = 16 * 1024;
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    QTemporaryDir dir;
+    const QString basePath = dir.filePath("base.pak");
+    const QString targetPath = dir.filePath("target.pak");
+    const QString deltaPath = dir.filePath("update.delta");
+
+    QMap<QString, QByteArray> base;
+    for (int i = 0; i < entryCount; ++i)
+        base.insert(QString("screen%1/View%2.qml").arg(i % 50).arg(i), randomBytes(size));
+    QMap<QString, QByteArray> target = base;
+    const QStringList paths = base.keys();
+    for (int i = 0; i < 20; ++i) {
+        QByteArray &data = target[paths.at(i * 37)];
+        data.insert(size / 2, randomBytes(100));
+    }
+    for (int i = 0; i < 5; ++i) {
+        target.remove(paths.at(i * 37 + 11));
+        target.insert(QString("added/New%1.qml").arg(i), randomBytes(size));
+    }
+    for (int i = 0; i < 3; ++i)
+        target.insert(QString("renamed/View%1.qml").arg(i), target.take(paths.at(i * 37 + 23)));
+
+    auto pack = [&key](const QString &fileName, const QMap<QString, QByteArray> &entries) {
+        EncryptedArchiveWriter writer(fileName);
+        if (!writer.open()) return false;
+        for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+            if (!writer.addEntry(it.key(), ResourceEncryption::encrypt(it.value(), key))) return false;
+        }
+        return writer.finish();
+    };
+
+    QElapsedTimer timer;
+    if (!pack(basePath, base)) return;
+    timer.start();
+    if (!pack(targetPath, target)) return;
+    const qint64 repackNs = timer.nsecsElapsed();
+    const qint64 packageBytes = QFileInfo(targetPath).size();
+
+    EncryptedArchiveDelta delta;
+    timer.restart();
+    if (!delta.create(basePath, targetPath, deltaPath, key)) return;
+    const qint64 createNs = timer.nsecsElapsed();
+    const EncryptedArchiveDelta::Stats created = delta.stats();
+
+    timer.restart();
+    if (!delta.apply(basePath, deltaPath, key)) {
+        printf("%-32s apply failed: %s\n", "delta/apply", qPrintable(delta.errorString()));
+        return;
+    }
+    const qint64 applyNs = timer.nsecsElapsed();
+
+    printf("%-32s %10lld B package %10lld B delta (%.2f%%) %d kept %d patched %d replaced %d removed\n",
+           "delta/size", static_cast<long long>(packageBytes), static_cast<long long>(created.deltaBytes),
+           100.0 * created.deltaBytes / packageBytes, created.kept, created.patched, created.replaced,
+           created.removed);
+    printf("%-32s %10.3f ms repack %10.3f ms create %10.3f ms apply (%lld B written)\n", "delta/time",
+           repackNs / 1e6, createNs / 1e6, applyNs / 1e6, static_cast<long long>(delta.stats().writtenBytes));
+    fflush(stdout);
+    record("delta/repack", 1, double(repackNs), 0, {{"bytes", packageBytes}});
+    record("delta/create", 1, double(createNs), 0, {{"bytes", created.deltaBytes}});
+    record("delta/apply", 1, double(applyNs), 0,
+           {{"bytes", delta.stats().writtenBytes}, {"patched", created.patched}, {"replaced", created.replaced}});
+}
+
+/**
+ * @brief 按块完整性校验的开销:同一明文分别以无标签的版本 1 和带标签的版本 2 解密,
+ * 以及单独校验全部标签(1MB 以上并行)与限制为单线程时的吞吐量
+ */
+void benchChunkVerify()
+{
+    const DerivedKey key = ResourceEncryption::deriveKey(BENCH_KEY);
+    key.chunkMac(); // 认证码密钥只生成一次,不计入测量
+    auto lastTime = [](qsizetype back) { return results().at(results().size() - back)["real_time"].toDouble(); };
+
+    const qsizetype sizes[] = {64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    for (qsizetype size : sizes) {
+        const QByteArray tagged = ResourceEncryption::encrypt(randomBytes(size), key);
+        qsizetype offset = 0;
+        ResourceEncryption::openCipher(tagged, key, &offset);
+        // 去掉标签表并改写为版本 1 的头部,密文负载不变
+        QByteArray legacy = tagged.left(ResourceEncryption::HeaderSize) + tagged.mid(offset);
+        legacy[4] = 1;
+        memset(legacy.data() + 24, 0, 8);
+
+        run("verify/decrypt v1 untagged", size, [&] {
+            QByteArray plain = ResourceEncryption::decrypt(legacy, key);
+            Q_UNUSED(plain);
+        });
+        run("verify/decrypt v2 tagged", size, [&] {
+            QByteArray plain = ResourceEncryption::decrypt(tagged, key);
+            Q_UNUSED(plain);
+        });
+        const double overhead = (lastTime(1) - lastTime(2)) / lastTime(2) * 100;
+        run("verify/tags", size, [&] {
+            if (!ResourceEncryption::verifyChunks(tagged, key)) printf("verify/tags failed\n");
+        });
+        QThreadPool *pool = QThreadPool::globalInstance();
+        const int threads = pool->maxThreadCount();
+        pool->setMaxThreadCount(1);
+        run("verify/tags single thread", size, [&] {
+            if (!ResourceEncryption::verifyChunks(tagged, key)) printf("verify/tags failed\n");
+        });
+        pool->setMaxThreadCount(threads);
+
+        printf("%-32s %10lld B %9.2f%% decrypt overhead\n", "verify/overhead", static_cast<long long>(size), overhead);
+        fflush(stdout);
+        record(QString("verify/overhead/%1").arg(size), 1, 0, 0,
+               {{"overhead_pct", overhead}, {"tag_bytes", qint64(offset - ResourceEncryption::HeaderSize)}});
+    }
+}
+
+/**
+ * @brief 明文内存池:不经缓存反复解密同一批资源,对比通用堆分配与内存池复用,
+ * 以及开启内存锁定后的开销
+ */
+void benchPlaintextArena()
+{
+    PlaintextArena &arena = PlaintextArena::instance();
+    const bool locking = arena.isLockingEnabled();
+    const qsizetype sizes[] = {16 * 1024, 256 * 1024, 4 * 1024 * 1024};
+    for (qsizetype size : sizes) {
+        const int resourceCount = 16;
+        EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+        selector.setCacheBudget(0);
+        QStringList paths;
+        for (int i = 0; i < resourceCount; ++i) {
+            paths << QString("asset%1.bin").arg(i);
+            selector.registerEncryptedResource(paths.last(), ResourceEncryption::encrypt(randomBytes(size), BENCH_KEY));
+        }
+        const qint64 bytes = qint64(size) * resourceCount;
+
+        run("arena/heap", bytes, [&] {
+            for (const QString &path : std::as_const(paths)) {
+                const QByteArray plain = selector.getDecryptedResource(path);
+                Q_UNUSED(plain);
+            }
+        });
+
+        arena.trim();
+        const PlaintextArena::Stats before = arena.stats();
+        run("arena/pooled", bytes, [&] {
+            for (const QString &path : std::as_const(paths)) {
+                const PlaintextBuffer plain = selector.decryptedBuffer(path);
+                Q_UNUSED(plain);
+            }
+        });
+        const PlaintextArena::Stats after = arena.stats();
+        const qint64 allocations = qint64(after.allocations - before.allocations);
+        const qint64 reuses = qint64(after.reuses - before.reuses);
+        printf("%-32s %10lld allocations %10lld reuses\n", "arena/pooled stats", static_cast<long long>(allocations),
+               static_cast<long long>(reuses));
+        fflush(stdout);
+        record(QString("arena/stats/%1").arg(size), 1, 0, 0,
+               {{"allocations", allocations}, {"reuses", reuses}, {"peak_in_use_bytes", after.peakInUseBytes}});
+
+        arena.trim();
+        arena.setLockingEnabled(true);
+        run("arena/pooled locked", bytes, [&] {
+            for (const QString &path : std::as_const(paths)) {
+                const PlaintextBuffer plain = selector.decryptedBuffer(path);
+                Q_UNUSED(plain);
+            }
+        });
+        arena.setLockingEnabled(locking);
+        arena.trim();
+    }
+}
+
+/**
+ * @brief 资源计量的开销:同一批小资源分别在关闭计量、开启计量、开启计量并追踪时解密
+ */
+void benchMetricsOverhead()
+{
+    const int count = 2000;
+    const int rounds = 5;
+    const qsizetype size = 512;
+    EncryptedResourceSelector selector(nullptr, BENCH_KEY);
+    QHash<QString, QByteArray> resources;
+    QStringList paths;
+    for (int i = 0; i < count; ++i) {
+        const QString path = QString("metrics/item%1.js").arg(i);
+        resources.insert(path, ResourceEncryption::encrypt(randomBytes(size), BENCH_KEY));
+        paths.append(path);
+    }
+    selector.registerEncryptedResources(resources);
+
+    ResourceMetrics &metrics = ResourceMetrics::instance();
+    const bool wasEnabled = metrics.isEnabled();
+    auto load = [&] {
+        for (int r = 0; r < rounds; ++r) {
+            for (const QString &path : std::as_const(paths)) {
+                QByteArray plain = selector.getDecryptedResource(path);
+                Q_UNUSED(plain);
+            }
+        }
+    };
+
+    metrics.setEnabled(false);
+    run("metrics/off x10k", size * count * rounds, load);
+    metrics.setEnabled(true);
+    run("metrics/on x10k", size * count * rounds, load);
+    metrics.startTrace(1 << 20);
+    run("metrics/on+trace x10k", size * count * rounds, load);
+    metrics.stopTrace();
+    metrics.reset();
+    metrics.setEnabled(wasEnabled);
+}
+
+/**
+ * @brief 每个加密请求的日志开销:原同步处理函数 vs 异步批量日志
+ * 原处理函数每条消息格式化、写控制台并 fflush、新建 QTextStream 写文件并 flush;
+ * 控制台输出换成空设备,避免基准输出被刷屏
+ */
+void benchLogging()
+{
+    const int count = 100000;
+    QTemporaryDir dir;
+    const QString message = QStringLiteral("[Network] 尝试加载加密资源: qml/module7/Component42.qml");
+
+    {
+        QFile logFile(dir.filePath("legacy.log"));
+        logFile.open(QIODevice::WriteOnly | QIODevice::Append);
+        FILE *console = fopen(QProcess::nullDevice().toLocal8Bit().constData(), "w");
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; ++i) {
+            const QString txt = QString("[DEBUG] %1").arg(message);
+            fprintf(console, "%s\n", txt.toLocal8Bit().constData());
+            fflush(console);
+            QTextStream ts(&logFile);
+            ts << QDateTime::currentDateTime().toString("hh:mm:ss.zzz ") << txt << "\n";
+            ts.flush();
+        }
+        printf("%-32s %10d msgs %10.1f ns/msg\n", "log/sync handler", count,
+               double(timer.nsecsElapsed()) / count);
+        record("log/sync handler", count, double(timer.nsecsElapsed()) / count);
+        fclose(console);
+    }
+
+    {
+        AsyncLogger logger(dir.filePath("async.log"), 1 << 17);
+        logger.setConsoleOutput(false);
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < count; ++i)
+            logger.log(QtDebugMsg, message);
+        const double producerNs = double(timer.nsecsElapsed()) / count;
+        logger.flush();
+        printf("%-32s %10d msgs %10.1f ns/msg %10.3f ms total (%llu written, %llu dropped)\n",
+               "log/async logger", count, producerNs, timer.nsecsElapsed() / 1e6,
+               static_cast<unsigned long long>(logger.writtenCount()),
+               static_cast<unsigned long long>(logger.droppedCount()));
+        record("log/async logger", count, producerNs, 0, {{"dropped", qint64(logger.droppedCount())}});
+
+        logger.setMinimumLevel(QtWarningMsg);
+        timer.restart();
+        for (int i = 0; i < count; ++i)
+            logger.log(QtDebugMsg, message);
+        printf("%-32s %10d msgs %10.1f ns/msg\n", "log/async filtered", count,
+               double(timer.nsecsElapsed()) / count);
+        record("log/async filtered", count, double(timer.nsecsElapsed()) / count);
+    }
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // QML 导入会加载 QtQuick 插件,用 offscreen 平台在无显示环境下运行
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    app.setApplicationName("Qt Resource Benchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("加密资源加载路径的性能基准");
+    parser.addHelpOption();
+    QCommandLineOption jsonOption("json", "把结果以 Google Benchmark 的 JSON 格式写入文件", "file");
+    QCommandLineOption filterOption("filter", "只运行名称匹配该正则表达式的用例组", "regex");
+    QCommandLineOption listOption("list", "列出所有用例组");
+    parser.addOption(jsonOption);
+    parser.addOption(filterOption);
+    parser.addOption(listOption);
+    parser.process(app);
+
+    bool ok = true;
+    const QList<QPair<QString, std::function<void()>>> groups = {
+        {"xor", benchXor},
+        {"cipher", benchCiphers},
+        {"aes", benchRoundTrip},
+        {"small", benchSmallResources},
+        {"reply-copies", benchReplyCopies},
+        {"reply-read", benchReplyRead},
+        {"stream", benchStreaming},
+        {"gui-stall", benchGuiStall},
+        {"compress", benchCompression},
+        {"qml-load", benchQmlLoad},
+        {"qml-components", benchQmlComponents},
+        {"path", benchPathLookup},
+        {"registry-large", benchLargeRegistry},
+        {"register", benchLazyRegistration},
+        {"delta", benchArchiveDelta},
+        {"verify", benchChunkVerify},
+        {"arena", benchPlaintextArena},
+        {"metrics", benchMetricsOverhead},
+        {"log", benchLogging},
+        {"registry-scaling", benchRegistryScaling},
+        {"registry-stress", [&ok] { ok = stressRegistry() && ok; }},
+    };
+    if (parser.isSet(listOption)) {
+        for (const auto &group : groups)
+            printf("%s\n", qPrintable(group.first));
+        return 0;
+    }
+
+    const QRegularExpression filter(parser.value(filterOption));
+    if (!filter.isValid()) {
+        fprintf(stderr, "无效的 --filter: %s\n", qPrintable(filter.errorString()));
+        return 2;
+    }
+    const QDateTime started = QDateTime::currentDateTime();
+    for (const auto &group : groups) {
+        if (filter.match(group.first).hasMatch())
+            group.second();
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QJsonObject context;
+        context["date"] = started.toString(Qt::ISODate);
+        context["host_name"] = QSysInfo::machineHostName();
+        context["executable"] = QCoreApplication::applicationFilePath();
+        context["num_cpus"] = QThread::idealThreadCount();
+        context["qt_version"] = QString::fromLatin1(qVersion());
+        context["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+        context["aes_ni"] = CipherBackend::hardwareAesAvailable();
+#ifdef QT_NO_DEBUG
+        context["library_build_type"] = QStringLiteral("release");
+#else
+        context["library_build_type"] = QStringLiteral("debug");
+#endif
+        QJsonObject root;
+        root["context"] = context;
+        root["benchmarks"] = results();
+        QSaveFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly)) {
+            fprintf(stderr, "无法写入 %s\n", qPrintable(parser.value(jsonOption)));
+            return 2;
+        }
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        if (!file.commit())
+            return 2;
+    }
+    return ok ? 0 : 1;
+}